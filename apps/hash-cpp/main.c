@@ -93,6 +93,30 @@ void hashtable_insert(rte_tch_hash& hash,
 	success_rate = 1.0f;
 }
 
+template<rte_tch_hash_variants Variant, int BatchSize>
+void hashtable_insert_bulk(rte_tch_hash& hash,
+		hash_key_t keys[], unsigned key_count,
+		__rte_unused hash_key_t patterns[], __rte_unused unsigned op_count, float& success_rate) {
+
+	hash_data_t data[BatchSize];
+	uint16_t expiration[BatchSize];
+	for (int i = 0; i < BatchSize; ++i) {
+		data[i].mm = _mm_set1_epi16(16);
+		expiration[i] = 16;
+	}
+
+	unsigned success_op = 0;
+	unsigned key_i = 0;
+	for (; key_i + BatchSize <= key_count; key_i += BatchSize) {
+		success_op += rte_tch_hash_add_key_data_bulk(Variant, &hash, keys + key_i,
+				BatchSize, data, expiration, 0, NULL, NULL, NULL);
+	}
+	for (; key_i < key_count; ++key_i) {
+		success_op += (rte_tch_hash_add_key_data(Variant, &hash, keys[key_i], data[0], 16, 0) >= 0);
+	}
+	success_rate = key_count ? static_cast<float>(success_op) / key_count : 1.0f;
+}
+
 typedef decltype(&hashtable_insert<H_V1604>) hashtable_operation;
 
 volatile uint64_t global_hash = 0;
@@ -185,6 +209,44 @@ void hashtable_lookup_batch(rte_tch_hash& hash, hash_key_t keys[],
 }
 
 
+template<rte_tch_hash_variants Variant, int StreamSize>
+void hashtable_lookup_stream(rte_tch_hash& hash, hash_key_t keys[],
+		unsigned key_count, hash_key_t patterns[], unsigned op_count,
+		float& success_rate) {
+
+	std::unique_ptr<hash_data_t[]> data(new hash_data_t[StreamSize]);
+	std::unique_ptr<hash_key_t[]> xored_keys(new hash_key_t[StreamSize]);
+	uint64_t hits[(StreamSize + 63) / 64];
+
+	unsigned stream_i = 0;
+	unsigned patt_i = 0;
+	unsigned success_op = 0;
+	for (unsigned op_i = 0; op_i < op_count; op_i += StreamSize) {
+
+		stream_i += StreamSize;
+		if (stream_i + StreamSize > key_count) {
+			stream_i = 0;
+		}
+
+		patt_i += StreamSize;
+		if (patt_i + StreamSize > pattern_size) {
+			patt_i = 0;
+		}
+
+		const hash_key_t* keys_stream = keys + stream_i;
+		const hash_key_t* patt_stream = patterns + patt_i;
+
+		for (int i = 0; i < StreamSize; ++i) {
+			xored_keys[i].mm = _mm_xor_si128(keys_stream[i].mm, patt_stream[i].mm);
+		}
+
+		success_op += rte_tch_hash_lookup_stream_data(Variant, &hash,
+				xored_keys.get(), StreamSize, hits, data.get(), 0);
+	}
+	success_rate = static_cast<float>(success_op) / op_count;
+}
+
+
 /* Benchmark functions */
 
 struct core_loop_args {
@@ -296,6 +358,7 @@ struct cmdargs {
 	std::vector<int> core_counts;
 	std::vector<float> unsucessful_rate;
 	float max_unsucessful_rate;
+	bool shared;
 	std::string outfile;
 };
 
@@ -304,10 +367,16 @@ const unsigned lookup_op_count = 10000000;
 const unsigned lookup_batch_op_count = 100000000;
 
 template<rte_tch_hash_variants Variant>
-static void make_hash(rte_tch_hash* hash[], unsigned capacity, int core_i, int lcore_id) {
+static void make_hash(rte_tch_hash* hash[], unsigned capacity, int core_i, int lcore_id, bool shared) {
+	// With a shared table, all cores use the table of the first core
+	if (shared && core_i > 0) {
+		hash[core_i] = hash[0];
+		return;
+	}
 	rte_tch_hash_parameters nat_hash_params = {
 			.entries = capacity,
-			.socket_id = static_cast<int>(rte_lcore_to_socket_id(lcore_id))
+			.socket_id = static_cast<int>(rte_lcore_to_socket_id(lcore_id)),
+			.extra_flag = static_cast<uint8_t>(shared ? RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD : 0)
 	};
 	hash[core_i] = rte_tch_hash_create(Variant, &nat_hash_params);
 	if (hash == nullptr) {
@@ -335,6 +404,10 @@ void benchmark_for_size(const cmdargs& args,
 
 		key_list* shifted_patterns = patterns;
 
+		// With a shared table, each core inserts and looks up its share of the keys
+		const unsigned key_count = args.shared ? size / core_count : size;
+		const int table_count = args.shared ? 1 : core_count;
+
 		// Init. hash tables
 		std::unique_ptr<rte_tch_hash*[]> hash(new rte_tch_hash*[core_count]);
 
@@ -343,7 +416,7 @@ void benchmark_for_size(const cmdargs& args,
 		const int wrap = 0;
 		int lcore_id = rte_get_next_lcore(-1, skip_master, wrap);
 		for(; core_i < core_count && lcore_id != RTE_MAX_LCORE; ++core_i) {
-			make_hash<Variant>(hash.get(), capacity, core_i, lcore_id);
+			make_hash<Variant>(hash.get(), capacity, core_i, lcore_id, args.shared);
 			lcore_id = rte_get_next_lcore(lcore_id, skip_master, 0);
 		}
 
@@ -355,7 +428,7 @@ void benchmark_for_size(const cmdargs& args,
 		} else if (core_i == core_count - 2) {
 			++core_i;
 			lcore_id = rte_get_master_lcore();
-			make_hash<Variant>(hash.get(), capacity, core_i, lcore_id);
+			make_hash<Variant>(hash.get(), capacity, core_i, lcore_id, args.shared);
 		}
 
 		bench_desc desc;
@@ -369,42 +442,56 @@ void benchmark_for_size(const cmdargs& args,
 				hash.get(), desc, core_count, size, hash_op_count, outstream);
 		desc.op_name = "insert";
 		run_bench_multicore(hashtable_insert<Variant>, list, shifted_patterns,
-				hash.get(), desc, core_count, size, size, outstream);
+				hash.get(), desc, core_count, key_count, key_count, outstream);
+
+		// Insert again the same keys in empty tables, using bulk insertions
+		for(core_i = 0; core_i < table_count; ++core_i) {
+			rte_tch_hash_reset(Variant,hash[core_i]);
+		}
+		desc.op_name = "insert_bulk_32";
+		run_bench_multicore(hashtable_insert_bulk<Variant, 32>, list, shifted_patterns,
+				hash.get(), desc, core_count, key_count, key_count, outstream);
 
 		// Shuffle key lists for lookups
 		for(core_i = 0; core_i < core_count; ++core_i) {
 			//fprintf(stderr, "Shuffle list core %d/%d %p\n", core_i, core_count, list[core_i].keys.get());
 			std::shuffle(list[core_i].keys.get(),
-					list[core_i].keys.get() + size, rnd);
+					list[core_i].keys.get() + key_count, rnd);
 		}
 
 		for (float rate : args.unsucessful_rate) {
 			fprintf(stderr, "Invalid rate: %f %d\n", rate, size);
 			desc.op_name = "lookup";
 			run_bench_multicore(hashtable_lookup<Variant>, list,
-					shifted_patterns, hash.get(), desc, core_count, size,
+					shifted_patterns, hash.get(), desc, core_count, key_count,
 					lookup_op_count, outstream);
 			desc.op_name = "lookup_batch_32";
 			run_bench_multicore(hashtable_lookup_batch<Variant, 32>, list,
-					shifted_patterns, hash.get(), desc, core_count, size,
+					shifted_patterns, hash.get(), desc, core_count, key_count,
 					lookup_batch_op_count, outstream);
+			if (key_count >= 4096) {
+				desc.op_name = "lookup_stream_4096";
+				run_bench_multicore(hashtable_lookup_stream<Variant, 4096>, list,
+						shifted_patterns, hash.get(), desc, core_count, key_count,
+						lookup_batch_op_count, outstream);
+			}
 			shifted_patterns += max_cores;
 		}
 
 		// Check integrity
-		for(core_i = 0; core_i < core_count; ++core_i) {
+		for(core_i = 0; core_i < table_count; ++core_i) {
 			fprintf(stderr, "Checking for lcore_id %d\n", core_i);
 			//rte_tch_hash_print_stats(Variant, hash[core_i], 0);
 			rte_tch_hash_check_integrity(Variant, hash[core_i], 0);
 		}
 
 		// Reset hash
-		for(core_i = 0; core_i < core_count; ++core_i) {
+		for(core_i = 0; core_i < table_count; ++core_i) {
 			rte_tch_hash_reset(Variant,hash[core_i]);
 		}
 
 		// Free structures
-		for(core_i = 0; core_i < core_count; ++core_i) {
+		for(core_i = 0; core_i < table_count; ++core_i) {
 			rte_tch_hash_free(Variant,hash[core_i]);
 		}
 	}
@@ -507,7 +594,7 @@ rte_tch_hash_variants parse_implementation(const char* implem) {
 void usage() {
 	fprintf(stderr,
 			"Usage: hash-cpp [-c CAPACITY_LIST] [-l LOAD_FACTOR_LIST] "
-			"[-t CORE_COUNT_LIST] [-i INVALID_LOOKUP_RATE_LIST] IMPLEMENTATION [OUT_FILE]\n");
+			"[-t CORE_COUNT_LIST] [-i INVALID_LOOKUP_RATE_LIST] [-s] IMPLEMENTATION [OUT_FILE]\n");
 }
 
 void parse_args(cmdargs& args, int argc, char* argv[]) {
@@ -515,7 +602,8 @@ void parse_args(cmdargs& args, int argc, char* argv[]) {
 	// Iterate over CLI arguments
 	int opt;
 	optind = 1;
-	while ((opt = getopt(argc, argv, "c:l:t:i:")) != -1) {
+	args.shared = false;
+	while ((opt = getopt(argc, argv, "c:l:t:i:s")) != -1) {
 		switch (opt) {
 		case 'c':
 			parse_int_list(optarg, args.capacities, 1, 1000000000, "capacity");
@@ -531,6 +619,9 @@ void parse_args(cmdargs& args, int argc, char* argv[]) {
 			parse_float_list(optarg, args.unsucessful_rate, 0.0, 1.0,
 					"lookup rate");
 			break;
+		case 's':
+			args.shared = true;
+			break;
 		default:
 			usage();
 			exit(1);
@@ -560,6 +651,11 @@ void parse_args(cmdargs& args, int argc, char* argv[]) {
 	}
 
 	args.implementation = parse_implementation(argv[optind]);
+	if (args.shared && (args.implementation == H_V1604 || args.implementation == H_HORTON)) {
+		fprintf(stderr, "Implementation %s does not support multiple writers (-s)\n",
+				argv[optind]);
+		exit(1);
+	}
 
 	// Open output stream
 	if(argc - optind == 2) {
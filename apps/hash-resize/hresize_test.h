@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2018 - Present – Thomson Licensing, SAS
+ * All rights reserved.
+ *
+ * This source code is licensed under the Clear BSD license found in the
+ * LICENSE.md file in the root directory of this source tree.
+ */
+
+/* Resize test, included once after each variant header (no include guard, as rte_hash_template.h) */
+
+/* Signature of the i-th key crafted to hit the last HRESIZE_REGION buckets of arrays of nb buckets
+ * (both primary and secondary buckets) */
+static uint64_t
+H(hresize,sig)(uint32_t nb, uint32_t i)
+{
+	uint32_t a = ((uint32_t)rte_rand() & ~(nb - 1)) | (nb - HRESIZE_REGION + (i % HRESIZE_REGION));
+	uint32_t b = ((uint32_t)rte_rand() & ~(nb - 1)) | (nb - HRESIZE_REGION + ((i * 7 + 3) % HRESIZE_REGION));
+
+	return ((uint64_t)b << 32) | a;
+}
+
+static void
+H(hresize,key)(hash_hvariant_key_t *key, uint32_t i)
+{
+	uint32_t w[2] = {i, i * 2654435761u};
+
+	memset(key, 0, sizeof(*key));
+	memcpy(key, w, sizeof(w));
+}
+
+/* Shrink a table, then fill the smaller arrays so that the migration fails and the shrink is
+ * reverted, then fill the larger arrays so that the migration back fails too: the table must
+ * end in a usable state (growing, explicitly or automatically), without losing any key */
+static int
+H(hresize,test_failed_shrink)(const char *name, int auto_grow)
+{
+	struct rte_hash_hvariant_parameters params;
+	struct rte_hash_hvariant *h;
+	hash_hvariant_key_t key;
+	uint32_t cap, cap2, num_buckets, n, added, i, k, miss = 0, inserted = 0, size, steps = 0;
+	uint64_t *sig;
+	uint8_t *in;
+	int r, reverted, step = 1, grow = 1, shrink, failed;
+
+	memset(&params, 0, sizeof(params));
+	params.name = name;
+	params.entries = HRESIZE_ENTRIES(BUCKET_ENTRIES);
+	params.socket_id = rte_socket_id();
+	params.grow_load_pct = auto_grow ? 100 : 0;
+	h = H(rte_hash,create)(&params);
+	if (h == NULL) {
+		printf("%s: cannot create the table (%s)\n", name, rte_strerror(rte_errno));
+		return 1;
+	}
+	cap = H(rte_hash,capacity)(h);
+	num_buckets = cap / BUCKET_ENTRIES;
+	n = cap / 4 + 20000;
+	sig = calloc(n, sizeof(*sig));
+	in = calloc(n, sizeof(*in));
+	if (sig == NULL || in == NULL)
+		rte_exit(EXIT_FAILURE, "Out of memory\n");
+
+	/* a quarter of the table, so that shrink() accepts it */
+	for (added = 0; added < cap / 4 - 1000; added++) {
+		H(hresize,key)(&key, added);
+		sig[added] = rte_rand();
+		in[added] = H(rte_hash,add_key_with_hash)(h, key, sig[added], 500, 0) >= 0;
+	}
+	r = H(rte_hash,shrink)(h, 0);
+	if (r != 0) {
+		printf("%s: shrink refused (%d)\n", name, r);
+		return 1;
+	}
+
+	/* overflow the last buckets of the smaller arrays, then migrate until the shrink is reverted */
+	for (k = 0; added < n && k < 8 * HRESIZE_REGION * BUCKET_ENTRIES; k++, added++) {
+		H(hresize,key)(&key, added);
+		sig[added] = H(hresize,sig)(num_buckets / 2, k);
+		in[added] = H(rte_hash,add_key_with_hash)(h, key, sig[added], 500, 0) >= 0;
+	}
+	r = 1;
+	while (H(rte_hash,capacity)(h) != cap && (r = H(rte_hash,resize_step)(h, 256, 0)) > 0)
+		;
+	reverted = H(rte_hash,capacity)(h) == cap && r > 0;
+
+	/* overflow the last buckets of the larger arrays: the migration back fails as well */
+	for (k = 0; added < n && k < 16 * HRESIZE_REGION * BUCKET_ENTRIES; k++, added++) {
+		H(hresize,key)(&key, added);
+		sig[added] = H(hresize,sig)(num_buckets, k);
+		in[added] = H(rte_hash,add_key_with_hash)(h, key, sig[added], 500, 0) >= 0;
+	}
+	if (H(rte_hash,capacity)(h) == cap) {
+		/* not grown automatically: the migration is stalled until grow() is called */
+		step = H(rte_hash,resize_step)(h, UINT32_MAX, 0);
+		grow = H(rte_hash,grow)(h);
+	}
+	do {
+		r = H(rte_hash,resize_step)(h, 4096, 0);
+	} while (r > 0 && ++steps < 100000);
+
+	for (i = 0; i < added; i++) {
+		if (!in[i])
+			continue;
+		inserted++;
+		H(hresize,key)(&key, i);
+		if (H(rte_hash,lookup_with_hash)(h, key, sig[i], 0) < 0)
+			miss++;
+	}
+	size = H(rte_hash,size)(h, 0);
+	cap2 = H(rte_hash,capacity)(h);
+	shrink = H(rte_hash,shrink)(h, 0);
+
+	failed = !reverted || r != 0 || miss != 0 || size != inserted || cap2 <= cap || shrink == -EBUSY ||
+			(!auto_grow && (step != -ENOSPC || grow != 0));
+	printf("%s\t%s\treverted=%d capacity=%u->%u stalled_step=%d grow=%d last_step=%d missing=%u size=%u/%u\n",
+			name, failed ? "FAILED" : "OK", reverted, cap, cap2, step, grow, r, miss, size, inserted);
+
+	H(rte_hash,free)(h);
+	free(sig);
+	free(in);
+	return failed;
+}
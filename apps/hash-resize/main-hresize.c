@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2018 - Present – Thomson Licensing, SAS
+ * All rights reserved.
+ *
+ * This source code is licensed under the Clear BSD license found in the
+ * LICENSE.md file in the root directory of this source tree.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_errno.h>
+#include <rte_eal.h>
+#include <rte_lcore.h>
+#include <rte_random.h>
+#include <rte_debug.h>
+
+/* Number of buckets overflowed by the keys with crafted signatures */
+#define HRESIZE_REGION 64
+/* Table size (the smaller arrays of a shrink must not go below the minimum number of buckets) */
+#define HRESIZE_ENTRIES(bucket_entries) ((bucket_entries) == 16 ? 1 << 21 : 1 << 20)
+
+#include <rte_hash_bloom.h>
+#include "hresize_test.h"
+#include <rte_hash_bloom_b4.h>
+#include "hresize_test.h"
+#include <rte_hash_bloom_b16.h>
+#include "hresize_test.h"
+#include <rte_hash_lazy_bloom.h>
+#include "hresize_test.h"
+
+int
+main(int argc, char **argv)
+{
+	int ret, failed = 0;
+
+	/* init EAL */
+	ret = rte_eal_init(argc, argv);
+	if (ret < 0)
+		rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
+
+	rte_srand(5);
+
+	failed |= hresize_bloom_test_failed_shrink("resize_bloom", 0);
+	failed |= hresize_bloom_test_failed_shrink("resize_auto_bloom", 1);
+	failed |= hresize_bloom_b4_test_failed_shrink("resize_bloom_b4", 0);
+	failed |= hresize_bloom_b4_test_failed_shrink("resize_auto_bloom_b4", 1);
+	failed |= hresize_bloom_b16_test_failed_shrink("resize_bloom_b16", 0);
+	failed |= hresize_bloom_b16_test_failed_shrink("resize_auto_bloom_b16", 1);
+	failed |= hresize_lazy_bloom_test_failed_shrink("resize_lazy_bloom", 0);
+	failed |= hresize_lazy_bloom_test_failed_shrink("resize_auto_lazy_bloom", 1);
+
+	printf("%s\n", failed ? "FAILED" : "PASSED");
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,15 @@
+/**
+ * Copyright (c) 2018 - Present – Thomson Licensing, SAS
+ * All rights reserved.
+ *
+ * This source code is licensed under the Clear BSD license found in the
+ * LICENSE.md file in the root directory of this source tree.
+ */
+
+
+
+#include "rte_hash_bloom_k48_d16.h"
+
+#include "rte_cuckoo_hash_template.c"
+
+
@@ -0,0 +1,14 @@
+/**
+ * Copyright (c) 2018 - Present – Thomson Licensing, SAS
+ * All rights reserved.
+ *
+ * This source code is licensed under the Clear BSD license found in the
+ * LICENSE.md file in the root directory of this source tree.
+ */
+
+
+#include "rte_hash_lazy_bloom_set.h"
+
+#include "rte_cuckoo_hash_template.c"
+
+
@@ -26,12 +26,14 @@
 #include <rte_eal.h>
 #include <rte_eal_memconfig.h>
 #include <rte_per_lcore.h>
+#include <rte_lcore.h>
 #include <rte_errno.h>
 #include <rte_string_fns.h>
 #include <rte_cpuflags.h>
 #include <rte_log.h>
 #include <rte_rwlock.h>
 #include <rte_spinlock.h>
+#include <rte_atomic.h>
 #include <rte_ring.h>
 #include <rte_compat.h>
 #include <assert.h>
@@ -47,6 +49,13 @@
 #error "RTE TCH Hash Requires SSE4.2"
 #endif
 
+/* Operation counters (lookups, cuckoo moves, ...) kept per lcore, enabled at build time */
+#if defined(RTE_LIBRTE_TCH_HASH_STATS)
+#define OP_STATS 1
+#else
+#define OP_STATS 0
+#endif
+
 /* Macro to enable/disable run-time checking of function parameters */
 #if defined(RTE_LIBRTE_HASH_LAZY_DEBUG)
 #define RETURN_IF_TRUE(cond, retval) do { \
@@ -58,48 +67,179 @@
 #endif
 
 
-/* Number of items per bucket.
- *  -- This can be set to 1,2,4 or 8
- *  -- 8 is the default value, other values should not be used appart for specific experiments
+/* Number of items per bucket (BUCKET_ENTRIES, set in the variant header).
+ *  -- This can be set to 4, 8 or 16
+ *  -- 8 is the default value: 16-bit signatures, matched with one SSE compare
+ *  -- 4 halves buckets (signatures and timers are matched from the low half of an SSE register)
+ *  -- 16 stores 8-bit signatures so that the 16 signatures of a bucket fit in an SSE register
+ *     (matched with AVX-512 mask compares when available); timers are matched with AVX2
  */
-#define RTE_HASH_HVARIANT_BUCKET_ENTRIES		8U
+#define RTE_HASH_HVARIANT_BUCKET_ENTRIES		((unsigned)BUCKET_ENTRIES)
+
+#if BUCKET_ENTRIES != 4 && BUCKET_ENTRIES != 8 && BUCKET_ENTRIES != 16
+#error "Unsupported BUCKET_ENTRIES (must be 4, 8 or 16)"
+#endif
+#if BUCKET_ENTRIES == 16 && HORTON
+#error "Horton tables need 16-bit signatures (BUCKET_ENTRIES must be 4 or 8)"
+#endif
+
+/* Per-slot bitmasks of a bucket, and signature (bits 16 and above of the hash, the low bits
+ * being given by the bucket index) stored for each slot */
+#if BUCKET_ENTRIES == 16
+typedef uint16_t bucket_mask_t;
+typedef uint8_t bucket_signature_t;
+#define RTE_HASH_HVARIANT_SIGNATURE_BITS 8
+#else
+typedef uint8_t bucket_mask_t;
+typedef uint16_t bucket_signature_t;
+#define RTE_HASH_HVARIANT_SIGNATURE_BITS 16
+#endif
+
+#define signature_high(hash) ((bucket_signature_t)((hash) >> 16))
 
 #define NULL_SIGNATURE			0ULL
 
+/* Alignment of key store entries: 16 bytes when key and data fill whole SSE registers,
+ * otherwise entries are packed to save memory (e.g., 20 bytes for 16-byte keys and 4-byte data) */
+#if ((KEY_SIZE + DATA_SIZE) % 16) == 0
 #define KEY_ALIGNMENT			16
+#elif ((KEY_SIZE + DATA_SIZE) % 8) == 0
+#define KEY_ALIGNMENT			8
+#else
+#define KEY_ALIGNMENT			4
+#endif
 
 #define LCORE_CACHE_SIZE		8
 
 /** Max number of recursion in key displacement between buckets */
 #define RTE_HASH_HVARIANT_MAX_RECURSION 512
 
+/** Search the shortest cuckoo path breadth-first instead of the depth-first search */
+#ifndef RTE_HASH_HVARIANT_BFS_PATH
+#define RTE_HASH_HVARIANT_BFS_PATH 1
+#endif
+
+/** Max length of a cuckoo path found by the breadth-first search. All buckets up to depth
+ * BFS_MAX_DEPTH-1 are queued, so that the search is exhaustive up to BFS_MAX_DEPTH: the depth
+ * decreases with the bucket size to keep the queue on the stack (341, 585 and 273 buckets) */
+#if BUCKET_ENTRIES == 4
+#define RTE_HASH_HVARIANT_BFS_MAX_DEPTH 5
+#define RTE_HASH_HVARIANT_BFS_MAX_NODES (1 + BUCKET_ENTRIES * (1 + BUCKET_ENTRIES * (1 + BUCKET_ENTRIES * (1 + BUCKET_ENTRIES))))
+#define RTE_HASH_HVARIANT_BFS_VISITED_BITS 9
+#elif BUCKET_ENTRIES == 8
+#define RTE_HASH_HVARIANT_BFS_MAX_DEPTH 4
+#define RTE_HASH_HVARIANT_BFS_MAX_NODES (1 + BUCKET_ENTRIES * (1 + BUCKET_ENTRIES * (1 + BUCKET_ENTRIES)))
+#define RTE_HASH_HVARIANT_BFS_VISITED_BITS 10
+#else
+#define RTE_HASH_HVARIANT_BFS_MAX_DEPTH 3
+#define RTE_HASH_HVARIANT_BFS_MAX_NODES (1 + BUCKET_ENTRIES * (1 + BUCKET_ENTRIES))
+#define RTE_HASH_HVARIANT_BFS_VISITED_BITS 9
+#endif
+/* BFS_MAX_NODES = sum of BUCKET_ENTRIES^d for d < BFS_MAX_DEPTH, and the set of queued buckets
+ * (open addressing, BFS_VISITED_BITS) is at most half full */
+
 #define ENTRIES_MASK ((1U << RTE_HASH_HVARIANT_BUCKET_ENTRIES)-1U)
 
+/** Alignment of buckets: compact 4-slot buckets take half a cache line (two buckets per line) */
+#if BUCKET_ENTRIES == 4 && COMPACT_BUCKET
+#define RTE_HASH_HVARIANT_BUCKET_ALIGN (RTE_CACHE_LINE_SIZE / 2)
+#else
+#define RTE_HASH_HVARIANT_BUCKET_ALIGN RTE_CACHE_LINE_SIZE
+#endif
+
+/** Number of 64-bit words of the bloom filter of a bucket: 16-slot buckets may have twice as many
+ *  entries moved to their secondary bucket, the filter is doubled to keep the same false positive rate */
+#define RTE_HASH_HVARIANT_BLOOM_WORDS (BUCKET_ENTRIES == 16 ? 2 : 1)
+
 #define FAST_ITERATOR
 #define FAST_RESET_ITERATOR
 
 #define ITERATOR_GROUP 32
 
+/** Distance (in keys) between two consecutive stages of the streaming lookup pipeline */
+#define RTE_HASH_HVARIANT_STREAM_DISTANCE 8
+/** Number of in-flight keys in the streaming lookup (power of two, covers the 4 stages) */
+#define RTE_HASH_HVARIANT_STREAM_WINDOW 32
 
-/**
- * Constants usefuls for bulk lookup. Initialized at the hash table initialization
- */
-static __m128i max_expiration_time;
+#if RTE_HASH_HVARIANT_STREAM_WINDOW <= 3 * RTE_HASH_HVARIANT_STREAM_DISTANCE
+#error "Streaming lookup window is too small for the pipeline distance"
+#endif
+
+/** Number of version counters protecting buckets for lock-free readers (power of two).
+ *  Bucket b is protected by counter b % RTE_HASH_HVARIANT_LF_STRIPES: counters are kept
+ *  apart from buckets so that readers never write to bucket cachelines, and the small
+ *  table stays in cache. */
+#define RTE_HASH_HVARIANT_LF_STRIPES 4096
+
+/** Max length of a cuckoo path in multi-writer mode (all its buckets are locked while it is applied) */
+#define RTE_HASH_HVARIANT_MW_MAX_PATH 16
+/** Max number of times a multi-writer insertion re-acquires its locks before giving up */
+#define RTE_HASH_HVARIANT_MW_MAX_ATTEMPTS 8
+/** Max number of locks held by a writer: cuckoo path, secondary bucket and bloom filter owners */
+#define LF_LOCKSET_MAX (RTE_HASH_HVARIANT_MW_MAX_PATH + 4)
+
+/** Number of buckets of the old arrays migrated by each insertion while the table is being resized */
+#define RTE_HASH_HVARIANT_RESIZE_STEP 8
+
+/** Number of insertions between two attempts of a migration whose entries fit in neither array */
+#define RTE_HASH_HVARIANT_RESIZE_RETRY 1024
+
+/** Min number of buckets: the 16 low bits of a primary signature are given by the bucket index */
+#define RTE_HASH_HVARIANT_MIN_BUCKETS 65536u
+
+/** Max load (percentage of busy slots) of the smaller arrays for a table to be shrunk */
+#define RTE_HASH_HVARIANT_SHRINK_MAX_LOAD 50
+
+/** Number of entries of the overflow stash holding keys whose insertion failed (multiple of 4, at most 32) */
+#ifndef RTE_HASH_HVARIANT_STASH_SIZE
+#define RTE_HASH_HVARIANT_STASH_SIZE 32
+#endif
+
+
+#if TIMER_BITS == 32 && BUCKET_ENTRIES == 16
+#error "32-bit timers need buckets of 4 or 8 slots (the timers of a bucket must fit in an AVX2 register)"
+#endif
 
 /**
- *  Modulo 32768
+ *  Modulo 2^TIMER_BITS
  */
-#define timeunit_modulo(x)  (x & 0xffff)
+#define TIMER_MASK ((uint32_t)(((1ULL << TIMER_BITS) - 1)))
+#define timeunit_modulo(x)  ((x) & TIMER_MASK)
 /**
  *  Check for expired timer. In C there is not computation on 16 bit types so everything is promoted to 32bits.
  *  http://stackoverflow.com/questions/10047956/c-uint16-t-subtraction-behavior-in-gcc
  *  We need to account for this by adding a mask.
  */
-#define time_diff(a,b) ((((uint32_t)a-(uint32_t)b)&0xffffU))
-#define expired_timer(timer, current) (time_diff(timer,current) >= RTE_HASH_HVARIANT_MAX_EXPIRATION_PERIOD)
+#define time_diff(a,b) (timeunit_modulo((uint32_t)(a)-(uint32_t)(b)))
+#define expired_timer(timer, current) (time_diff(timer,current) >= (uint32_t)MAX_EXPIRATION_PERIOD)
+
+/**
+ *  SIMD timer checks use signed compares: flipping the sign bit of the time difference (by flipping
+ *  it in the current time) and of the max expiration period turns them into the unsigned compare
+ *  of expired_timer(), so that timers are checked with one compare.
+ */
+#define TIMER_SIGN_BIT (1U << (TIMER_BITS - 1))
+#define timer_biased_time(current) ((hash_hvariant_time_t)((current) ^ TIMER_SIGN_BIT))
+#define TIMER_BIASED_MAX_EXPIRATION ((hash_hvariant_time_t)(MAX_EXPIRATION_PERIOD ^ TIMER_SIGN_BIT))
 
 
+/** Cursor of a partition of the partitioned iterator (one cache line each, partitions being
+ *  iterated over by different cores) */
+struct iter_partition {
+	uint32_t next;                  /**< Next bucket index of the partition to start iterating from. */
+} __rte_cache_aligned;
+
 /** A hash table structure. */
+/* Counters of the operations run by one lcore, in their own cache line */
+struct op_stats_slot {
+	struct rte_hash_hvariant_op_stats s;
+} __rte_cache_aligned;
+
+/* Busy slots taken minus slots released by one lcore in multi-writer mode, in their own cache line */
+struct busy_delta_slot {
+	int64_t n;
+} __rte_cache_aligned;
+
 struct rte_hash_hvariant {
 	uint32_t entries;               /**< Total table entries. */
 	uint32_t num_buckets;           /**< Number of buckets in table. */
@@ -107,22 +247,126 @@ struct rte_hash_hvariant {
 	uint32_t iter_bucket_idx;          /* Next bucket index to start iterating from. */
 	uint64_t *iter_group_bucket_mask; /* Bit mask of group iterated buckets => 1 bit = ITER_GROUP buckets */
 	uint64_t *reset_group_bucket_mask; /* Bit mask of group to_reset buckets => 1 bit = ITER_GROUP */
+	uint32_t iter_nb_parts;            /* Number of partitions of the partitioned iterator (0: not used). */
 
 	struct rte_hash_hvariant_key *key_store;                /**< Table storing all keys and data */
 	struct rte_hash_hvariant_bucket *buckets;	/**< Table with buckets storing all the
 												 hash values and key indexes
 												 to the key table*/
+	uint32_t *secondary_signatures; /**< Hashes of the alternative buckets of all slots (compact buckets only). */
+	uint32_t *lf_versions;          /**< Version counters for lock-free readers (NULL if disabled). */
+	uint8_t extra_flag;             /**< Flags given at creation. */
+	uint8_t multi_writer;           /**< Version counters are also used as bucket locks by concurrent writers. */
+	struct op_stats_slot *op_stats; /**< Operation counters, one slot per lcore and one for other threads (NULL if disabled). */
+
+	int socket_id;                  /**< NUMA socket of the arrays (used when the table is resized). */
+	struct rte_hash_hvariant *resize_src; /**< Old arrays whose entries are being migrated (NULL if no resize in progress). */
+	uint32_t resize_next;           /**< Next bucket of resize_src to migrate. */
+	uint8_t resize_reverted;        /**< The resize failed and entries are moved back to the previous arrays. */
+	uint8_t resize_grow_pending;    /**< grow() was called while the migration was stalled: resize_step() grows the arrays. */
+	uint32_t resize_retry;          /**< Insertions before a stalled migration is tried again (0: not stalled, 1: at the next one). */
+	uint32_t busy_entries;          /**< Number of busy slots (plus busy_deltas in multi-writer mode). */
+	struct busy_delta_slot *busy_deltas; /**< Changes of busy_entries, one slot per lcore and one for other threads (multi-writer mode only). */
+	uint8_t auto_grow;              /**< Grow automatically when a threshold is crossed or an insertion fails. */
+	uint8_t grow_load_pct;          /**< Load (percentage of busy slots) triggering automatic growth (0: disabled). */
+	uint16_t grow_path_len;         /**< Cuckoo path length triggering automatic growth (0: disabled). */
+	uint32_t grow_threshold;        /**< Number of busy slots triggering automatic growth. */
+	uint32_t last_path_len;         /**< Length of the last cuckoo path applied. */
+	uint32_t expire_next;           /**< Next bucket scanned by expire_step(). */
+	uint64_t *scrub_filters;        /**< Bloom filters being rebuilt by bloom_scrub() (NULL if no scrub in progress). */
+	uint32_t scrub_next;            /**< Next bucket scanned (or whose filter is replaced) by bloom_scrub(). */
+	uint8_t scrub_installing;       /**< bloom_scrub() replaces the filters of buckets by the rebuilt ones. */
+	uint32_t rebalance_next;        /**< Next bucket scanned by rebalance_step(). */
+
+	uint32_t stash_mask;            /**< Busy entries of the stash (the stash is only searched if not 0). */
+	uint32_t stash_iterated;        /**< Stash entries already returned by iterate(). */
+	uint32_t stash_prim_hash[RTE_HASH_HVARIANT_STASH_SIZE] __rte_aligned(16); /**< Primary hash of stash entries. */
+	uint32_t stash_sec_hash[RTE_HASH_HVARIANT_STASH_SIZE]; /**< Secondary hash of stash entries. */
+	hash_hvariant_time_t stash_expire[RTE_HASH_HVARIANT_STASH_SIZE];   /**< Expiration time of stash entries. */
+	struct rte_hash_hvariant_key *stash_keys; /**< Keys and data of stash entries (after the key store). */
+
+	struct iter_partition iter_parts[RTE_HASH_HVARIANT_ITER_MAX_PARTS]; /**< Cursors of the partitioned iterator. */
 
 	char name[RTE_HASH_HVARIANT_NAMESIZE];   /**< Name of the hash. */
+	const struct rte_memzone *mz;   /**< Memzone holding this structure, found by name by find_existing(). */
+	uint64_t layout;                /**< Layout of the variant (see table_layout()), checked by find_existing(). */
 } __rte_cache_aligned;
 
 
 /* Structure that stores key-value pair */
 struct rte_hash_hvariant_key {
-	hash_key_t key;  // 128 bits
-	hash_data_t data; // 128 bits
-} __attribute__((aligned(KEY_ALIGNMENT)));
+	hash_hvariant_key_t key;  // KEY_SIZE bytes
+#if DATA_SIZE > 0
+	hash_hvariant_data_t data; // DATA_SIZE bytes
+#endif
+} __attribute__((packed, aligned(KEY_ALIGNMENT)));
+
+#if DATA_SIZE > 0
+static inline void store_data(struct rte_hash_hvariant_key *k, const hash_hvariant_data_t data){
+	k->data = data;
+}
+
+static inline void load_data(const struct rte_hash_hvariant_key *k, hash_hvariant_data_t *data){
+	*data = k->data;
+}
+#else
+static inline void store_data(__rte_unused struct rte_hash_hvariant_key *k, __rte_unused const hash_hvariant_data_t data){}
+static inline void load_data(__rte_unused const struct rte_hash_hvariant_key *k, __rte_unused hash_hvariant_data_t *data){}
+#endif
+
+
+/* Counters of the calling lcore (non-EAL threads share the last slot) */
+static inline struct rte_hash_hvariant_op_stats *
+op_stats_local(const struct rte_hash_hvariant *h)
+{
+#if OP_STATS
+	unsigned lcore_id = rte_lcore_id();
+
+	return &h->op_stats[lcore_id < RTE_MAX_LCORE ? lcore_id : RTE_MAX_LCORE].s;
+#else
+	RTE_SET_USED(h);
+	return NULL;
+#endif
+}
+
+/* Update a counter of the block returned by op_stats_local() (compiled out if counters are disabled).
+ * The slot of non-EAL threads is shared: it is updated atomically */
+#define OP_STATS_ADD(st, field, n) do { \
+	if (OP_STATS) { \
+		if (unlikely(rte_lcore_id() >= RTE_MAX_LCORE)) \
+			__sync_fetch_and_add(&(st)->field, (n)); \
+		else \
+			(st)->field += (n); \
+	} \
+} while (0)
+
+static inline void
+op_stats_lookups(const struct rte_hash_hvariant *h, uint64_t lookups, uint64_t hits)
+{
+	struct rte_hash_hvariant_op_stats *st = op_stats_local(h);
 
+	OP_STATS_ADD(st, lookups, lookups);
+	OP_STATS_ADD(st, hits, hits);
+}
+
+static inline void
+op_stats_path(const struct rte_hash_hvariant *h, uint32_t path_len)
+{
+	struct rte_hash_hvariant_op_stats *st = op_stats_local(h);
+	uint64_t max;
+
+	OP_STATS_ADD(st, cuckoo_moves, path_len);
+	if (!OP_STATS)
+		return;
+	if (likely(rte_lcore_id() < RTE_MAX_LCORE)) {
+		if (path_len > st->max_path_len)
+			st->max_path_len = path_len;
+		return;
+	}
+	max = st->max_path_len;
+	while (path_len > max && !__sync_bool_compare_and_swap(&st->max_path_len, max, path_len))
+		max = st->max_path_len;
+}
 
 #define FREE_ENTRY 0x8000
 
@@ -156,20 +400,20 @@ static inline uint64_t get_bit_in_largemask(const uint64_t * large_mask, int il)
 //	return *mask & (1ULL << i);
 //}
 
-static inline void set_bit_in_mask(uint8_t * mask, int i){
+static inline void set_bit_in_mask(bucket_mask_t * mask, int i){
 	*mask |= (1 << i);
 }
 
-static inline void unset_bit_in_mask(uint8_t * mask, int i){
+static inline void unset_bit_in_mask(bucket_mask_t * mask, int i){
 	*mask &= ~(1 << i);
 }
 
-static inline uint8_t get_bit_in_mask(const uint8_t * mask, int i){
+static inline bucket_mask_t get_bit_in_mask(const bucket_mask_t * mask, int i){
 	return *mask & (1 << i);
 }
 
-static inline void copy_bit_in_mask(uint8_t * mask_from, uint8_t * mask_to, int ifrom, int ito){
-	uint8_t v = get_bit_in_mask(mask_from,ifrom) << ito;
+static inline void copy_bit_in_mask(bucket_mask_t * mask_from, bucket_mask_t * mask_to, int ifrom, int ito){
+	bucket_mask_t v = (get_bit_in_mask(mask_from,ifrom) >> ifrom) << ito;
 	*mask_to = ((*mask_to) & ~(1 <<ito)) | v;
 }
 
@@ -177,18 +421,19 @@ __extension__
 typedef void    *MARKER[0];   /**< generic marker for a point in a structure */
 
 
-/** Bucket structure */
+/** Bucket structure. With COMPACT_BUCKET, hashes of alternative buckets are stored in a separate
+ * array (h->secondary_signatures), so that buckets with timers fit in a single cache line */
 struct rte_hash_hvariant_bucket {
 //	MARKER cacheline0 __rte_cache_min_aligned;
 
 	// Aligned entries for SIMD loading
-	uint16_t primary_signature_high[8]; // 128 bits
+	bucket_signature_t primary_signature_high[RTE_HASH_HVARIANT_BUCKET_ENTRIES]; // 64 or 128 bits
 #if TIMER
-	uint16_t expire_date_timeunit[8]; // 128 bits
+	hash_hvariant_time_t expire_date_timeunit[RTE_HASH_HVARIANT_BUCKET_ENTRIES]; // 64, 128 or 256 bits
 #endif
 
 #if BLOOM
-	 uint64_t bloom_moved; // 64 bits
+	 uint64_t bloom_moved[RTE_HASH_HVARIANT_BLOOM_WORDS]; // 64 bits (128 bits for 16-slot buckets)
 	 uint32_t count_moved_to_secondary;// 32 bits // Count the number of moved (if 0 we can reset the bloom_moved filter)
 #endif
 
@@ -196,21 +441,24 @@ struct rte_hash_hvariant_bucket {
 	 uint64_t remap_array_21x3; // Remap array: 21 entries of 3 bits each
 #endif
 
-	 // Masks: 32 bits total
-	 uint8_t mask_busy; // 0 if entry is free, 1 if entry is busy (you still have to look at expire_date to know if entry is expired).
-	 uint8_t mask_in_secondary_position; // 1 if an entry is in secondary position, 0 otherwise, used to updated count_moved and bloom filter
-	 uint8_t mask_iterated_over; // 1 if an entry as already been iterated over, 0 otherwise
-	 uint8_t mask_already_considered_for_swap; // 1 if entry is already on a the cuckoo path, 0 otherwise
+	 // Masks: 32 bits total (64 bits for 16-slot buckets)
+	 bucket_mask_t mask_busy; // 0 if entry is free, 1 if entry is busy (you still have to look at expire_date to know if entry is expired).
+	 bucket_mask_t mask_in_secondary_position; // 1 if an entry is in secondary position, 0 otherwise, used to updated count_moved and bloom filter
+	 bucket_mask_t mask_iterated_over; // 1 if an entry as already been iterated over, 0 otherwise
+	 bucket_mask_t mask_already_considered_for_swap; // 1 if entry is already on a the cuckoo path, 0 otherwise
 
-	 uint32_t secondary_signature_full[8]; // 256 bits -- Half of it is in secondary cacheline
+#if !COMPACT_BUCKET
+	 uint32_t secondary_signature_full[RTE_HASH_HVARIANT_BUCKET_ENTRIES]; // 256 bits for 8 slots -- Half of it is in secondary cacheline
+#endif
 	// The bloom filter for checking if a given key might have been moved - Derive 4 6-bit hashes directly from 32 bit secondary key. Insert them in bloom filter
 	//     False positive rate with this setting when 8 values are inserted: (1.0-e(-4*8.0/64.0))^(4) = 0.02396
 	//     False positive rate with this setting when 4 values are inserted: (1.0-e(-4*8.0/64.0))^(4) = 0.00239
 	//     False positive rate with 32-bit bloom filter and  setting when 8 values are inserted: (1.0-e(-4*8.0/32.0))^(4) = 0.16
 	//     False positive rate with 32-bit bloom filter and  setting when 4 values are inserted: (1.0-e(-4*8.0/32.0))^(4) = 0.023
+	//     16-slot buckets use two 64-bit words, selected by bit 12 of the hash, each one receiving half of the values
 
 
-} __rte_cache_aligned;
+} __rte_aligned(RTE_HASH_HVARIANT_BUCKET_ALIGN);
 
 
 /* New control structure for iterating over masks */
@@ -223,14 +471,243 @@ struct rte_hash_hvariant_bucket {
 }*/
 
 
+/*
+ * Lock-free readers (RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF)
+ *
+ * Each bucket is protected by a version counter (seqlock). The writer makes the counter odd
+ * before modifying a bucket (signatures, masks, bloom filter / remap array, or the key slots
+ * attached to it) and even again afterwards. Readers read the counters of the primary and
+ * secondary buckets, perform the lookup and check that counters did not change; otherwise
+ * the lookup is restarted. Key slots are attached to bucket positions, so a slot being reused
+ * while a reader compares it is always detected by the version of its bucket and no deferred
+ * reclamation is needed.
+ */
+static inline uint32_t lf_stripe(uint32_t bucket_idx){
+	return bucket_idx & (RTE_HASH_HVARIANT_LF_STRIPES - 1);
+}
+
+static inline uint32_t lf_version_load(const struct rte_hash_hvariant *h, uint32_t bucket_idx){
+	return *(volatile const uint32_t *)&h->lf_versions[lf_stripe(bucket_idx)];
+}
+
+/* Wait for the bucket not to be written, and return its version */
+static inline uint32_t lf_read_begin(const struct rte_hash_hvariant *h, uint32_t bucket_idx){
+	uint32_t v;
+	while(unlikely((v = lf_version_load(h, bucket_idx)) & 1))
+		_mm_pause();
+	rte_smp_rmb();
+	return v;
+}
+
+/* Return 1 if the bucket was (or is being) written since version v was read */
+static inline int lf_read_retry(const struct rte_hash_hvariant *h, uint32_t bucket_idx, uint32_t v){
+	rte_smp_rmb();
+	return ((v & 1) | (lf_version_load(h, bucket_idx) != v));
+}
+
+static inline void lf_version_inc(struct rte_hash_hvariant *h, uint32_t bucket_idx){
+	volatile uint32_t *v = &h->lf_versions[lf_stripe(bucket_idx)];
+	*v = *v + 1;
+}
+
+/* Mark buckets b1 and b2 (may be equal) as being written */
+static inline void lf_write_begin(struct rte_hash_hvariant *h, uint32_t b1, uint32_t b2){
+	/* With several writers, buckets are already locked (counters odd) by the whole operation */
+	if(h->lf_versions == NULL || h->multi_writer) return;
+	lf_version_inc(h, b1);
+	if(lf_stripe(b1) != lf_stripe(b2))
+		lf_version_inc(h, b2);
+	rte_smp_wmb();
+}
+
+static inline void lf_write_end(struct rte_hash_hvariant *h, uint32_t b1, uint32_t b2){
+	if(h->lf_versions == NULL || h->multi_writer) return;
+	rte_smp_wmb();
+	lf_version_inc(h, b1);
+	if(lf_stripe(b1) != lf_stripe(b2))
+		lf_version_inc(h, b2);
+}
+
+/*
+ * Multi-writer mode (RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD)
+ *
+ * A writer locks a version counter by making it odd with a compare-and-swap, so that locks
+ * are seen by lock-free readers as writes in progress. An operation collects all the counters
+ * it needs in a lock set (primary and secondary buckets, cuckoo path, primary bucket of an
+ * expired entry whose bloom filter is updated when its slot is reused) and locks them in
+ * increasing order, which avoids deadlocks. If the operation discovers that it needs a
+ * counter it does not hold, it adds it to the set and returns -EAGAIN: the caller releases
+ * all locks and starts again with the larger set.
+ */
+struct lf_lockset {
+	uint32_t n;                      /**< Number of counters in the set */
+	uint32_t locked;                 /**< Number of counters locked (the first ones) */
+	uint32_t stripe[LF_LOCKSET_MAX];
+};
+
+static inline void lf_lockset_init(struct lf_lockset *ls){
+	ls->n = 0;
+	ls->locked = 0;
+}
+
+static inline void lf_lockset_add_stripe(struct lf_lockset *ls, uint32_t stripe){
+	uint32_t k;
+	for(k = 0; k < ls->n; k++)
+		if(ls->stripe[k] == stripe) return;
+	if(ls->n < LF_LOCKSET_MAX)
+		ls->stripe[ls->n++] = stripe;
+}
+
+static inline void lf_lockset_add(struct lf_lockset *ls, uint32_t bucket_idx){
+	lf_lockset_add_stripe(ls, lf_stripe(bucket_idx));
+}
+
+/* Return 1 if the bucket is locked, otherwise add it to the set and return 0 */
+static inline int lf_lockset_need(struct lf_lockset *ls, uint32_t bucket_idx){
+	uint32_t k, stripe = lf_stripe(bucket_idx);
+	for(k = 0; k < ls->locked; k++)
+		if(ls->stripe[k] == stripe) return 1;
+	lf_lockset_add_stripe(ls, stripe);
+	return 0;
+}
+
+static inline void lf_lockset_lock(struct rte_hash_hvariant *h, struct lf_lockset *ls){
+	uint32_t k, l;
+
+	/* Sort counters to lock them in a global order */
+	for(k = 1; k < ls->n; k++){
+		uint32_t s = ls->stripe[k];
+		for(l = k; l > 0 && ls->stripe[l-1] > s; l--)
+			ls->stripe[l] = ls->stripe[l-1];
+		ls->stripe[l] = s;
+	}
+
+	for(k = 0; k < ls->n; k++){
+		volatile uint32_t *v = &h->lf_versions[ls->stripe[k]];
+		for(;;){
+			uint32_t cur = *v;
+			if(!(cur & 1) && rte_atomic32_cmpset(v, cur, cur + 1))
+				break;
+			_mm_pause();
+		}
+	}
+	ls->locked = ls->n;
+}
+
+static inline void lf_lockset_unlock(struct rte_hash_hvariant *h, struct lf_lockset *ls){
+	uint32_t k;
+	rte_smp_wmb();
+	for(k = 0; k < ls->locked; k++)
+		lf_version_inc(h, ls->stripe[k]);
+	ls->locked = 0;
+}
+
+/* Lock the primary and secondary buckets of a key */
+static inline void lf_lockset_lock_key(struct rte_hash_hvariant *h, struct lf_lockset *ls, uint64_t sig64){
+	lf_lockset_init(ls);
+	lf_lockset_add(ls, (uint32_t)sig64 & h->bucket_bitmask);
+	lf_lockset_add(ls, (uint32_t)(sig64 >> 32) & h->bucket_bitmask);
+	lf_lockset_lock(h, ls);
+}
+
+/* Counters added to the set since it was locked (needed for the next attempt) */
+static inline void lf_lockset_retry(struct rte_hash_hvariant *h, struct lf_lockset *ls, uint32_t prim_bucket_idx, uint32_t sec_bucket_idx){
+	uint32_t need[LF_LOCKSET_MAX];
+	uint32_t k, n_need = ls->n - ls->locked;
+
+	memcpy(need, &ls->stripe[ls->locked], n_need * sizeof(uint32_t));
+	lf_lockset_unlock(h, ls);
+	lf_lockset_init(ls);
+	lf_lockset_add(ls, prim_bucket_idx);
+	lf_lockset_add(ls, sec_bucket_idx);
+	for(k = 0; k < n_need; k++)
+		lf_lockset_add_stripe(ls, need[k]);
+}
+
+/* Update the number of busy slots. Concurrent writers count in the slot of their lcore, so that
+ * they do not share a cache line; non-EAL threads share the last slot and update it atomically */
+static inline void busy_entries_add(struct rte_hash_hvariant *h, int64_t n){
+	unsigned lcore_id;
+
+	if(h->busy_deltas == NULL){
+		h->busy_entries += n;
+		return;
+	}
+	lcore_id = rte_lcore_id();
+	if(lcore_id < RTE_MAX_LCORE)
+		h->busy_deltas[lcore_id].n += n;
+	else
+		__sync_fetch_and_add(&h->busy_deltas[RTE_MAX_LCORE].n, n);
+}
+
+/* Count busy slots: slot i of bucket b is about to be marked busy */
+static inline void busy_slot_taken(struct rte_hash_hvariant *h, const struct rte_hash_hvariant_bucket *b, int i){
+	if(!get_bit_in_mask(&b->mask_busy, i))
+		busy_entries_add(h, 1);
+}
+
+static inline void busy_slots_released(struct rte_hash_hvariant *h, uint32_t n){
+	busy_entries_add(h, -(int64_t)n);
+}
+
+/* Number of busy slots (approximate while writers run concurrently) */
+static inline uint32_t busy_entries_count(const struct rte_hash_hvariant *h){
+	int64_t n = h->busy_entries;
+	unsigned i;
+
+	if(h->busy_deltas != NULL)
+		for(i = 0; i <= RTE_MAX_LCORE; i++)
+			n += h->busy_deltas[i].n;
+	return n < 0 ? 0 : (uint32_t)n;
+}
+
+/* First word of the group masks (64 groups of ITERATOR_GROUP buckets) of partition part of the partitioned
+ * iterator: partitions own whole words, so that they can be iterated over in parallel */
+static inline uint32_t iter_partition_first_word(const struct rte_hash_hvariant *h, uint32_t part){
+	uint32_t words = h->num_buckets/ITERATOR_GROUP/64;
+	return (uint32_t)(((uint64_t)part * words + h->iter_nb_parts - 1) / h->iter_nb_parts);
+}
+
+/* Partition of the partitioned iterator holding bucket b_idx */
+static inline uint32_t iter_partition_of(const struct rte_hash_hvariant *h, uint32_t b_idx){
+	uint32_t words = h->num_buckets/ITERATOR_GROUP/64;
+	return (uint32_t)((uint64_t)(b_idx/ITERATOR_GROUP/64) * h->iter_nb_parts / words);
+}
+
+/* Move the cursors of the partitioned iterator to the first bucket of their partition */
+static inline void iter_partitions_rewind(struct rte_hash_hvariant *h){
+	for(uint32_t part=0;part<h->iter_nb_parts;part++)
+		h->iter_parts[part].next = iter_partition_first_word(h, part)*ITERATOR_GROUP*64;
+}
+
 static inline void update_iter_idx(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket * b){
 	uint32_t b_idx = b - h->buckets;
+	if(unlikely(h->multi_writer)){
+		/* Iterator state is shared by all writers */
+		uint32_t cur;
+		while((cur = *(volatile uint32_t *)&h->iter_bucket_idx) > b_idx &&
+				!rte_atomic32_cmpset(&h->iter_bucket_idx, cur, b_idx));
+		if(unlikely(h->iter_nb_parts != 0)){
+			uint32_t *next = &h->iter_parts[iter_partition_of(h, b_idx)].next;
+			while((cur = *(volatile uint32_t *)next) > b_idx &&
+					!rte_atomic32_cmpset(next, cur, b_idx));
+		}
+		__sync_fetch_and_and(&h->iter_group_bucket_mask[(b_idx/ITERATOR_GROUP) >> 6], ~(1ULL << ((b_idx/ITERATOR_GROUP) & 0x3f)));
+		return;
+	}
 	h->iter_bucket_idx = RTE_MIN(h->iter_bucket_idx, b_idx);
+	if(unlikely(h->iter_nb_parts != 0)){
+		struct iter_partition *it = &h->iter_parts[iter_partition_of(h, b_idx)];
+		it->next = RTE_MIN(it->next, b_idx);
+	}
 	unset_bit_in_largemask(h->iter_group_bucket_mask, b_idx/ITERATOR_GROUP); // Group of 8 buckets (16M
 }
 
 static inline void reset_iterator_group(struct rte_hash_hvariant *h, uint32_t group){
-	unset_bit_in_largemask(h->reset_group_bucket_mask, group);
+	if(unlikely(h->multi_writer))
+		__sync_fetch_and_and(&h->reset_group_bucket_mask[group >> 6], ~(1ULL << (group & 0x3f)));
+	else
+		unset_bit_in_largemask(h->reset_group_bucket_mask, group);
 
 #ifdef FAST_RESET_ITERATOR
 	for(uint32_t i=group*ITERATOR_GROUP;i<(group+1)*ITERATOR_GROUP;i++){
@@ -239,52 +716,141 @@ static inline void reset_iterator_group(struct rte_hash_hvariant *h, uint32_t gr
 #endif
 }
 
+/* Load the 16-bit signatures or timers of a bucket of 4 or 8 slots in an SSE register
+ * (for 4 slots, the upper lanes are zero and are discarded by the slot masks) */
+#if BUCKET_ENTRIES == 4
+#define load_bucket_lanes(p) _mm_loadl_epi64((const __m128i*)(p))
+#else
+#define load_bucket_lanes(p) _mm_load_si128((const __m128i*)(p))
+#endif
+
+#if BUCKET_ENTRIES == 16
+/* Slots whose 8-bit signature matches the hash */
+static inline uint32_t signature_matches_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash){
+	__m128i ref_hashes = _mm_set1_epi8(signature_high(hash));
+	__m128i bucket_hashes = _mm_load_si128((__m128i*)&b->primary_signature_high);
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+	return _mm_cmpeq_epi8_mask(bucket_hashes,ref_hashes);
+#else
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(bucket_hashes,ref_hashes));
+#endif
+}
+#else
+/* Slots whose 16-bit signature matches the hash */
+static inline uint32_t signature_matches_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash){
+	__m128i ref_hashes = _mm_set1_epi16(signature_high(hash));
+	__m128i eq_hash = _mm_cmpeq_epi16(load_bucket_lanes(&b->primary_signature_high),ref_hashes);
+
+	return _mm_movemask_epi8(_mm_packs_epi16(eq_hash, eq_hash)) & ENTRIES_MASK;
+}
+#endif
+
 #if TIMER
-static inline int free_or_expired(const struct rte_hash_hvariant_bucket* b, int i, uint16_t currentTime){
+static inline int free_or_expired(const struct rte_hash_hvariant_bucket* b, int i, hash_hvariant_time_t currentTime){
 	int expired=expired_timer(b->expire_date_timeunit[i],currentTime);
 	return (!get_bit_in_mask(&b->mask_busy,i))|| expired;
 }
 
-static inline int matches_and_not_expired(const struct rte_hash_hvariant_bucket* b, int i, uint32_t hash, uint16_t currentTime){
+static inline int matches_and_not_expired(const struct rte_hash_hvariant_bucket* b, int i, uint32_t hash, hash_hvariant_time_t currentTime){
 	int expired=expired_timer(b->expire_date_timeunit[i],currentTime);
-	return (b->primary_signature_high[i] == (hash >> 16)) && get_bit_in_mask(&b->mask_busy,i) && !expired;
+	return (b->primary_signature_high[i] == signature_high(hash)) && get_bit_in_mask(&b->mask_busy,i) && !expired;
 }
 
-static inline uint32_t matches_and_not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash, uint16_t currentTime){
-	__m128i current_time_simd = _mm_set1_epi16(currentTime);
-	__m128i ref_hashes = _mm_set1_epi16(hash >> 16);
+#if TIMER_BITS == 32
+/* Slots whose timer is not expired: the 8 timers (256 bits) are compared at once with AVX2 (two SSE
+ * compares without AVX2), the 4 timers of 4-slot buckets with SSE */
+static inline uint32_t not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, hash_hvariant_time_t currentTime){
+#if BUCKET_ENTRIES == 4
+	__m128i current_time_simd = _mm_set1_epi32(timer_biased_time(currentTime));
+	__m128i diff_time = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&b->expire_date_timeunit),current_time_simd);
+	__m128i non_expired = _mm_cmpgt_epi32(_mm_set1_epi32(TIMER_BIASED_MAX_EXPIRATION),diff_time);
+
+	return _mm_movemask_ps(_mm_castsi128_ps(non_expired));
+#elif defined(__AVX2__)
+	__m256i current_time_simd = _mm256_set1_epi32(timer_biased_time(currentTime));
+	__m256i diff_time = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&b->expire_date_timeunit),current_time_simd);
+	__m256i non_expired = _mm256_cmpgt_epi32(_mm256_set1_epi32(TIMER_BIASED_MAX_EXPIRATION),diff_time);
+
+	return _mm256_movemask_ps(_mm256_castsi256_ps(non_expired));
+#else
+	__m128i current_time_simd = _mm_set1_epi32(timer_biased_time(currentTime));
+	__m128i max_expiration_time = _mm_set1_epi32(TIMER_BIASED_MAX_EXPIRATION);
+	__m128i diff_lo = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&b->expire_date_timeunit[0]),current_time_simd);
+	__m128i diff_hi = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&b->expire_date_timeunit[4]),current_time_simd);
 
-	__m128i bucket_hashes = _mm_load_si128((__m128i*)&b->primary_signature_high);
-	__m128i bucket_expiration = _mm_load_si128((__m128i*)&b->expire_date_timeunit);
+	return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(max_expiration_time,diff_lo))) |
+		(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(max_expiration_time,diff_hi))) << 4);
+#endif
+}
+#elif BUCKET_ENTRIES == 16
+/* Slots whose timer is not expired: the 16 timers (256 bits) are compared at once with AVX2 */
+static inline uint32_t not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, hash_hvariant_time_t currentTime){
+#if defined(__AVX2__)
+	__m256i current_time_simd = _mm256_set1_epi16(timer_biased_time(currentTime));
+	__m256i max_expiration_time = _mm256_set1_epi16(TIMER_BIASED_MAX_EXPIRATION);
+	__m256i bucket_expiration = _mm256_loadu_si256((__m256i*)&b->expire_date_timeunit);
+	__m256i diff_time = _mm256_sub_epi16(bucket_expiration,current_time_simd);
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+	return _mm256_cmpgt_epi16_mask(max_expiration_time,diff_time);
+#else
+	__m256i non_expired = _mm256_cmpgt_epi16(max_expiration_time,diff_time);
+	__m128i non_expired_8bit = _mm_packs_epi16(_mm256_castsi256_si128(non_expired), _mm256_extracti128_si256(non_expired, 1));
+
+	return _mm_movemask_epi8(non_expired_8bit);
+#endif
+#else
+	__m128i current_time_simd = _mm_set1_epi16(timer_biased_time(currentTime));
+	__m128i max_expiration_time = _mm_set1_epi16(TIMER_BIASED_MAX_EXPIRATION);
+	__m128i diff_lo = _mm_sub_epi16(_mm_load_si128((__m128i*)&b->expire_date_timeunit[0]),current_time_simd);
+	__m128i diff_hi = _mm_sub_epi16(_mm_load_si128((__m128i*)&b->expire_date_timeunit[8]),current_time_simd);
+	__m128i non_expired_8bit = _mm_packs_epi16(_mm_cmpgt_epi16(max_expiration_time,diff_lo), _mm_cmpgt_epi16(max_expiration_time,diff_hi));
+
+	return _mm_movemask_epi8(non_expired_8bit);
+#endif
+}
+#else
+/* Slots whose timer is not expired (16-bit timers of a bucket of 4 or 8 slots) */
+static inline uint32_t not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, hash_hvariant_time_t currentTime){
+	__m128i current_time_simd = _mm_set1_epi16(timer_biased_time(currentTime));
+	__m128i diff_time = _mm_sub_epi16(load_bucket_lanes(&b->expire_date_timeunit),current_time_simd);
+	__m128i non_expired = _mm_cmpgt_epi16(_mm_set1_epi16(TIMER_BIASED_MAX_EXPIRATION),diff_time);
+
+	return _mm_movemask_epi8(_mm_packs_epi16(non_expired, non_expired)) & ENTRIES_MASK;
+}
+#endif
+
+#if TIMER_BITS == 16 && BUCKET_ENTRIES != 16
+static inline uint32_t matches_and_not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash, hash_hvariant_time_t currentTime){
+	__m128i current_time_simd = _mm_set1_epi16(timer_biased_time(currentTime));
+	__m128i ref_hashes = _mm_set1_epi16(signature_high(hash));
+
+	__m128i bucket_hashes = load_bucket_lanes(&b->primary_signature_high);
+	__m128i bucket_expiration = load_bucket_lanes(&b->expire_date_timeunit);
 
 	__m128i eq_hash = _mm_cmpeq_epi16(bucket_hashes,ref_hashes);
 	__m128i diff_time = _mm_sub_epi16(bucket_expiration,current_time_simd);
-	__m128i non_expired = _mm_cmpgt_epi16(max_expiration_time,diff_time);
+	__m128i non_expired = _mm_cmpgt_epi16(_mm_set1_epi16(TIMER_BIASED_MAX_EXPIRATION),diff_time);
 
 	__m128i matches = _mm_and_si128(eq_hash,non_expired);
 	__m128i matches_8bit = _mm_packs_epi16(matches, matches);
 
 	return _mm_movemask_epi8(matches_8bit) & b->mask_busy;
 }
+#else
+static inline uint32_t matches_and_not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash, hash_hvariant_time_t currentTime){
+	return signature_matches_maskpos(b, hash) & not_expired_maskpos(b, currentTime) & b->mask_busy;
+}
+#endif
 
-static inline uint32_t free_or_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint16_t currentTime){
-	__m128i current_time_simd = _mm_set1_epi16(currentTime);
-	__m128i bucket_expiration = _mm_load_si128((__m128i*)&b->expire_date_timeunit);
-
-	__m128i diff_time = _mm_sub_epi16(bucket_expiration,current_time_simd);
-	__m128i expired_lt = _mm_cmplt_epi16(max_expiration_time,diff_time);
-	__m128i expired_eq = _mm_cmpeq_epi16(max_expiration_time,diff_time);
-	__m128i expired = _mm_or_si128(expired_lt,expired_eq);
-	__m128i expired_8bit = _mm_packs_epi16(expired, expired);
-
-	return ( _mm_movemask_epi8(expired_8bit) | ~b->mask_busy) & ENTRIES_MASK;
+static inline uint32_t free_or_expired_maskpos(const struct rte_hash_hvariant_bucket* b, hash_hvariant_time_t currentTime){
+	return (~not_expired_maskpos(b, currentTime) | ~b->mask_busy) & ENTRIES_MASK;
 }
 
-static inline void update_timer(struct rte_hash_hvariant_bucket * b, int i, uint16_t expirationTime){
+static inline void update_timer(struct rte_hash_hvariant_bucket * b, int i, hash_hvariant_time_t expirationTime){
 	b->expire_date_timeunit[i] = expirationTime;
 }
 
-static inline void update_timer_if_needed(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, int i, uint16_t newExpirationTime, int updateExpirationTime, int ret_not_mask, int * ret, uint64_t *mask, int32_t mask_pos){
+static inline void update_timer_if_needed(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, int i, hash_hvariant_time_t newExpirationTime, int updateExpirationTime, int ret_not_mask, int * ret, uint64_t *mask, int32_t mask_pos){
 	if (updateExpirationTime){
 		if(b->expire_date_timeunit[i] != newExpirationTime){
 			b->expire_date_timeunit[i]=newExpirationTime;
@@ -303,30 +869,36 @@ static inline void update_timer_if_needed(struct rte_hash_hvariant * h, struct r
 }
 
 #else
-static inline int free_or_expired(const struct rte_hash_hvariant_bucket* b, int i, __rte_unused uint16_t currentTime){
+static inline int free_or_expired(const struct rte_hash_hvariant_bucket* b, int i, __rte_unused hash_hvariant_time_t currentTime){
 	return (!get_bit_in_mask(&b->mask_busy,i));
 }
 
-static inline int matches_and_not_expired(const struct rte_hash_hvariant_bucket* b, int i, uint32_t hash, __rte_unused uint16_t currentTime){
-	return (b->primary_signature_high[i] == (hash >> 16)) && get_bit_in_mask(&b->mask_busy,i);
+static inline int matches_and_not_expired(const struct rte_hash_hvariant_bucket* b, int i, uint32_t hash, __rte_unused hash_hvariant_time_t currentTime){
+	return (b->primary_signature_high[i] == signature_high(hash)) && get_bit_in_mask(&b->mask_busy,i);
 }
 
-static inline uint32_t matches_and_not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash, __rte_unused uint16_t currentTime){
-	__m128i ref_hashes = _mm_set1_epi16(hash >> 16);
-	__m128i bucket_hashes = _mm_load_si128((__m128i*)&b->primary_signature_high);
+#if BUCKET_ENTRIES == 16
+static inline uint32_t matches_and_not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash, __rte_unused hash_hvariant_time_t currentTime){
+	return signature_matches_maskpos(b, hash) & b->mask_busy;
+}
+#else
+static inline uint32_t matches_and_not_expired_maskpos(const struct rte_hash_hvariant_bucket* b, uint32_t hash, __rte_unused hash_hvariant_time_t currentTime){
+	__m128i ref_hashes = _mm_set1_epi16(signature_high(hash));
+	__m128i bucket_hashes = load_bucket_lanes(&b->primary_signature_high);
 	__m128i eq_hash = _mm_cmpeq_epi16(bucket_hashes,ref_hashes);
 	__m128i matches_8bit = _mm_packs_epi16(eq_hash, eq_hash);
 
 	return _mm_movemask_epi8(matches_8bit) & b->mask_busy;
 }
+#endif
 
-static inline uint32_t free_or_expired_maskpos(const struct rte_hash_hvariant_bucket* b, __rte_unused uint16_t currentTime){
+static inline uint32_t free_or_expired_maskpos(const struct rte_hash_hvariant_bucket* b, __rte_unused hash_hvariant_time_t currentTime){
 	return (~b->mask_busy) & ENTRIES_MASK;
 }
 
-static inline void update_timer(__rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused int i, __rte_unused uint16_t expirationTime){}
+static inline void update_timer(__rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused int i, __rte_unused hash_hvariant_time_t expirationTime){}
 
-static inline void update_timer_if_needed(__rte_unused struct rte_hash_hvariant * h, __rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused int i, __rte_unused uint16_t newExpirationTime, __rte_unused int updateExpirationTime, __rte_unused int ret_not_mask, __rte_unused int * ret, __rte_unused uint64_t *mask, __rte_unused int32_t mask_pos){}
+static inline void update_timer_if_needed(__rte_unused struct rte_hash_hvariant * h, __rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused int i, __rte_unused hash_hvariant_time_t newExpirationTime, __rte_unused int updateExpirationTime, __rte_unused int ret_not_mask, __rte_unused int * ret, __rte_unused uint64_t *mask, __rte_unused int32_t mask_pos){}
 
 #endif
 
@@ -378,7 +950,7 @@ static inline void horton_set_hindex(struct rte_hash_hvariant_bucket * b, uint32
 }
 
 /* Return 1 if all are full */
-static inline uint32_t horton_choose_hindex(struct rte_hash_hvariant * h, uint32_t prim_hash, uint32_t sec_hash, uint16_t currentTime){
+static inline uint32_t horton_choose_hindex(struct rte_hash_hvariant * h, uint32_t prim_hash, uint32_t sec_hash, hash_hvariant_time_t currentTime){
 	uint32_t i;
 	uint32_t hindex = 0;
 	uint32_t free_at_hindex = 0;
@@ -400,7 +972,7 @@ static inline uint32_t horton_tag(__rte_unused uint32_t sec_hash){return 0;}
 static inline uint32_t horton_sec_hash(__rte_unused struct rte_hash_hvariant * h, __rte_unused uint32_t prim_hash, __rte_unused uint32_t sec_hash, __rte_unused uint32_t hindex){return 0;}
 static inline uint32_t horton_get_hindex(__rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused uint32_t sec_hash){return 0;}
 static inline void horton_set_hindex(__rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused uint32_t sec_hash, __rte_unused uint32_t hindex){}
-static inline uint32_t horton_choose_hindex(__rte_unused struct rte_hash_hvariant * h, __rte_unused uint32_t prim_hash, __rte_unused uint32_t sec_hash, __rte_unused uint16_t currentTime){return 0;}
+static inline uint32_t horton_choose_hindex(__rte_unused struct rte_hash_hvariant * h, __rte_unused uint32_t prim_hash, __rte_unused uint32_t sec_hash, __rte_unused hash_hvariant_time_t currentTime){return 0;}
 
 #endif
 
@@ -408,30 +980,140 @@ static inline uint32_t primary_signature(struct rte_hash_hvariant * h, struct rt
 	return ((b->primary_signature_high[i] << 16) | (b - h->buckets));
 }
 
+/* Bits of the hashes of an entry that are kept in buckets (primary_signature() restores the bucket
+ * index bits and the signature bits: with 8-bit signatures and less than 2^24 buckets, the high
+ * bits are lost and hashes computed from moved entries only match on these bits) */
+static inline uint64_t signature_bits64(const struct rte_hash_hvariant * h){
+	uint64_t bits = ((1ULL << (16 + RTE_HASH_HVARIANT_SIGNATURE_BITS)) - 1) | h->bucket_bitmask;
+	return bits | (bits << 32);
+}
+
+/* Full hash of the alternative bucket of slot i of bucket b (lvalue). Only writers need it: compact
+ * buckets keep these hashes in a separate array so that lookups read a single cache line per bucket */
+#if COMPACT_BUCKET
+#define secondary_signature(h,b,i) ((h)->secondary_signatures[((b) - (h)->buckets) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + (i)])
+#else
+#define secondary_signature(h,b,i) ((b)->secondary_signature_full[i])
+#endif
+
+/* Index of the secondary bucket that lookups check for a key (for horton, it depends on the
+ * remap entry of the primary bucket, that must be read under the primary bucket version) */
+static inline uint32_t lf_secondary_bucket_idx(struct rte_hash_hvariant *h, uint64_t sig64){
+	uint32_t sec_hash = sig64 >> 32;
+#if HORTON
+	uint32_t hindex = horton_get_hindex(&h->buckets[(uint32_t)sig64 & h->bucket_bitmask], sec_hash);
+	if(hindex != 0)
+		sec_hash = horton_sec_hash(h, sig64, sec_hash, hindex);
+#endif
+	return sec_hash & h->bucket_bitmask;
+}
+
+
+
+/* Layout of the tables of this variant. A table found by name may have been created by another
+ * variant (or by a process built with other parameters), that must not be used with this code */
+static inline uint64_t
+table_layout(void)
+{
+	return (uint64_t)KEY_SIZE | (uint64_t)DATA_SIZE << 8 | (uint64_t)RTE_HASH_HVARIANT_BUCKET_ENTRIES << 16 |
+		(uint64_t)TIMER_BITS << 24 | (uint64_t)sizeof(struct rte_hash_hvariant_bucket) << 32 |
+		(uint64_t)((BLOOM ? 1 : 0) | (HORTON ? 2 : 0) | (TIMER ? 4 : 0) | (COMPACT_BUCKET ? 8 : 0)) << 48;
+}
+
+/* Name of the memzone holding the structure of table name. Returns -ENAMETOOLONG if it does not fit */
+static int
+table_memzone_name(char *mz_name, const char *name)
+{
+	int ret = snprintf(mz_name, RTE_MEMZONE_NAMESIZE, "HT_%s", name);
+
+	if (ret < 0 || ret >= RTE_MEMZONE_NAMESIZE)
+		return -ENAMETOOLONG;
+	return 0;
+}
+
+/* Allocate the arrays of a table with num_buckets buckets (buckets, key store and iterator masks).
+ * Returns -ENOMEM (nothing allocated) on failure */
+static int
+alloc_table_arrays(struct rte_hash_hvariant *t, uint32_t num_buckets, int socket_id)
+{
+	const uint32_t key_entry_size = sizeof(struct rte_hash_hvariant_key);
+	const uint32_t num_key_slots = num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES +1 ; // Include one padding key slot as reads during batched lookups can read some dummy information
+	const uint64_t hash_key_tbl_size = (uint64_t) key_entry_size * (num_key_slots + RTE_HASH_HVARIANT_STASH_SIZE); // Stash entries are stored after the key slots
+
+	t->buckets = rte_zmalloc_socket(NULL,
+				num_buckets * sizeof(struct rte_hash_hvariant_bucket),
+				RTE_CACHE_LINE_SIZE, socket_id);
+	t->key_store = rte_zmalloc_socket(NULL, hash_key_tbl_size,
+			RTE_CACHE_LINE_SIZE, socket_id);
+	t->iter_group_bucket_mask = rte_zmalloc_socket(NULL, num_buckets/ITERATOR_GROUP/64*sizeof(uint64_t),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	t->reset_group_bucket_mask = rte_zmalloc_socket(NULL, num_buckets/ITERATOR_GROUP/64*sizeof(uint64_t),
+			RTE_CACHE_LINE_SIZE, socket_id);
+#if COMPACT_BUCKET
+	t->secondary_signatures = rte_zmalloc_socket(NULL, (uint64_t)num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES * sizeof(uint32_t),
+			RTE_CACHE_LINE_SIZE, socket_id);
+#else
+	t->secondary_signatures = NULL;
+#endif
+
+	if (t->buckets == NULL || t->key_store == NULL ||
+	    t->iter_group_bucket_mask == NULL || t->reset_group_bucket_mask == NULL ||
+	    (COMPACT_BUCKET && t->secondary_signatures == NULL)) {
+		rte_free(t->buckets);
+		rte_free(t->key_store);
+		rte_free(t->iter_group_bucket_mask);
+		rte_free(t->reset_group_bucket_mask);
+		rte_free(t->secondary_signatures);
+		return -ENOMEM;
+	}
+
+	t->entries = num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+	t->num_buckets = num_buckets;
+	t->bucket_bitmask = num_buckets - 1;
+	t->iter_bucket_idx = 0;
+	iter_partitions_rewind(t);
+	t->busy_entries = 0;
+	t->last_path_len = 0;
+	t->stash_keys = t->key_store + num_key_slots;
+	t->stash_mask = 0;
+	t->stash_iterated = 0;
+	t->grow_threshold = t->grow_load_pct ? (uint32_t)((uint64_t)t->entries * t->grow_load_pct / 100) : UINT32_MAX;
+	return 0;
+}
+
+static void
+free_table_arrays(struct rte_hash_hvariant *t)
+{
+	rte_free(t->key_store);
+	rte_free(t->buckets);
+	rte_free(t->iter_group_bucket_mask);
+	rte_free(t->reset_group_bucket_mask);
+	rte_free(t->secondary_signatures);
+}
 
+/* Drop the filters rebuilt by bloom_scrub() (they no longer match the arrays of the table) */
+static void
+bloom_scrub_abort(struct rte_hash_hvariant *h)
+{
+	rte_free(h->scrub_filters);
+	h->scrub_filters = NULL;
+	h->scrub_next = 0;
+	h->scrub_installing = 0;
+}
 
 struct rte_hash_hvariant *
 H(rte_hash,create)(const struct rte_hash_hvariant_parameters *params)
 {
 	struct rte_hash_hvariant *h = NULL;
-	char hash_name[RTE_HASH_HVARIANT_NAMESIZE];
-	void *k = NULL;
-	void *buckets = NULL;
-	void *iter_group_mask = NULL;
-	void *reset_group_mask = NULL;
-	/**
-	 * Initialize AVX constants
-	 */
-	max_expiration_time = _mm_set1_epi16(RTE_HASH_HVARIANT_MAX_EXPIRATION_PERIOD);
-
-
+	const struct rte_memzone *mz;
+	char mz_name[RTE_MEMZONE_NAMESIZE];
+	void *lf_versions = NULL;
 	/**
 	 * Check that some invariants are valid
 	 *  Altering this requires to alter the rest of the code (key computation, ...)
 	 */
-	assert(sizeof(hash_key_t) == 16); // i.e., key is _m128i type
-	assert(sizeof(hash_data_t) == 16); // i.e., data is _m128i type
-	//assert(RTE_HASH_HVARIANT_BUCKET_ENTRIES == 8); // i.e., number of bucket entries is exactly eight (for coherency with 8-bit  bitmasks)
+	assert(sizeof(hash_hvariant_key_t) == KEY_SIZE);
+	assert(DATA_SIZE == 0 || sizeof(hash_hvariant_data_t) == DATA_SIZE);
 
 
 
@@ -443,121 +1125,444 @@ H(rte_hash,create)(const struct rte_hash_hvariant_parameters *params)
 	/* Check for valid parameters */
 	if ((params->entries > RTE_HASH_HVARIANT_ENTRIES_MAX) ||
 			(params->entries < RTE_HASH_HVARIANT_BUCKET_ENTRIES) ||
+			(params->grow_load_pct > 100) ||
 			!rte_is_power_of_2(RTE_HASH_HVARIANT_BUCKET_ENTRIES) ) {
 		rte_errno = EINVAL;
 		RTE_LOG(ERR, HASH, "rte_hash_hvariant_create has invalid parameters\n");
 		return NULL;
 	}
 
+	if (HORTON && (params->extra_flag & RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD)) {
+		/* Secondary buckets of horton tables depend on remap entries, that could change between locking and insertion */
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_create multi-writer mode is not supported by horton tables\n");
+		return NULL;
+	}
 
-	snprintf(hash_name, sizeof(hash_name), "HT_%s", params->name);
+	if ((params->grow_load_pct || params->grow_path_len) &&
+	    (HORTON || (params->extra_flag & (RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF | RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD)))) {
+		/* Horton secondary buckets depend on the number of buckets, and concurrent
+		 * readers could use old arrays while they are freed */
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_create automatic growth is not supported by horton or concurrent tables\n");
+		return NULL;
+	}
 
-	h = (struct rte_hash_hvariant *)rte_zmalloc_socket(hash_name, sizeof(struct rte_hash_hvariant),
-					RTE_CACHE_LINE_SIZE, params->socket_id);
 
-	if (h == NULL) {
-		RTE_LOG(ERR, HASH, "memory allocation failed\n");
-		goto err;
+	if (params->name == NULL || table_memzone_name(mz_name, params->name) < 0) {
+		rte_errno = ENAMETOOLONG;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_create has no name or a too long name\n");
+		return NULL;
 	}
 
-	const uint32_t num_buckets = RTE_MAX( 65536u , rte_align32pow2(params->entries) / RTE_HASH_HVARIANT_BUCKET_ENTRIES);
-
-	buckets = rte_zmalloc_socket(NULL,
-				num_buckets * sizeof(struct rte_hash_hvariant_bucket),
-				RTE_CACHE_LINE_SIZE, params->socket_id);
+	/* The structure is in a named memzone so that other processes can find the table. Its
+	 * arrays are allocated from the DPDK heap, that secondary processes map at the same
+	 * addresses, so that the pointers it holds are valid in all processes */
+	mz = rte_memzone_reserve_aligned(mz_name, sizeof(struct rte_hash_hvariant),
+					params->socket_id, 0, RTE_CACHE_LINE_SIZE);
 
-	if (buckets == NULL) {
-		RTE_LOG(ERR, HASH, "memory allocation failed\n");
-		goto err;
+	if (mz == NULL) {
+		RTE_LOG(ERR, HASH, "memzone reservation failed\n");
+		return NULL;
 	}
+	h = (struct rte_hash_hvariant *)mz->addr;
+	memset(h, 0, sizeof(struct rte_hash_hvariant));
+	h->mz = mz;
 
-	const uint32_t key_entry_size = sizeof(struct rte_hash_hvariant_key);
-	const uint32_t num_key_slots = num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES +1 ; // Include one padding key slot as reads during batched lookups can read some dummy information
-	const uint64_t hash_key_tbl_size = (uint64_t) key_entry_size * num_key_slots;
+	h->grow_load_pct = params->grow_load_pct;
+	h->grow_path_len = params->grow_path_len;
+	h->auto_grow = (params->grow_load_pct || params->grow_path_len);
 
-	k = rte_zmalloc_socket(NULL, hash_key_tbl_size,
-			RTE_CACHE_LINE_SIZE, params->socket_id);
+	const uint32_t num_buckets = RTE_MAX( RTE_HASH_HVARIANT_MIN_BUCKETS , rte_align32pow2(params->entries) / RTE_HASH_HVARIANT_BUCKET_ENTRIES);
 
-	if (k == NULL) {
+	if (alloc_table_arrays(h, num_buckets, params->socket_id) < 0) {
 		RTE_LOG(ERR, HASH, "memory allocation failed\n");
-		goto err;
+		rte_errno = ENOMEM;
+		rte_memzone_free(mz);
+		return NULL;
 	}
 
-	iter_group_mask = rte_zmalloc_socket(NULL, num_buckets/ITERATOR_GROUP/64*sizeof(uint64_t),
-			RTE_CACHE_LINE_SIZE, params->socket_id);
+	if (params->extra_flag & (RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF | RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD)) {
+		lf_versions = rte_zmalloc_socket(NULL, RTE_HASH_HVARIANT_LF_STRIPES * sizeof(uint32_t),
+				RTE_CACHE_LINE_SIZE, params->socket_id);
 
-	if (iter_group_mask == NULL) {
-		RTE_LOG(ERR, HASH, "memory allocation failed\n");
-		goto err;
+		if (lf_versions == NULL) {
+			RTE_LOG(ERR, HASH, "memory allocation failed\n");
+			goto err;
+		}
 	}
 
 
-	reset_group_mask = rte_zmalloc_socket(NULL, num_buckets/ITERATOR_GROUP/64*sizeof(uint64_t),
+	if (params->extra_flag & RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD) {
+		h->busy_deltas = rte_zmalloc_socket(NULL, (RTE_MAX_LCORE + 1) * sizeof(struct busy_delta_slot),
 				RTE_CACHE_LINE_SIZE, params->socket_id);
-
-		if (reset_group_mask == NULL) {
+		if (h->busy_deltas == NULL) {
 			RTE_LOG(ERR, HASH, "memory allocation failed\n");
 			goto err;
 		}
+	}
 
-
+#if OP_STATS
+	h->op_stats = rte_zmalloc_socket(NULL, (RTE_MAX_LCORE + 1) * sizeof(struct op_stats_slot),
+			RTE_CACHE_LINE_SIZE, params->socket_id);
+	if (h->op_stats == NULL) {
+		RTE_LOG(ERR, HASH, "memory allocation failed\n");
+		goto err;
+	}
+#endif
 
 	/* Setup hash context */
 	snprintf(h->name, sizeof(h->name), "%s", params->name);
-	h->entries = num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
-
-	h->num_buckets = num_buckets;
-	h->bucket_bitmask = h->num_buckets - 1;
-	h->buckets = buckets;
-	h->key_store = k;
-	h->iter_group_bucket_mask = iter_group_mask;
-	h->reset_group_bucket_mask = reset_group_mask;
+	h->socket_id = params->socket_id;
+	h->lf_versions = lf_versions;
+	h->extra_flag = params->extra_flag;
+	h->multi_writer = !!(params->extra_flag & RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD);
+	h->layout = table_layout();
 
 	H(rte_hash,reset)(h);
 
 	return h;
 err:
-	rte_free(h);
-	rte_free(buckets);
-	rte_free(k);
-	rte_free(iter_group_mask);
-	rte_free(reset_group_mask);
+	free_table_arrays(h);
+	rte_free(lf_versions);
+	rte_free(h->busy_deltas);
+	rte_errno = ENOMEM;
+	rte_memzone_free(mz);
 	return NULL;
 }
 
-void
-H(rte_hash,free)(struct rte_hash_hvariant *h)
+struct rte_hash_hvariant *
+H(rte_hash,find_existing)(const char *name)
+{
+	struct rte_hash_hvariant *h;
+	const struct rte_memzone *mz;
+	char mz_name[RTE_MEMZONE_NAMESIZE];
+
+	if (name == NULL || table_memzone_name(mz_name, name) < 0) {
+		rte_errno = ENOENT;
+		return NULL;
+	}
+
+	mz = rte_memzone_lookup(mz_name);
+	if (mz == NULL) {
+		rte_errno = ENOENT;
+		return NULL;
+	}
+
+	h = (struct rte_hash_hvariant *)mz->addr;
+	if (h->layout != table_layout()) {
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_find_existing: %s is a table of another variant\n", name);
+		return NULL;
+	}
+	return h;
+}
+
+void
+H(rte_hash,free)(struct rte_hash_hvariant *h)
 {
 
 	if (h == NULL)
 		return;
 
-	rte_free(h->key_store);
-	rte_free(h->buckets);
-	rte_free(h->iter_group_bucket_mask);
-	rte_free(h->reset_group_bucket_mask);
-	rte_free(h);
+	if (h->resize_src != NULL) {
+		free_table_arrays(h->resize_src);
+		rte_free(h->resize_src);
+	}
+	free_table_arrays(h);
+	rte_free(h->scrub_filters);
+	rte_free(h->lf_versions);
+	rte_free(h->busy_deltas);
+	rte_free(h->op_stats);
+	rte_memzone_free(h->mz);
+}
+
+
+/******************************************************************************************
+ * NUMA-replicated tables
+ ******************************************************************************************/
+
+/* Replicated table: one full table per NUMA socket with lcores. Writes are applied to every
+ * replica in turn, lookups use the replica of the socket of the calling lcore */
+struct rte_hash_hvariant_replicated {
+	uint32_t nb_replicas;
+	struct rte_hash_hvariant *replicas[RTE_MAX_NUMA_NODES];    /**< Replicas, by creation order. */
+	struct rte_hash_hvariant *by_socket[RTE_MAX_NUMA_NODES];   /**< Replica used by the lcores of each socket. */
+} __rte_cache_aligned;
+
+/* Replica local to the calling lcore (the first one for sockets without replica or non-EAL threads) */
+static inline struct rte_hash_hvariant *
+replicated_local(const struct rte_hash_hvariant_replicated *r)
+{
+	unsigned socket_id = rte_socket_id();
+
+	return likely(socket_id < RTE_MAX_NUMA_NODES) ? r->by_socket[socket_id] : r->replicas[0];
+}
+
+struct rte_hash_hvariant_replicated *
+H(rte_hash,replicated_create)(const struct rte_hash_hvariant_parameters *params)
+{
+	struct rte_hash_hvariant_replicated *r;
+	struct rte_hash_hvariant_parameters p;
+	char name[RTE_HASH_HVARIANT_NAMESIZE];
+	unsigned lcore_id, s = 0;
+	uint32_t i;
+	int ret;
+
+	/* Concurrent writers could apply their writes in a different order to each replica */
+	if (params == NULL || params->name == NULL ||
+	    (params->extra_flag & RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD)) {
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_replicated_create has invalid parameters\n");
+		return NULL;
+	}
+
+	r = rte_zmalloc(NULL, sizeof(struct rte_hash_hvariant_replicated), RTE_CACHE_LINE_SIZE);
+	if (r == NULL) {
+		rte_errno = ENOMEM;
+		RTE_LOG(ERR, HASH, "memory allocation failed\n");
+		return NULL;
+	}
+
+	p = *params;
+	p.name = name;
+	RTE_LCORE_FOREACH(lcore_id) {
+		s = rte_lcore_to_socket_id(lcore_id);
+		if (s >= RTE_MAX_NUMA_NODES || r->by_socket[s] != NULL)
+			continue;
+
+		/* A truncated suffix would give the same name (and memzone) to several replicas */
+		ret = snprintf(name, sizeof(name), "%s.%u", params->name, s);
+		if (ret < 0 || ret >= (int)sizeof(name)) {
+			RTE_LOG(ERR, HASH, "rte_hash_hvariant_replicated_create: name %s is too long\n", params->name);
+			rte_errno = ENAMETOOLONG;
+			goto err;
+		}
+		p.socket_id = s;
+		r->by_socket[s] = H(rte_hash,create)(&p);
+		if (r->by_socket[s] == NULL)
+			goto err;
+		r->replicas[r->nb_replicas++] = r->by_socket[s];
+	}
+
+	if (r->nb_replicas == 0) {
+		rte_errno = EINVAL;
+		goto err;
+	}
+
+	for (s = 0; s < RTE_MAX_NUMA_NODES; s++)
+		if (r->by_socket[s] == NULL)
+			r->by_socket[s] = r->replicas[0];
+
+	return r;
+err:
+	RTE_LOG(ERR, HASH, "rte_hash_hvariant_replicated_create failed to create replica on socket %u\n", s);
+	for (i = 0; i < r->nb_replicas; i++)
+		H(rte_hash,free)(r->replicas[i]);
+	rte_free(r);
+	return NULL;
+}
+
+void
+H(rte_hash,replicated_free)(struct rte_hash_hvariant_replicated *r)
+{
+	uint32_t i;
+
+	if (r == NULL)
+		return;
+
+	for (i = 0; i < r->nb_replicas; i++)
+		H(rte_hash,free)(r->replicas[i]);
+	rte_free(r);
+}
+
+void
+H(rte_hash,replicated_reset)(struct rte_hash_hvariant_replicated *r)
+{
+	uint32_t i;
+
+	for (i = 0; i < r->nb_replicas; i++)
+		H(rte_hash,reset)(r->replicas[i]);
+}
+
+struct rte_hash_hvariant *
+H(rte_hash,replicated_get)(const struct rte_hash_hvariant_replicated *r, int socket_id)
+{
+	if (socket_id == SOCKET_ID_ANY)
+		return replicated_local(r);
+	if (socket_id < 0 || socket_id >= RTE_MAX_NUMA_NODES)
+		return NULL;
+	return r->by_socket[socket_id];
+}
+
+uint32_t
+H(rte_hash,replicated_count)(const struct rte_hash_hvariant_replicated *r)
+{
+	return r->nb_replicas;
+}
+
+int32_t
+H(rte_hash,replicated_add_key_data)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t key,
+		hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
+{
+	int32_t ret = 0, res;
+	uint32_t i;
+
+	for (i = 0; i < r->nb_replicas; i++) {
+		res = H(rte_hash,add_key_data)(r->replicas[i], key, data, expirationTime, currentTime);
+		if (i == 0 || (res < 0 && ret >= 0))
+			ret = res;
+	}
+	/* A replica could not add the key, which was thus not present: it is removed from the
+	 * others, so that lookups give the same answer on all sockets */
+	if (ret < 0)
+		for (i = 0; i < r->nb_replicas; i++)
+			H(rte_hash,del_key)(r->replicas[i], key, currentTime);
+	return ret;
+}
+
+int
+H(rte_hash,replicated_add_key_data_bulk)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		const hash_hvariant_data_t data[], const hash_hvariant_time_t expirationTime[], hash_hvariant_time_t currentTime,
+		uint64_t *failed_mask)
+{
+	uint64_t failed = 0, f;
+	int err = 0, res;
+	uint32_t i;
+
+	/* Each replica takes the whole batch, so that it is read once per replica
+	 * and the prefetches of the batch overlap on each socket */
+	for (i = 0; i < r->nb_replicas; i++) {
+		f = 0;
+		res = H(rte_hash,add_key_data_bulk)(r->replicas[i], keys, num_keys, data, expirationTime, currentTime,
+				NULL, NULL, &f);
+		if (res < 0) {
+			err = res;
+			f = num_keys > 0 ? (uint64_t)-1 >> (64 - RTE_MIN(num_keys, 64u)) : 0;
+		}
+		failed |= f;
+	}
+	/* Keys that some replica could not add are removed from the others (as for a single key) */
+	if (failed != 0)
+		for (i = 0; i < r->nb_replicas; i++)
+			H(rte_hash,del_key_bulk)(r->replicas[i], keys, failed, NULL, currentTime);
+	if (failed_mask != NULL)
+		*failed_mask = failed;
+	return err < 0 ? err : (int)(num_keys - __builtin_popcountll(failed));
+}
+
+int32_t
+H(rte_hash,replicated_del_key)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime)
+{
+	int32_t ret = 0, res;
+	uint32_t i;
+
+	for (i = 0; i < r->nb_replicas; i++) {
+		res = H(rte_hash,del_key)(r->replicas[i], key, currentTime);
+		/* Replicas that do not agree have diverged */
+		if (i == 0)
+			ret = res;
+		else if (res != ret)
+			ret = -EIO;
+	}
+	return ret;
+}
+
+int
+H(rte_hash,replicated_del_key_bulk)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t *keys, uint64_t lookup_mask,
+		uint64_t *deleted_mask, hash_hvariant_time_t currentTime)
+{
+	uint64_t deleted = 0, d;
+	int ret = 0, res;
+	uint32_t i;
+
+	for (i = 0; i < r->nb_replicas; i++) {
+		d = 0;
+		res = H(rte_hash,del_key_bulk)(r->replicas[i], keys, lookup_mask, &d, currentTime);
+		if (res < 0)
+			ret = res;
+		else if (ret >= 0 && i > 0 && d != deleted)
+			ret = -EIO; /* Replicas have diverged */
+		deleted |= d;
+	}
+	if (deleted_mask != NULL)
+		*deleted_mask = deleted;
+	return ret < 0 ? ret : __builtin_popcountll(deleted);
+}
+
+int
+H(rte_hash,replicated_lookup_data)(const struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t key,
+		hash_hvariant_data_t *data, hash_hvariant_time_t currentTime)
+{
+	return H(rte_hash,lookup_data)(replicated_local(r), key, data, currentTime);
+}
+
+int
+H(rte_hash,replicated_lookup_bulk_data)(const struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime)
+{
+	return H(rte_hash,lookup_bulk_data)(replicated_local(r), keys, num_keys, hit_mask, data, currentTime);
 }
 
-/* Compute a 64bit hash for a 128 bit key .
+/* Print a key as 32-bit words (used when reporting integrity errors) */
+static void
+print_key(const struct rte_hash_hvariant_key *k)
+{
+	uint32_t key[KEY_SIZE / 4];
+	unsigned i;
+
+	memcpy(key, &k->key, KEY_SIZE);
+	printf("  Key is");
+	for (i = 0; i < KEY_SIZE / 4; i++)
+		printf(" %x", key[i]);
+	printf("\n");
+}
+
+/* Compute a 64bit hash for a key.
  * The low 32 bits will be used as primary hash and the high 32 bits used as secondary hash */
 static inline uint64_t
-rte_hash_m128i(const hash_key_t key)
+rte_hash_key(const hash_hvariant_key_t key)
 {
+#if KEY_SIZE == 8
+	return dcrc_hash_key8(key);
+#elif KEY_SIZE == 16
 	return dcrc_hash_m128(key);
+#elif KEY_SIZE == 32
+	return dcrc_hash_key32(key);
+#else
+	return dcrc_hash_key48(key);
+#endif
 }
 
 
 /* Compare two keys */
 static inline int
-rte_cmp_eq_m128i(const hash_key_t key1, const hash_key_t key2)
+rte_cmp_eq_key(const hash_hvariant_key_t key1, const hash_hvariant_key_t key2)
 {
+#if KEY_SIZE == 8
+	return key1.a == key2.a;
+#elif KEY_SIZE == 16
 #if 0
 	__m128i vcmp = _mm_xor_si128(key1.mm, key2.mm);        // PXOR
 	return _mm_testz_si128(vcmp, vcmp);
 #else
 	return key1.a == key2.a && key1.b == key2.b;
 #endif
+#elif KEY_SIZE == 32
+#ifdef __AVX2__
+	__m256i k1 = _mm256_loadu_si256((const __m256i*)&key1);
+	__m256i k2 = _mm256_loadu_si256((const __m256i*)&key2);
+	__m256i vcmp = _mm256_xor_si256(k1, k2);
+	return _mm256_testz_si256(vcmp, vcmp);
+#else
+	__m128i vcmp = _mm_or_si128(_mm_xor_si128(key1.mm[0], key2.mm[0]), _mm_xor_si128(key1.mm[1], key2.mm[1]));
+	return _mm_testz_si128(vcmp, vcmp);
+#endif
+#else
+	__m128i vcmp = _mm_or_si128(_mm_xor_si128(key1.mm[0], key2.mm[0]), _mm_xor_si128(key1.mm[1], key2.mm[1]));
+	vcmp = _mm_or_si128(vcmp, _mm_xor_si128(key1.mm[2], key2.mm[2]));
+	return _mm_testz_si128(vcmp, vcmp);
+#endif
 }
 
 
@@ -568,8 +1573,28 @@ H(rte_hash,reset)(struct rte_hash_hvariant *h)
 	if (h == NULL)
 		return;
 
+	/* Entries not migrated yet are dropped with the old arrays */
+	if (h->resize_src != NULL) {
+		free_table_arrays(h->resize_src);
+		rte_free(h->resize_src);
+		h->resize_src = NULL;
+	}
+	h->resize_retry = 0;
+	h->resize_grow_pending = 0;
+
 	memset(h->buckets, 0, h->num_buckets * sizeof(struct rte_hash_hvariant_bucket));
-	memset(h->key_store, 0, sizeof(struct rte_hash_hvariant_key) * (h->entries + 1));
+	if (COMPACT_BUCKET)
+		memset(h->secondary_signatures, 0, (uint64_t)h->entries * sizeof(uint32_t));
+	memset(h->key_store, 0, sizeof(struct rte_hash_hvariant_key) * (h->entries + 1 + RTE_HASH_HVARIANT_STASH_SIZE));
+	h->busy_entries = 0;
+	if (h->busy_deltas != NULL)
+		memset(h->busy_deltas, 0, (RTE_MAX_LCORE + 1) * sizeof(struct busy_delta_slot));
+	h->last_path_len = 0;
+	h->stash_mask = 0;
+	h->stash_iterated = 0;
+	h->expire_next = 0;
+	h->rebalance_next = 0;
+	bloom_scrub_abort(h);
 }
 
 static inline uint64_t bloom_mask_64(uint32_t sec_sig){
@@ -580,30 +1605,39 @@ static inline uint64_t bloom_mask_64(uint32_t sec_sig){
 	return (1ull << h1) | (1ull << h2 ); // | (1ull << h3) | (1ull << h4);
 }
 
+/* Word of the bloom filter holding the bits of sec_sig (filters of 16-slot buckets have two words) */
+static inline uint32_t bloom_word(uint32_t sec_sig){
+	return (sec_sig >> 12) & (RTE_HASH_HVARIANT_BLOOM_WORDS - 1);
+}
+
 #if BLOOM
 static inline void mark_as_secondary(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, uint32_t i, uint32_t sec_sig,__rte_unused  uint32_t hindex){
 	// Mark as stored in secondary bucket
 	set_bit_in_mask(&b->mask_in_secondary_position,i);
 
 	// Find corresponding primary bucket
-	struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[b->secondary_signature_full[i] & h->bucket_bitmask];
+	struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[secondary_signature(h,b,i) & h->bucket_bitmask];
 
 	// Increase counter moved_to_secondary, add to bloom filter
 	prim_bucket->count_moved_to_secondary++;
-	prim_bucket->bloom_moved |= bloom_mask_64(sec_sig);
+	prim_bucket->bloom_moved[bloom_word(sec_sig)] |= bloom_mask_64(sec_sig);
+
+	// Also add to the filter being rebuilt, if any (see bloom_scrub())
+	if (unlikely(h->scrub_filters != NULL))
+		h->scrub_filters[(prim_bucket - h->buckets) * RTE_HASH_HVARIANT_BLOOM_WORDS + bloom_word(sec_sig)] |= bloom_mask_64(sec_sig);
 
 
 }
 
-static inline void reset_bucket_entry_bloom(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, uint32_t i, __rte_unused uint16_t currentTime){
+static inline void reset_bucket_entry_bloom(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, uint32_t i, __rte_unused hash_hvariant_time_t currentTime){
 	if(get_bit_in_mask(&b->mask_in_secondary_position,i)){
 		// Find corresponding primary bucket
-		struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[b->secondary_signature_full[i] & h->bucket_bitmask];
+		struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[secondary_signature(h,b,i) & h->bucket_bitmask];
 
 		// Decrease counter moved_to_secondary - if counter is zero then reset bloom filter
 		prim_bucket->count_moved_to_secondary--;
 		if(prim_bucket->count_moved_to_secondary == 0){
-			prim_bucket->bloom_moved = 0;
+			memset(prim_bucket->bloom_moved, 0, sizeof(prim_bucket->bloom_moved));
 		}
 
 		unset_bit_in_mask(&b->mask_in_secondary_position,i);
@@ -616,7 +1650,7 @@ static inline void mark_as_secondary(struct rte_hash_hvariant * h, struct rte_ha
 	set_bit_in_mask(&b->mask_in_secondary_position,i);
 
 	// Find corresponding primary bucket
-	struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[b->secondary_signature_full[i] & h->bucket_bitmask];
+	struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[secondary_signature(h,b,i) & h->bucket_bitmask];
 
 	// Find the tag
 	uint32_t prim_sig = primary_signature(h,b,i);
@@ -631,19 +1665,19 @@ static inline void mark_as_secondary(struct rte_hash_hvariant * h, struct rte_ha
 
 }
 
-static inline void reset_bucket_entry_bloom(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, uint32_t i,uint16_t currentTime){
+static inline void reset_bucket_entry_bloom(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * b, uint32_t i,hash_hvariant_time_t currentTime){
 	if(get_bit_in_mask(&b->mask_in_secondary_position,i)){
 		// First, unset bit in mask in secondary position
 		unset_bit_in_mask(&b->mask_in_secondary_position,i);
 
 		// Find corresponding primary bucket
-		struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[b->secondary_signature_full[i] & h->bucket_bitmask];
+		struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[secondary_signature(h,b,i) & h->bucket_bitmask];
 
 		// Find if another entry of bucket b was remapped from prim_bucket
 		uint32_t j;
 		for(j=0;j<RTE_HASH_HVARIANT_BUCKET_ENTRIES;j++){
 			if(i != j && !free_or_expired(b,j,currentTime) && get_bit_in_mask(&b->mask_in_secondary_position,j)){
-				int same_primbkt = (b->secondary_signature_full[i] & h->bucket_bitmask) == (b->secondary_signature_full[j] & h->bucket_bitmask);
+				int same_primbkt = (secondary_signature(h,b,i) & h->bucket_bitmask) == (secondary_signature(h,b,j) & h->bucket_bitmask);
 				int same_tag =  horton_tag(primary_signature(h,b,i)) == horton_tag(primary_signature(h,b,j));
 				if(same_primbkt && same_tag) return;
 			}
@@ -657,10 +1691,13 @@ static inline void reset_bucket_entry_bloom(struct rte_hash_hvariant * h, struct
 
 #else
 static inline void mark_as_secondary(__rte_unused struct rte_hash_hvariant * h, __rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused uint32_t i, __rte_unused uint32_t sec_sig, __rte_unused uint32_t hindex){}
-static inline void reset_bucket_entry_bloom(__rte_unused struct rte_hash_hvariant * h, __rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused uint32_t i, __rte_unused uint16_t currentTime){}
+static inline void reset_bucket_entry_bloom(__rte_unused struct rte_hash_hvariant * h, __rte_unused struct rte_hash_hvariant_bucket * b, __rte_unused uint32_t i, __rte_unused hash_hvariant_time_t currentTime){}
 #endif
 
-static inline void move_bucket_entry(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * bfrom, int ifrom, struct rte_hash_hvariant_bucket * bto, int ito, __rte_unused uint32_t hindex, uint16_t currentTime){
+static inline void move_bucket_entry(struct rte_hash_hvariant * h, struct rte_hash_hvariant_bucket * bfrom, int ifrom, struct rte_hash_hvariant_bucket * bto, int ito, __rte_unused uint32_t hindex, hash_hvariant_time_t currentTime){
+	/* Both buckets change (and the bloom filter or remap array of bfrom if moved to secondary) */
+	lf_write_begin(h, bfrom - h->buckets, bto - h->buckets);
+
 	/* Update bloom filter before overwritting information in bucket "to" */
 	reset_bucket_entry_bloom(h,bto,ito, currentTime);
 
@@ -668,7 +1705,7 @@ static inline void move_bucket_entry(struct rte_hash_hvariant * h, struct rte_ha
 
 	/* Recompute hashes */
 	uint32_t sec_sig = primary_signature(h,bfrom,ifrom);
-    uint32_t prim_sig = bfrom->secondary_signature_full[ifrom];
+    uint32_t prim_sig = secondary_signature(h,bfrom,ifrom);
 
 
     /* Compute key positions */
@@ -686,12 +1723,13 @@ static inline void move_bucket_entry(struct rte_hash_hvariant * h, struct rte_ha
 
 
 
-	bto->primary_signature_high[ito] = prim_sig >> 16;
-	bto->secondary_signature_full[ito] = sec_sig;
+	bto->primary_signature_high[ito] = signature_high(prim_sig);
+	secondary_signature(h,bto,ito) = sec_sig;
 
 #if TIMER
 	bto->expire_date_timeunit[ito] =  bfrom->expire_date_timeunit[ifrom];
 #endif
+	busy_slot_taken(h,bto,ito);
 	set_bit_in_mask(&bto->mask_busy,ito);
 	h->key_store[key_to] = h->key_store[key_from]; // Move data
 
@@ -720,14 +1758,27 @@ static inline void move_bucket_entry(struct rte_hash_hvariant * h, struct rte_ha
 		mark_as_secondary(h,bto,ito,prim_sig, hindex);
 	}
 
+	lf_write_end(h, bfrom - h->buckets, bto - h->buckets);
+
 	/* Restore "free" bucket entry -- not needed as it will be overwritten*/
     //unset_bit_in_mask(&bfrom->mask_busy,ifrom);
 	//reset_bucket_entry_bloom(h,bfrom,ifrom);
 
 }
 
+/* In multi-writer mode, reusing slot i of bucket b (free or expired) updates the bloom filter of the
+ * primary bucket of the previous entry if it was in secondary position: return 1 if it is locked */
+static inline int
+lf_slot_reusable(struct rte_hash_hvariant *h, struct lf_lockset *ls, struct rte_hash_hvariant_bucket *b, uint32_t i)
+{
+	if(ls == NULL || !get_bit_in_mask(&b->mask_in_secondary_position, i))
+		return 1;
+	return lf_lockset_need(ls, secondary_signature(h,b,i) & h->bucket_bitmask);
+}
+
+/* Greedy depth-first search of a cuckoo path, marking the buckets already considered */
 static inline int
-make_space_bucket(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *bkt, uint16_t currentTime)
+make_space_bucket_dfs(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *bkt, hash_hvariant_time_t currentTime)
 {
 	struct rte_hash_hvariant_bucket *current_bucket[RTE_HASH_HVARIANT_MAX_RECURSION+1];
 	int current_slot[RTE_HASH_HVARIANT_MAX_RECURSION+1];
@@ -755,19 +1806,19 @@ make_space_bucket(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *
 			if(HORTON && !get_bit_in_mask(&bkt->mask_in_secondary_position,i)){
 				// Go to secondary bucket (horton case)
 				uint32_t prim_hash = primary_signature(h,bkt,i);
-				hindex[i] = horton_get_hindex(bkt,bkt->secondary_signature_full[i]);
+				hindex[i] = horton_get_hindex(bkt,secondary_signature(h,bkt,i));
 				if(hindex[i] == 0){
 					// Hindex not yet defined, define new hindex
-					hindex[i] = horton_choose_hindex(h,prim_hash, bkt->secondary_signature_full[i], currentTime);
+					hindex[i] = horton_choose_hindex(h,prim_hash, secondary_signature(h,bkt,i), currentTime);
 				}
-				uint32_t horton_hash = horton_sec_hash(h, prim_hash, bkt->secondary_signature_full[i], hindex[i]);
+				uint32_t horton_hash = horton_sec_hash(h, prim_hash, secondary_signature(h,bkt,i), hindex[i]);
 				bi = horton_hash & h->bucket_bitmask;
 			}else{
-				bi = bkt->secondary_signature_full[i] & h->bucket_bitmask;
+				bi = secondary_signature(h,bkt,i) & h->bucket_bitmask;
 				hindex[i] = 0;
 			}
 			next_bkt[i] = &h->buckets[bi];
-			rte_prefetch0(next_bkt);
+			rte_prefetch0(next_bkt[i]);
 		}
 		for(i = 0; i < RTE_HASH_HVARIANT_BUCKET_ENTRIES; i++){
 			uint32_t free_entries = free_or_expired_maskpos(next_bkt[i],currentTime);
@@ -807,6 +1858,8 @@ make_space_bucket(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *
 	/* Apply the cuckoo path */
 	found_path:;
 		//if(current_level > 2) printf("%d\n", current_level);
+		h->last_path_len = current_level;
+		op_stats_path(h, current_level);
 		while(current_level >= 1){
 			struct rte_hash_hvariant_bucket * bkt_to = current_bucket[current_level];
 			int slot_to = current_slot[current_level];
@@ -820,17 +1873,291 @@ make_space_bucket(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *
 		return current_slot[0];
 }
 
+/* Bucket queued by the breadth-first search: it is reached by moving entry 'slot' of the bucket
+ * of node 'parent' to its alternative bucket (with remap entry hindex for horton) */
+struct cuckoo_bfs_node {
+	uint32_t bucket_idx;
+	uint32_t hindex;
+	int16_t parent;
+	uint8_t slot;
+	uint8_t depth;
+};
+
+/* Check if a bucket is in the set of queued buckets (open addressing), and add it if add is set.
+ * Returns 0 if it was already in it */
+static inline int
+bfs_visit(uint32_t *visited, uint32_t bucket_idx, int add)
+{
+	const uint32_t mask = (1U << RTE_HASH_HVARIANT_BFS_VISITED_BITS) - 1;
+	uint32_t p = (bucket_idx * 2654435761U) >> (32 - RTE_HASH_HVARIANT_BFS_VISITED_BITS);
+
+	while (visited[p] != UINT32_MAX) {
+		if (visited[p] == bucket_idx)
+			return 0;
+		p = (p + 1) & mask;
+	}
+	if (add)
+		visited[p] = bucket_idx;
+	return 1;
+}
+
+/* Breadth-first search of the shortest cuckoo path (libcuckoo/MemC3 style). The search state is
+ * kept on the stack: buckets are only read until the path is applied */
+static inline int
+make_space_bucket_bfs(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *bkt, hash_hvariant_time_t currentTime)
+{
+	struct cuckoo_bfs_node nodes[RTE_HASH_HVARIANT_BFS_MAX_NODES];
+	uint32_t visited[1U << RTE_HASH_HVARIANT_BFS_VISITED_BITS];
+	struct rte_hash_hvariant_bucket *path_bkt[RTE_HASH_HVARIANT_BFS_MAX_DEPTH+1];
+	int path_slot[RTE_HASH_HVARIANT_BFS_MAX_DEPTH+1];
+	uint32_t path_hindex[RTE_HASH_HVARIANT_BFS_MAX_DEPTH+1];
+	int head, num_nodes = 1, level, k;
+	unsigned i;
+
+	memset(visited, 0xff, sizeof(visited));
+	nodes[0].bucket_idx = bkt - h->buckets;
+	nodes[0].parent = -1;
+	nodes[0].depth = 0;
+	bfs_visit(visited, nodes[0].bucket_idx, 1);
+
+	for (head = 0; head < num_nodes && nodes[head].depth < RTE_HASH_HVARIANT_BFS_MAX_DEPTH; head++) {
+		struct rte_hash_hvariant_bucket *b = &h->buckets[nodes[head].bucket_idx];
+		uint32_t next_idx[RTE_HASH_HVARIANT_BUCKET_ENTRIES];
+		uint32_t hindex[RTE_HASH_HVARIANT_BUCKET_ENTRIES];
+		/* Buckets at BFS_MAX_DEPTH are only checked for a free slot, never queued */
+		int queue = nodes[head].depth + 1 < RTE_HASH_HVARIANT_BFS_MAX_DEPTH;
+
+		/* Alternative buckets of all entries of the bucket */
+		for (i = 0; i < RTE_HASH_HVARIANT_BUCKET_ENTRIES; i++) {
+			if (HORTON && !get_bit_in_mask(&b->mask_in_secondary_position, i)) {
+				uint32_t prim_hash = primary_signature(h, b, i);
+				hindex[i] = horton_get_hindex(b, secondary_signature(h,b,i));
+				if (hindex[i] == 0)
+					hindex[i] = horton_choose_hindex(h, prim_hash, secondary_signature(h,b,i), currentTime);
+				next_idx[i] = horton_sec_hash(h, prim_hash, secondary_signature(h,b,i), hindex[i]) & h->bucket_bitmask;
+			} else {
+				next_idx[i] = secondary_signature(h,b,i) & h->bucket_bitmask;
+				hindex[i] = 0;
+			}
+			rte_prefetch0(&h->buckets[next_idx[i]]);
+		}
+
+		for (i = 0; i < RTE_HASH_HVARIANT_BUCKET_ENTRIES; i++) {
+			/* Only queued buckets are added to the set, so that it never fills up */
+			if (!bfs_visit(visited, next_idx[i], queue && num_nodes < RTE_HASH_HVARIANT_BFS_MAX_NODES))
+				continue;
+
+			uint32_t free_entries = free_or_expired_maskpos(&h->buckets[next_idx[i]], currentTime);
+			if (free_entries) {
+				level = nodes[head].depth + 1;
+				path_bkt[level] = &h->buckets[next_idx[i]];
+				path_slot[level] = __builtin_ctz(free_entries);
+				path_hindex[level] = hindex[i];
+				path_slot[level-1] = i;
+				goto found_path;
+			}
+			if (queue && num_nodes < RTE_HASH_HVARIANT_BFS_MAX_NODES) {
+				nodes[num_nodes].bucket_idx = next_idx[i];
+				nodes[num_nodes].hindex = hindex[i];
+				nodes[num_nodes].parent = head;
+				nodes[num_nodes].slot = i;
+				nodes[num_nodes].depth = nodes[head].depth + 1;
+				num_nodes++;
+			}
+		}
+	}
+	return -ENOSPC;
+
+found_path:
+	/* Walk back to the first bucket */
+	for (k = head; k >= 0; k = nodes[k].parent) {
+		int d = nodes[k].depth;
+		path_bkt[d] = &h->buckets[nodes[k].bucket_idx];
+		if (d > 0) {
+			path_slot[d-1] = nodes[k].slot;
+			path_hindex[d] = nodes[k].hindex;
+		}
+	}
+
+	/* Apply the cuckoo path, starting with the entry moved to the free slot */
+	h->last_path_len = level;
+	op_stats_path(h, level);
+	for (; level >= 1; level--)
+		move_bucket_entry(h, path_bkt[level-1], path_slot[level-1], path_bkt[level], path_slot[level], path_hindex[level], currentTime);
+	return path_slot[0];
+}
+
+/* Without a path of at most BFS_MAX_DEPTH moves, insertions fail (or use the stash) rather than
+ * walking the depth-first search, whose unbounded length and writes to visited buckets
+ * (mask_already_considered_for_swap) are what the breadth-first search avoids */
+static inline int
+make_space_bucket(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *bkt, hash_hvariant_time_t currentTime)
+{
+#if RTE_HASH_HVARIANT_BFS_PATH
+	return make_space_bucket_bfs(h, bkt, currentTime);
+#else
+	return make_space_bucket_dfs(h, bkt, currentTime);
+#endif
+}
+
+/* Make space in a bucket in multi-writer mode. Several writers may search for a path at the
+ * same time, so the search does not mark buckets (mask_already_considered_for_swap) and never
+ * goes twice through the same bucket. The path is applied only if all its buckets are locked,
+ * otherwise their locks are added to the lock set and -EAGAIN is returned. */
+static inline int
+make_space_bucket_mw(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *bkt, hash_hvariant_time_t currentTime, struct lf_lockset *ls)
+{
+	struct rte_hash_hvariant_bucket *path_bkt[RTE_HASH_HVARIANT_MW_MAX_PATH+1];
+	int path_slot[RTE_HASH_HVARIANT_MW_MAX_PATH+1];
+	int level, l, locked = 1;
+	unsigned i;
+
+	path_bkt[0] = bkt;
+
+	/* Search a cuckoo path */
+	for(level = 0; level < RTE_HASH_HVARIANT_MW_MAX_PATH; level++){
+		struct rte_hash_hvariant_bucket *b = path_bkt[level];
+		struct rte_hash_hvariant_bucket *next_bkt[RTE_HASH_HVARIANT_BUCKET_ENTRIES];
+		int next = -1;
+
+		for(i = 0; i < RTE_HASH_HVARIANT_BUCKET_ENTRIES; i++){
+			next_bkt[i] = &h->buckets[secondary_signature(h,b,i) & h->bucket_bitmask];
+			rte_prefetch0(next_bkt[i]);
+		}
+		for(i = 0; i < RTE_HASH_HVARIANT_BUCKET_ENTRIES; i++){
+			int in_path = 0;
+			for(l = 0; l <= level; l++)
+				in_path |= (path_bkt[l] == next_bkt[i]);
+			if(in_path)
+				continue;
+
+			uint32_t free_entries = free_or_expired_maskpos(next_bkt[i], currentTime);
+			if(free_entries){
+				path_slot[level] = i;
+				path_bkt[level+1] = next_bkt[i];
+				path_slot[level+1] = __builtin_ctz(free_entries);
+				level++;
+				goto found_path;
+			}
+			if(next < 0)
+				next = i;
+		}
+
+		/* Go deeper through the first entry that does not loop */
+		if(next < 0)
+			return -ENOSPC;
+		path_slot[level] = next;
+		path_bkt[level+1] = next_bkt[next];
+	}
+	return -ENOSPC;
+
+found_path:
+	/* All buckets of the path must be locked (the first one, primary bucket, already is) */
+	for(l = 1; l <= level; l++)
+		locked &= lf_lockset_need(ls, path_bkt[l] - h->buckets);
+	locked &= lf_slot_reusable(h, ls, path_bkt[level], path_slot[level]);
+	if(!locked)
+		return -EAGAIN;
+
+	/* Apply the cuckoo path */
+	for(; level >= 1; level--)
+		move_bucket_entry(h, path_bkt[level-1], path_slot[level-1], path_bkt[level], path_slot[level], 0, currentTime);
+	return path_slot[0];
+}
+
+/*
+ * Overflow stash
+ *
+ * Keys that cannot be inserted because no cuckoo path was found are kept in a small array
+ * (a few cache lines) instead of failing. Primary hashes of stash entries are compared 4 at a
+ * time with SSE; lookups only search the stash when it is not empty (stash_mask), so the cost
+ * is a single test for the common case. Stash entries are moved back to the buckets as soon as
+ * a slot of one of their buckets is freed by a deletion, or when the table is resized.
+ * The stash is not used by concurrent tables (lock-free readers do not search it).
+ */
+
+/* Stash entries holding a key with this primary hash (expired entries excluded) */
+static inline uint32_t
+stash_match(const struct rte_hash_hvariant *h, uint32_t prim_hash, __rte_unused hash_hvariant_time_t currentTime)
+{
+	const __m128i ref_hashes = _mm_set1_epi32(prim_hash);
+	uint32_t matches = 0;
+	unsigned i, tmp;
+
+	for (i = 0; i < RTE_HASH_HVARIANT_STASH_SIZE; i += 4) {
+		__m128i stash_hashes = _mm_load_si128((const __m128i *)&h->stash_prim_hash[i]);
+		__m128i eq_hash = _mm_cmpeq_epi32(stash_hashes, ref_hashes);
+		matches |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(eq_hash)) << i;
+	}
+	matches &= h->stash_mask;
+#if TIMER
+	FOREACH_IN_MASK32(i, matches, tmp){
+		if (expired_timer(h->stash_expire[i], currentTime))
+			matches &= ~(1U << i);
+	}
+#else
+	RTE_SET_USED(tmp);
+#endif
+	return matches;
+}
+
+/* Index of the stash entry holding key, or -ENOENT */
+static inline int
+stash_find(const struct rte_hash_hvariant *h, const hash_hvariant_key_t key, uint32_t prim_hash, hash_hvariant_time_t currentTime)
+{
+	uint32_t matches = stash_match(h, prim_hash, currentTime);
+	unsigned i, tmp;
+
+	FOREACH_IN_MASK32(i, matches, tmp){
+		if (rte_cmp_eq_key(key, h->stash_keys[i].key))
+			return i;
+	}
+	return -ENOENT;
+}
+
+/* Store a key that could not be inserted in the buckets. Expired entries are reused */
+static inline int32_t
+stash_add(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, uint64_t sig64,
+		hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, __rte_unused hash_hvariant_time_t currentTime)
+{
+	uint32_t free_mask = ~h->stash_mask;
+	unsigned i, tmp;
+
+#if TIMER
+	FOREACH_IN_MASK32(i, h->stash_mask, tmp){
+		if (expired_timer(h->stash_expire[i], currentTime))
+			free_mask |= 1U << i;
+	}
+#else
+	RTE_SET_USED(tmp);
+#endif
+	free_mask &= (uint32_t)((1ULL << RTE_HASH_HVARIANT_STASH_SIZE) - 1);
+	if (free_mask == 0)
+		return -ENOSPC;
+
+	i = __builtin_ctz(free_mask);
+	h->stash_prim_hash[i] = sig64;
+	h->stash_sec_hash[i] = sig64 >> 32;
+	h->stash_expire[i] = expirationTime;
+	h->stash_keys[i].key = key;
+	store_data(&h->stash_keys[i], data);
+	h->stash_iterated &= ~(1U << i);
+	h->stash_mask |= 1U << i;
+	return RHL_FOUND_UPDATED;
+}
+
+/* Update data and expiration time of a key if it is already in the table.
+ * Returns RHL_FOUND_UPDATED if the key was found, -ENOENT otherwise */
 static inline int32_t
-__rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_key_t key,
-						uint64_t sig64, hash_data_t data, uint16_t expirationTime, uint16_t currentTime)
+__rte_hash_hvariant_update_key_with_hash(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						uint64_t sig64, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	uint32_t prim_hash,sec_hash;
 	uint32_t prim_bucket_idx, sec_bucket_idx;
 	int i;
 	uint64_t tmp;
 	struct rte_hash_hvariant_bucket *prim_bkt, *sec_bkt;
-	struct rte_hash_hvariant_key *new_k, *k, *keys = h->key_store;
-	uint32_t new_idx;
+	struct rte_hash_hvariant_key *k, *keys = h->key_store;
 
 	prim_hash = sig64; // Discards 32 high bits
 	prim_bucket_idx = prim_hash & h->bucket_bitmask;
@@ -844,7 +2171,7 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 #if BLOOM
 	/* If bloom filter does not matches, we don't need to check the secondary bucket */
 	uint64_t bloom = bloom_mask_64(sec_hash);
-	int could_be_in_secondary = (prim_bkt->bloom_moved & bloom) == bloom;
+	int could_be_in_secondary = (prim_bkt->bloom_moved[bloom_word(sec_hash)] & bloom) == bloom;
 #elif HORTON
 	/* If horton does not match, we don't need to check the secondary bucket -- also compute the horton hash to know which bucket is the secondary */
 	uint32_t could_be_in_secondary = horton_get_hindex(prim_bkt,sec_hash);
@@ -865,13 +2192,17 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 	uint32_t prim_matches = matches_and_not_expired_maskpos(prim_bkt, prim_hash, currentTime);
 	FOREACH_IN_MASK32(i, prim_matches, tmp){
 			k = &keys[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
-			if (rte_cmp_eq_m128i(key, k->key)) {
+			if (rte_cmp_eq_key(key, k->key)) {
+				lf_write_begin(h, prim_bucket_idx, prim_bucket_idx);
+
 				/* Update data */
-				k->data = data;
+				store_data(k, data);
 
 				/* Update expiration time */
 				update_timer(prim_bkt,i,expirationTime);
 
+				lf_write_end(h, prim_bucket_idx, prim_bucket_idx);
+
 				/* Reset iterated flag */
 				unset_bit_in_mask(&prim_bkt->mask_iterated_over, i);
 				update_iter_idx(h, prim_bkt);
@@ -890,13 +2221,17 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 		uint32_t sec_matches = matches_and_not_expired_maskpos(sec_bkt, sec_hash, currentTime);
 		FOREACH_IN_MASK32(i, sec_matches, tmp){
 				k = &keys[sec_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
-				if (rte_cmp_eq_m128i(key, k->key)) {
+				if (rte_cmp_eq_key(key, k->key)) {
+					lf_write_begin(h, sec_bucket_idx, sec_bucket_idx);
+
 					/* Update data */
-					k->data = data;
+					store_data(k, data);
 
 					/* Update expiration time */
 					update_timer(sec_bkt,i,expirationTime);
 
+					lf_write_end(h, sec_bucket_idx, sec_bucket_idx);
+
 					/* Reset iterated flag */
 					unset_bit_in_mask(&sec_bkt->mask_iterated_over, i);
 					update_iter_idx(h,sec_bkt);
@@ -910,25 +2245,69 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 		}
 	}
 
+	/* Check if key is in the stash */
+	if(unlikely(h->stash_mask != 0) && 0 <= (i = stash_find(h, key, prim_hash, currentTime))){
+		store_data(&h->stash_keys[i], data);
+		h->stash_expire[i] = expirationTime;
+		h->stash_iterated &= ~(1U << i);
+		return RHL_FOUND_UPDATED;
+	}
+
+	return -ENOENT;
+}
+
+/* Insert a key that is known not to be in the table.
+ * In multi-writer mode, ls holds the locks of the operation and -EAGAIN is returned if more locks are needed */
+static inline int32_t
+__rte_hash_hvariant_insert_key_with_hash(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						uint64_t sig64, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime,
+						struct lf_lockset *ls)
+{
+	uint32_t prim_hash,sec_hash;
+	uint32_t prim_bucket_idx, sec_bucket_idx;
+	int i;
+	struct rte_hash_hvariant_bucket *prim_bkt, *sec_bkt;
+	struct rte_hash_hvariant_key *new_k, *keys = h->key_store;
+	uint32_t new_idx;
+	uint32_t lf_bkt1, lf_bkt2; // Buckets marked as being written (lock-free readers)
+
+	prim_hash = sig64; // Discards 32 high bits
+	prim_bucket_idx = prim_hash & h->bucket_bitmask;
+	prim_bkt = &h->buckets[prim_bucket_idx];
+
+	sec_hash = sig64 >> 32;
+#if HORTON
+	/* Secondary hash derived from current hindex of the tag (as in lookups) */
+	sec_hash = horton_sec_hash(h,prim_hash,sec_hash,horton_get_hindex(prim_bkt,sec_hash));
+#endif
+	sec_bucket_idx = sec_hash & h->bucket_bitmask;
+	sec_bkt = &h->buckets[sec_bucket_idx];
+
 	/* Insert new entry if there is room in the primary bucket */
 	int prim_free, sec_free;
 	if(0 != (prim_free =  free_or_expired_maskpos(prim_bkt, currentTime))){
 		i = __builtin_ctzl(prim_free);
+		if(!lf_slot_reusable(h, ls, prim_bkt, i))
+			return -EAGAIN;
 
 		/* Get the slot for storing the key (use the one in place)*/
 		new_idx = prim_bucket_idx* RTE_HASH_HVARIANT_BUCKET_ENTRIES + i;
 		new_k = &keys[new_idx];
 		rte_prefetch0(new_k);
 
+		lf_bkt1 = lf_bkt2 = prim_bucket_idx;
+		lf_write_begin(h, lf_bkt1, lf_bkt2);
+
 		/* Erase previous value if needed (Update bloom filter) */
 		reset_bucket_entry_bloom(h,prim_bkt,i, currentTime);
 
 		/* Mark as busy */
+		busy_slot_taken(h,prim_bkt,i);
 		set_bit_in_mask(&prim_bkt->mask_busy,i);
 
 		/* Update signatures */
-		prim_bkt->primary_signature_high[i] = prim_hash >> 16;
-		prim_bkt->secondary_signature_full[i] = sec_hash;
+		prim_bkt->primary_signature_high[i] = signature_high(prim_hash);
+		secondary_signature(h,prim_bkt,i) = sec_hash;
 
 		/* Update expiration time */
 		update_timer(prim_bkt,i,expirationTime);
@@ -951,21 +2330,29 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 #endif
 		if(0 != (sec_free =  free_or_expired_maskpos(sec_bkt, currentTime))){
 			i = __builtin_ctzl(sec_free);
+			if(!lf_slot_reusable(h, ls, sec_bkt, i))
+				return -EAGAIN;
 
 			/* Get the slot for storing the key (use the one in place)*/
 			new_idx = sec_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i;
 			new_k = &keys[new_idx];
 			rte_prefetch0(new_k);
 
+			/* The bloom filter (or remap array) of the primary bucket changes too */
+			lf_bkt1 = sec_bucket_idx;
+			lf_bkt2 = prim_bucket_idx;
+			lf_write_begin(h, lf_bkt1, lf_bkt2);
+
 			/* Update bloom filter */
 			reset_bucket_entry_bloom(h,sec_bkt,i, currentTime);
 
 			/* Mark as busy */
+			busy_slot_taken(h,sec_bkt,i);
 			set_bit_in_mask(&sec_bkt->mask_busy,i);
 
 			/* Update signatures */
-			sec_bkt->primary_signature_high[i] = sec_hash >> 16;
-			sec_bkt->secondary_signature_full[i] = prim_hash;
+			sec_bkt->primary_signature_high[i] = signature_high(sec_hash);
+			secondary_signature(h,sec_bkt,i) = prim_hash;
 
 
 			/* Update expiration time */
@@ -977,7 +2364,7 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 
 			/* Mark as stored in secondary and update bloom filter */
 			mark_as_secondary(h,sec_bkt,i,sec_hash,hindex);
-		}else if(0 <= (i = make_space_bucket(h, prim_bkt, currentTime))){
+		}else if(0 <= (i = (ls != NULL) ? make_space_bucket_mw(h, prim_bkt, currentTime, ls) : make_space_bucket(h, prim_bkt, currentTime))){
 			/* Primary bucket is full, so we need to make space in it for new entry , if found insert*/
 
 			/* Get the slot for storing the key (use the one in place)*/
@@ -985,6 +2372,9 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 			new_k = &keys[new_idx];
 			rte_prefetch0(new_k);
 
+			lf_bkt1 = lf_bkt2 = prim_bucket_idx;
+			lf_write_begin(h, lf_bkt1, lf_bkt2);
+
 			/* Update bloom filter */
 			reset_bucket_entry_bloom(h,prim_bkt,i, currentTime);
 
@@ -992,60 +2382,487 @@ __rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 			set_bit_in_mask(&prim_bkt->mask_busy,i);
 
 			/* Bucket */
-			prim_bkt->primary_signature_high[i] = prim_hash >> 16;
-			prim_bkt->secondary_signature_full[i] = sec_hash;
+			prim_bkt->primary_signature_high[i] = signature_high(prim_hash);
+			secondary_signature(h,prim_bkt,i) = sec_hash;
 
 			/* Update expiration time */
 			update_timer(prim_bkt,i,expirationTime);
 
 			/* Reset iterated flag */
-			unset_bit_in_mask(&sec_bkt->mask_iterated_over, i);
+			unset_bit_in_mask(&prim_bkt->mask_iterated_over, i);
 			update_iter_idx(h, prim_bkt);
+		}else if(i == -EAGAIN){
+			return -EAGAIN;
+		}else if(h->lf_versions == NULL){
+			/* No cuckoo path found: keep the key in the stash */
+			return stash_add(h, key, sig64, data, expirationTime, currentTime);
 		}else{
 			return -ENOSPC;
 		}
 	}
 	/* Copy key */
 	new_k->key = key;
-	new_k->data = data;
+	store_data(new_k, data);
+	lf_write_end(h, lf_bkt1, lf_bkt2);
 	return RHL_FOUND_UPDATED;
 }
 
-int32_t
-H(rte_hash,add_key_with_hash)(struct rte_hash_hvariant *h,
-			const hash_key_t key, hash_sig64_t sig,uint16_t expirationTime, uint16_t currentTime)
+/* A slot of bucket bkt_idx may have been freed: move back a stash entry that can use it.
+ * Horton tables only consider the primary bucket (the secondary one depends on the remap array).
+ * Only called on the current arrays: the stash of arrays being migrated is moved by resize_step() */
+static inline void
+stash_reinsert(struct rte_hash_hvariant *h, uint32_t bkt_idx, hash_hvariant_time_t currentTime)
+{
+	static const hash_hvariant_data_t zero_data;
+	unsigned i, tmp;
+
+	if (0 == free_or_expired_maskpos(&h->buckets[bkt_idx], currentTime))
+		return;
+
+	FOREACH_IN_MASK32(i, h->stash_mask, tmp){
+		hash_hvariant_data_t data = zero_data;
+		hash_hvariant_time_t expirationTime = h->stash_expire[i];
+
+		if (TIMER && expired_timer(expirationTime, currentTime)) {
+			h->stash_mask &= ~(1U << i);
+			continue;
+		}
+		if ((h->stash_prim_hash[i] & h->bucket_bitmask) != bkt_idx &&
+		    (HORTON || (h->stash_sec_hash[i] & h->bucket_bitmask) != bkt_idx))
+			continue;
+
+		/* Removed first: the insertion may store it in the stash again */
+		h->stash_mask &= ~(1U << i);
+		load_data(&h->stash_keys[i], &data);
+		__rte_hash_hvariant_insert_key_with_hash(h, h->stash_keys[i].key,
+				((uint64_t)h->stash_sec_hash[i] << 32) | h->stash_prim_hash[i],
+				data, expirationTime, currentTime, NULL);
+		return;
+	}
+}
+
+/* A key of signature sig64 was deleted from one of its buckets */
+static inline void
+stash_reinsert_key(struct rte_hash_hvariant *h, uint64_t sig64, hash_hvariant_time_t currentTime)
+{
+	stash_reinsert(h, (uint32_t)sig64 & h->bucket_bitmask, currentTime);
+#if !HORTON
+	if (h->stash_mask != 0)
+		stash_reinsert(h, (uint32_t)(sig64 >> 32) & h->bucket_bitmask, currentTime);
+#endif
+}
+
+static inline int32_t
+__rte_hash_hvariant_lookup_with_hash_raw(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+					uint64_t sig64, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime, int updateExpirationTime, hash_hvariant_time_t newExpirationTime);
+
+/* Update or insert a key in multi-writer mode, holding the locks of its buckets.
+ * If lookup_only is set, a key already present is not updated: its expiration time is refreshed
+ * and its data is returned in found_data (lookup-or-insert).
+ * Returns RHL_FOUND_UPDATED if the key was inserted, RHL_FOUND_NOTUPDATED if it was already
+ * present, -ENOSPC if it could not be inserted */
+static inline int32_t
+__rte_hash_hvariant_add_key_with_hash_mw(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						uint64_t sig64, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime,
+						int lookup_only, hash_hvariant_data_t *found_data)
+{
+	const uint32_t prim_bucket_idx = (uint32_t)sig64 & h->bucket_bitmask;
+	const uint32_t sec_bucket_idx = (uint32_t)(sig64 >> 32) & h->bucket_bitmask;
+	struct lf_lockset ls;
+	int32_t ret = -ENOSPC;
+	int attempt;
+
+	lf_lockset_init(&ls);
+	lf_lockset_add(&ls, prim_bucket_idx);
+	lf_lockset_add(&ls, sec_bucket_idx);
+
+	for(attempt = 0; attempt < RTE_HASH_HVARIANT_MW_MAX_ATTEMPTS; attempt++){
+		lf_lockset_lock(h, &ls);
+
+		/* The key may have been added by another writer before the locks were taken */
+		if(lookup_only){
+			if(__rte_hash_hvariant_lookup_with_hash_raw(h, key, sig64, found_data, currentTime, 1, expirationTime) >= 0){
+				ret = RHL_FOUND_NOTUPDATED;
+				break;
+			}
+		}else if(__rte_hash_hvariant_update_key_with_hash(h, key, sig64, data, expirationTime, currentTime) == RHL_FOUND_UPDATED){
+			ret = RHL_FOUND_NOTUPDATED;
+			break;
+		}
+
+		ret = __rte_hash_hvariant_insert_key_with_hash(h, key, sig64, data, expirationTime, currentTime, &ls);
+		if(ret != -EAGAIN)
+			break;
+
+		/* Take the missing locks and try again */
+		ret = -ENOSPC;
+		lf_lockset_retry(h, &ls, prim_bucket_idx, sec_bucket_idx);
+	}
+
+	lf_lockset_unlock(h, &ls);
+	return ret;
+}
+
+static int resize_start(struct rte_hash_hvariant *h, uint32_t num_buckets);
+
+/* Resize work attached to insertions: migrate a few buckets if the table is being resized, otherwise
+ * start growing the table if automatic growth is enabled and a threshold was crossed or an insertion
+ * failed (or used the stash). Returns 1 if the table just started to grow (failed insertions can be tried again) */
+static inline int
+resize_on_insert(struct rte_hash_hvariant *h, int failed, hash_hvariant_time_t currentTime)
+{
+	if (h->resize_src != NULL) {
+		/* A stalled migration is only tried again every RESIZE_RETRY insertions */
+		if (unlikely(h->resize_retry > 1) && !h->resize_grow_pending) {
+			h->resize_retry--;
+			return 0;
+		}
+		H(rte_hash,resize_step)(h, RTE_HASH_HVARIANT_RESIZE_STEP, currentTime);
+		return 0;
+	}
+	if (!h->auto_grow)
+		return 0;
+	if (!failed && h->stash_mask == 0 && h->busy_entries < h->grow_threshold &&
+	    (h->grow_path_len == 0 || h->last_path_len <= h->grow_path_len))
+		return 0;
+	return resize_start(h, h->num_buckets * 2) == 0;
+}
+
+static inline int32_t
+__rte_hash_hvariant_add_key_with_hash(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						uint64_t sig64, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
+{
+	int32_t ret;
+
+	if (h->multi_writer) {
+		if (__rte_hash_hvariant_add_key_with_hash_mw(h, key, sig64, data, expirationTime, currentTime, 0, NULL) >= 0)
+			return RHL_FOUND_UPDATED;
+		OP_STATS_ADD(op_stats_local(h), enospc, 1);
+		return -ENOSPC;
+	}
+	if (__rte_hash_hvariant_update_key_with_hash(h, key, sig64, data, expirationTime, currentTime) == RHL_FOUND_UPDATED)
+		return RHL_FOUND_UPDATED;
+	/* While the table is resized, the key may still be in the old arrays */
+	if (unlikely(h->resize_src != NULL) &&
+	    __rte_hash_hvariant_update_key_with_hash(h->resize_src, key, sig64, data, expirationTime, currentTime) == RHL_FOUND_UPDATED)
+		return RHL_FOUND_UPDATED;
+
+	ret = __rte_hash_hvariant_insert_key_with_hash(h, key, sig64, data, expirationTime, currentTime, NULL);
+	if (unlikely(h->resize_src != NULL || h->auto_grow) && resize_on_insert(h, ret < 0, currentTime) && ret < 0)
+		ret = __rte_hash_hvariant_insert_key_with_hash(h, key, sig64, data, expirationTime, currentTime, NULL);
+	if (ret == -ENOSPC)
+		OP_STATS_ADD(op_stats_local(h), enospc, 1);
+	return ret;
+}
+
+int32_t
+H(rte_hash,add_key_with_hash)(struct rte_hash_hvariant *h,
+			const hash_hvariant_key_t key, hash_sig64_t sig,hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	const struct rte_tch_data zero_data = {.a=0,.b=0};
+	static const hash_hvariant_data_t zero_data;
 	return __rte_hash_hvariant_add_key_with_hash(h, key, sig, zero_data, expirationTime, currentTime);
 }
 
 int32_t
-H(rte_hash,add_key)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t expirationTime, uint16_t currentTime)
+H(rte_hash,add_key)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	const struct rte_tch_data zero_data = {.a=0,.b=0};
-	return __rte_hash_hvariant_add_key_with_hash(h, key, rte_hash_m128i(key),  zero_data, expirationTime, currentTime);
+	static const hash_hvariant_data_t zero_data;
+	return __rte_hash_hvariant_add_key_with_hash(h, key, rte_hash_key(key),  zero_data, expirationTime, currentTime);
 }
 
 int
 H(rte_hash,add_key_with_hash_data)(struct rte_hash_hvariant *h,
-			const hash_key_t key, hash_sig64_t sig, hash_data_t data, uint16_t expirationTime, uint16_t currentTime)
+			const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
 	return __rte_hash_hvariant_add_key_with_hash(h, key, sig, data, expirationTime, currentTime);
 }
 
 int
-H(rte_hash,add_key_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_data_t data, uint16_t expirationTime, uint16_t currentTime)
+H(rte_hash,add_key_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_hvariant_add_key_with_hash(h, key, rte_hash_m128i(key), data, expirationTime, currentTime);
+	return __rte_hash_hvariant_add_key_with_hash(h, key, rte_hash_key(key), data, expirationTime, currentTime);
+
+}
+int
+H(rte_hash,add_key_data_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		const hash_hvariant_data_t data[], const hash_hvariant_time_t expirationTime[], hash_hvariant_time_t currentTime,
+		uint64_t *inserted_mask, uint64_t *updated_mask, uint64_t *failed_mask)
+{
+	RETURN_IF_TRUE(((h == NULL) || (keys == NULL) || (num_keys == 0) ||
+			(num_keys > RTE_HASH_HVARIANT_LOOKUP_BULK_MAX)), -EINVAL);
+
+	static const hash_hvariant_data_t zero_data;
+	uint64_t sig[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	struct rte_hash_hvariant_bucket *primary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint64_t inserted = 0, updated = 0, failed = 0;
+	uint32_t i;
+
+	/* Calculate hashes and prefetch primary and secondary buckets */
+	for (i = 0; i < num_keys; i++) {
+		sig[i] = rte_hash_key(keys[i]);
+		primary_bkt[i] = &h->buckets[(uint32_t)sig[i] & h->bucket_bitmask];
+		rte_prefetch0(primary_bkt[i]);
+		if(sizeof(struct rte_hash_hvariant_bucket) > 64) rte_prefetch0(((char*)primary_bkt[i])+64);
+#if !HORTON
+		rte_prefetch0(&h->buckets[(sig[i] >> 32) & h->bucket_bitmask]);
+#endif
+	}
+
+	/* Compare signatures and prefetch the key slot that will be read (match) or written (free slot) */
+	for (i = 0; i < num_keys; i++) {
+		uint32_t prim_hash = sig[i];
+		uint32_t prim_bucket_idx = prim_hash & h->bucket_bitmask;
+		uint32_t slots = matches_and_not_expired_maskpos(primary_bkt[i], prim_hash, currentTime);
+		if (0 == slots)
+			slots = free_or_expired_maskpos(primary_bkt[i], currentTime);
+		if (slots)
+			rte_prefetch0(&h->key_store[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(slots)]);
+#if HORTON
+		/* Secondary bucket depends on the remap entry of the primary bucket */
+		uint32_t sec_hash = horton_sec_hash(h, prim_hash, sig[i] >> 32, horton_get_hindex(primary_bkt[i], sig[i] >> 32));
+		rte_prefetch0(&h->buckets[sec_hash & h->bucket_bitmask]);
+#endif
+	}
 
+	/* Update or insert keys in order: a key duplicated in the batch updates the
+	 * entry added by its first occurrence (last data and expiration time win) */
+	for (i = 0; i < num_keys; i++) {
+		const hash_hvariant_data_t d = (data != NULL) ? data[i] : zero_data;
+		const hash_hvariant_time_t e = (expirationTime != NULL) ? expirationTime[i] : 0;
+
+		if (unlikely(h->resize_src != NULL)) {
+			/* Keys may still be in the old arrays (not prefetched) */
+			if (__rte_hash_hvariant_update_key_with_hash(h, keys[i], sig[i], d, e, currentTime) == RHL_FOUND_UPDATED ||
+			    __rte_hash_hvariant_update_key_with_hash(h->resize_src, keys[i], sig[i], d, e, currentTime) == RHL_FOUND_UPDATED)
+				updated |= 1ULL << i;
+			else if (__rte_hash_hvariant_insert_key_with_hash(h, keys[i], sig[i], d, e, currentTime, NULL) == RHL_FOUND_UPDATED)
+				inserted |= 1ULL << i;
+			else
+				failed |= 1ULL << i;
+		} else if (h->multi_writer) {
+			int32_t ret = __rte_hash_hvariant_add_key_with_hash_mw(h, keys[i], sig[i], d, e, currentTime, 0, NULL);
+			if (ret == RHL_FOUND_UPDATED)
+				inserted |= 1ULL << i;
+			else if (ret == RHL_FOUND_NOTUPDATED)
+				updated |= 1ULL << i;
+			else
+				failed |= 1ULL << i;
+		} else if (__rte_hash_hvariant_update_key_with_hash(h, keys[i], sig[i], d, e, currentTime) == RHL_FOUND_UPDATED)
+			updated |= 1ULL << i;
+		else if (__rte_hash_hvariant_insert_key_with_hash(h, keys[i], sig[i], d, e, currentTime, NULL) == RHL_FOUND_UPDATED)
+			inserted |= 1ULL << i;
+		else if (unlikely(h->auto_grow) && resize_on_insert(h, 1, currentTime))
+			/* The table started to grow, go on with the resize path */
+			i--;
+		else
+			failed |= 1ULL << i;
+	}
+
+	if (unlikely(h->resize_src != NULL || h->auto_grow))
+		resize_on_insert(h, 0, currentTime);
+
+	if (inserted_mask != NULL)
+		*inserted_mask = inserted;
+	if (updated_mask != NULL)
+		*updated_mask = updated;
+	if (failed_mask != NULL)
+		*failed_mask = failed;
+	OP_STATS_ADD(op_stats_local(h), enospc, __builtin_popcountll(failed));
+
+	return __builtin_popcountll(inserted | updated);
+}
+
+/*
+ * Offline bulk build
+ *
+ * build() fills an empty table without following a random chain per key. Keys are first
+ * partitioned with one radix pass on the high bits of their primary bucket index, in ranges of
+ * buckets small enough to stay in cache. Each range is then filled with the keys whose primary
+ * bucket has a free slot, and the keys left over (full primary buckets) are inserted at the end
+ * through the usual path (secondary bucket, cuckoo moves, stash).
+ */
+#define BUILD_PART_BUCKETS 1024u /* Minimum number of buckets of a partition */
+#define BUILD_PART_MAX 4096u     /* Maximum number of partitions (fanout of the radix pass) */
+#define BUILD_PREFETCH 8         /* Keys prefetched ahead when filling buckets */
+
+/* Store a key in its primary bucket if it has a free slot (a key given twice is updated).
+ * Returns 0 if the primary bucket is full */
+static inline int
+build_store_primary(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, uint64_t sig64, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime)
+{
+	const uint32_t prim_hash = sig64;
+	const uint32_t prim_bucket_idx = prim_hash & h->bucket_bitmask;
+	struct rte_hash_hvariant_bucket *bkt = &h->buckets[prim_bucket_idx];
+	struct rte_hash_hvariant_key *k;
+	uint32_t sec_hash = sig64 >> 32;
+	uint32_t i, tmp, free_slots;
+
+	FOREACH_IN_MASK32(i, signature_matches_maskpos(bkt, prim_hash) & bkt->mask_busy, tmp){
+		k = &h->key_store[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
+		if (rte_cmp_eq_key(key, k->key)) {
+			store_data(k, data);
+			update_timer(bkt, i, expirationTime);
+			return 1;
+		}
+	}
+
+	free_slots = ~bkt->mask_busy & ENTRIES_MASK;
+	if (free_slots == 0)
+		return 0;
+	i = __builtin_ctz(free_slots);
+#if HORTON
+	sec_hash = horton_sec_hash(h,prim_hash,sec_hash,horton_get_hindex(bkt,sec_hash));
+#endif
+
+	busy_slot_taken(h,bkt,i);
+	set_bit_in_mask(&bkt->mask_busy,i);
+	bkt->primary_signature_high[i] = signature_high(prim_hash);
+	secondary_signature(h,bkt,i) = sec_hash;
+	update_timer(bkt,i,expirationTime);
+
+	k = &h->key_store[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
+	k->key = key;
+	store_data(k, data);
+	return 1;
+}
+
+int
+H(rte_hash,build)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		const hash_hvariant_data_t data[], const hash_hvariant_time_t expirationTime[], hash_hvariant_time_t currentTime)
+{
+	static const hash_hvariant_data_t zero_data;
+	uint64_t *sig;
+	uint32_t *order, *part_next;
+	uint32_t nb_parts, shift, i, k, p, sum, n_over = 0, failed = 0;
+
+	if (h == NULL || (keys == NULL && num_keys > 0))
+		return -EINVAL;
+
+	/* Buckets are written without locks nor version changes, and busy_entries is only exact
+	 * for single-writer tables */
+	if (h->lf_versions != NULL) {
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_build does not support concurrent tables\n");
+		return -ENOTSUP;
+	}
+	/* Expired entries still hold their slots: the table must be reset, not only expired */
+	if (h->busy_entries != 0 || h->stash_mask != 0 || h->resize_src != NULL) {
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_build needs an empty table\n");
+		return -EBUSY;
+	}
+	if (num_keys == 0)
+		return 0;
+
+	nb_parts = RTE_MIN(h->num_buckets / BUILD_PART_BUCKETS, BUILD_PART_MAX);
+	shift = __builtin_ctz(h->num_buckets / nb_parts);
+
+	sig = rte_malloc_socket(NULL, (uint64_t)num_keys * sizeof(uint64_t), RTE_CACHE_LINE_SIZE, h->socket_id);
+	order = rte_malloc_socket(NULL, (uint64_t)num_keys * sizeof(uint32_t), RTE_CACHE_LINE_SIZE, h->socket_id);
+	part_next = rte_zmalloc_socket(NULL, nb_parts * sizeof(uint32_t), RTE_CACHE_LINE_SIZE, h->socket_id);
+	if (sig == NULL || order == NULL || part_next == NULL) {
+		rte_free(sig);
+		rte_free(order);
+		rte_free(part_next);
+		return -ENOMEM;
+	}
+
+	/* Radix pass: histogram of partitions, then keys in partition order (stable, so that the
+	 * last occurrence of a key given twice is stored last) */
+	for (i = 0; i < num_keys; i++) {
+		sig[i] = rte_hash_key(keys[i]);
+		part_next[((uint32_t)sig[i] & h->bucket_bitmask) >> shift]++;
+	}
+	for (p = 0, sum = 0; p < nb_parts; p++) {
+		uint32_t count = part_next[p];
+		part_next[p] = sum;
+		sum += count;
+	}
+	for (i = 0; i < num_keys; i++)
+		order[part_next[((uint32_t)sig[i] & h->bucket_bitmask) >> shift]++] = i;
+
+	/* Fill primary buckets, one range of buckets after the other. Keys whose primary bucket
+	 * is full are kept (in place) at the beginning of order */
+	for (k = 0; k < num_keys; k++) {
+		if (k + BUILD_PREFETCH < num_keys) {
+			uint32_t next = order[k + BUILD_PREFETCH];
+			rte_prefetch0(&keys[next]);
+			rte_prefetch0(&sig[next]);
+			if (data != NULL)
+				rte_prefetch0(&data[next]);
+		}
+		i = order[k];
+		if (!build_store_primary(h, keys[i], sig[i], (data != NULL) ? data[i] : zero_data,
+				(expirationTime != NULL) ? expirationTime[i] : 0))
+			order[n_over++] = i;
+	}
+
+	/* Then the keys left over, as by add_key_data() */
+	for (k = 0; k < n_over; k++) {
+		i = order[k];
+		if (__rte_hash_hvariant_add_key_with_hash(h, keys[i], sig[i], (data != NULL) ? data[i] : zero_data,
+				(expirationTime != NULL) ? expirationTime[i] : 0, currentTime) < 0)
+			failed++;
+	}
+
+	rte_free(sig);
+	rte_free(order);
+	rte_free(part_next);
+	H(rte_hash,iterator_reset)(h);
+
+	if (failed > 0) {
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_build could not insert %u keys\n", failed);
+		return -ENOSPC;
+	}
+	return 0;
+}
+
+
+/* Lookup of a key missed in the buckets in the stash */
+static inline int32_t
+stash_lookup(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, uint32_t prim_hash,
+		hash_hvariant_data_t *data, hash_hvariant_time_t currentTime, int updateExpirationTime, hash_hvariant_time_t newExpirationTime)
+{
+	int i;
+
+	if (likely(h->stash_mask == 0) || 0 > (i = stash_find(h, key, prim_hash, currentTime)))
+		return -ENOENT;
+	if (data != NULL)
+		load_data(&h->stash_keys[i], data);
+	if (TIMER && updateExpirationTime && h->stash_expire[i] != newExpirationTime) {
+		h->stash_expire[i] = newExpirationTime;
+		h->stash_iterated &= ~(1U << i);
+		return RHL_FOUND_UPDATED;
+	}
+	return RHL_FOUND_NOTUPDATED;
+}
+
+/* Bulk lookup in the stash of the keys missed in the buckets, returns the mask of keys found */
+static inline uint64_t
+stash_lookup_bulk(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint64_t misses,
+		const uint32_t *prim_hash, uint64_t *updated_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime,
+		hash_hvariant_time_t *newExpirationTime, uint16_t updateExpirationTime)
+{
+	uint64_t hits = 0, tmpm;
+	int32_t i, ret;
+
+	FOREACH_IN_MASK64(i, misses, tmpm){
+		ret = stash_lookup(h, keys[i], prim_hash[i], data != NULL ? &data[i] : NULL, currentTime,
+				updateExpirationTime, updateExpirationTime ? newExpirationTime[i] : 0);
+		if (ret < 0)
+			continue;
+		hits |= 1ULL << i;
+		if (ret == RHL_FOUND_UPDATED && updated_mask != NULL)
+			*updated_mask |= 1ULL << i;
+	}
+	return hits;
 }
+
 static inline int32_t
-__rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_key_t key,
-					uint64_t sig64, hash_data_t *data, uint16_t currentTime, int updateExpirationTime, uint16_t newExpirationTime)
+__rte_hash_hvariant_lookup_with_hash_raw(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+					uint64_t sig64, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime, int updateExpirationTime, hash_hvariant_time_t newExpirationTime)
 {
 	uint32_t prim_bucket_idx, sec_bucket_idx;
 	uint32_t prim_hash,sec_hash;
@@ -1053,6 +2870,7 @@ __rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_key
 	unsigned i, tmp;
 	struct rte_hash_hvariant_bucket *prim_bkt, *sec_bkt;
 	struct rte_hash_hvariant_key *k, *keys = h->key_store;
+	struct rte_hash_hvariant_op_stats *st = op_stats_local(h);
 	int ret = RHL_FOUND_NOTUPDATED;
 
 	prim_hash = sig64;  // Discard 32 high bits.
@@ -1065,11 +2883,12 @@ __rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_key
 	uint32_t prim_matches = matches_and_not_expired_maskpos(prim_bkt, prim_hash, currentTime);
 	FOREACH_IN_MASK32(i, prim_matches, tmp){
 			k = &keys[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
-			if (rte_cmp_eq_m128i(key, k->key)) {
+			OP_STATS_ADD(st, key_compares, 1);
+			if (rte_cmp_eq_key(key, k->key)) {
 				update_timer_if_needed(h,prim_bkt,i,newExpirationTime,updateExpirationTime,1,&ret,NULL,0);
 
 				if (data != NULL)
-					*data = k->data;
+					load_data(k, data);
 				/*
 				 * Return status code
 				 */
@@ -1081,7 +2900,7 @@ __rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_key
 #if BLOOM
 	/* If bloom filter does not matches, we don't need to check the secondary bucket */
 	uint64_t bloom = bloom_mask_64(sec_hash);
-	int could_be_in_secondary = (prim_bkt->bloom_moved & bloom) == bloom;
+	int could_be_in_secondary = (prim_bkt->bloom_moved[bloom_word(sec_hash)] & bloom) == bloom;
 #elif HORTON
 	/* If horton does not match, we don't need to check the secondary bucket -- also compute the horton hash to know which bucket is the secondary */
 	uint32_t could_be_in_secondary = horton_get_hindex(prim_bkt,sec_hash);
@@ -1093,10 +2912,11 @@ __rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_key
 #endif
 	/* Early stop if filter (horton or bloom) matches */
 	if(!could_be_in_secondary){
-		return -ENOENT;
+		return stash_lookup(h, key, prim_hash, data, currentTime, updateExpirationTime, newExpirationTime);
 	}
 	sec_bucket_idx = sec_hash & h->bucket_bitmask;
 	sec_bkt = &h->buckets[sec_bucket_idx];
+	OP_STATS_ADD(st, secondary_accesses, 1);
 
 
 
@@ -1104,84 +2924,172 @@ __rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_key
 	uint32_t sec_matches = matches_and_not_expired_maskpos(sec_bkt, sec_hash, currentTime);
 	FOREACH_IN_MASK32(i, sec_matches, tmp){
 			k = &keys[sec_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
-			if (rte_cmp_eq_m128i(key, k->key)) {
+			OP_STATS_ADD(st, key_compares, 1);
+			if (rte_cmp_eq_key(key, k->key)) {
 				update_timer_if_needed(h,sec_bkt,i,newExpirationTime,updateExpirationTime,1,&ret,NULL,0);
 
 				if (data != NULL)
-					*data = k->data;
+					load_data(k, data);
 				/*
 				 * Return status code
 				 */
 				return ret;
 			}
 	}
+	OP_STATS_ADD(st, bloom_false_positives, 1);
 
-	return -ENOENT;
+	return stash_lookup(h, key, prim_hash, data, currentTime, updateExpirationTime, newExpirationTime);
+}
+
+/* Lookup with lock-free readers: restart the lookup if the primary or secondary bucket
+ * has been modified by the writer in the meantime */
+static inline int32_t
+__rte_hash_hvariant_lookup_with_hash_lf(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+					uint64_t sig64, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime)
+{
+	const uint32_t prim_bucket_idx = (uint32_t)sig64 & h->bucket_bitmask;
+	uint32_t sec_bucket_idx, prim_version, sec_version;
+	int32_t ret;
+
+	do {
+		prim_version = lf_read_begin(h, prim_bucket_idx);
+		sec_bucket_idx = lf_secondary_bucket_idx(h, sig64);
+		sec_version = lf_read_begin(h, sec_bucket_idx);
+		ret = __rte_hash_hvariant_lookup_with_hash_raw(h, key, sig64, data, currentTime, 0, 0);
+	} while (lf_read_retry(h, prim_bucket_idx, prim_version) ||
+		 lf_read_retry(h, sec_bucket_idx, sec_version));
+
+	return ret;
+}
+
+static inline int32_t
+__rte_hash_hvariant_lookup_with_hash_dispatch(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+					uint64_t sig64, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime, int updateExpirationTime, hash_hvariant_time_t newExpirationTime)
+{
+	if (unlikely(h->resize_src != NULL)) {
+		/* Keys not migrated yet are in the old arrays */
+		int32_t ret = __rte_hash_hvariant_lookup_with_hash_raw(h, key, sig64, data, currentTime, updateExpirationTime, newExpirationTime);
+		if (ret < 0)
+			ret = __rte_hash_hvariant_lookup_with_hash_raw(h->resize_src, key, sig64, data, currentTime, updateExpirationTime, newExpirationTime);
+		return ret;
+	}
+	/* Lookups updating the expiration time are writer operations */
+	if (h->lf_versions != NULL && !updateExpirationTime)
+		return __rte_hash_hvariant_lookup_with_hash_lf(h, key, sig64, data, currentTime);
+	if (h->multi_writer) {
+		struct lf_lockset ls;
+		int32_t ret;
+		lf_lockset_lock_key(h, &ls, sig64);
+		ret = __rte_hash_hvariant_lookup_with_hash_raw(h, key, sig64, data, currentTime, updateExpirationTime, newExpirationTime);
+		lf_lockset_unlock(h, &ls);
+		return ret;
+	}
+	return __rte_hash_hvariant_lookup_with_hash_raw(h, key, sig64, data, currentTime, updateExpirationTime, newExpirationTime);
+}
+
+static inline int32_t
+__rte_hash_hvariant_lookup_with_hash(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+					uint64_t sig64, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime, int updateExpirationTime, hash_hvariant_time_t newExpirationTime)
+{
+	int32_t ret = __rte_hash_hvariant_lookup_with_hash_dispatch(h, key, sig64, data, currentTime, updateExpirationTime, newExpirationTime);
+
+	op_stats_lookups(h, 1, ret >= 0);
+	return ret;
 }
 
 int32_t
 H(rte_hash,lookup_with_hash)(struct rte_hash_hvariant *h,
-			const hash_key_t key, uint64_t sig, uint16_t currentTime)
+			const hash_hvariant_key_t key, uint64_t sig, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
 	return __rte_hash_hvariant_lookup_with_hash(h, key, sig, NULL, currentTime,0, 0);
 }
 
 int32_t
-H(rte_hash,lookup)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t currentTime)
+H(rte_hash,lookup)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_m128i(key), NULL, currentTime,0, 0);
+	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_key(key), NULL, currentTime,0, 0);
 }
 
 int
 H(rte_hash,lookup_with_hash_data)(struct rte_hash_hvariant *h,
-			const hash_key_t key, uint64_t sig, hash_data_t  *data, uint16_t currentTime)
+			const hash_hvariant_key_t key, uint64_t sig, hash_hvariant_data_t  *data, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
 	return __rte_hash_hvariant_lookup_with_hash(h, key, sig, data, currentTime, 0, 0);
 }
 
 int
-H(rte_hash,lookup_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_data_t  *data, uint16_t currentTime)
+H(rte_hash,lookup_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_data_t  *data, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_m128i(key), data, currentTime, 0, 0);
+	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_key(key), data, currentTime, 0, 0);
 }
 
 int32_t
 H(rte_hash,lookup_update_with_hash)(struct rte_hash_hvariant *h,
-			const hash_key_t key, uint64_t sig, uint16_t expirationTime, uint16_t currentTime)
+			const hash_hvariant_key_t key, uint64_t sig, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
 	return __rte_hash_hvariant_lookup_with_hash(h, key, sig, NULL, currentTime, -1,expirationTime);
 }
 
 int32_t
-H(rte_hash,lookup_update)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t expirationTime, uint16_t currentTime)
+H(rte_hash,lookup_update)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_m128i(key), NULL, currentTime, -1, expirationTime);
+	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_key(key), NULL, currentTime, -1, expirationTime);
 }
 
 int
 H(rte_hash,lookup_update_with_hash_data)(struct rte_hash_hvariant *h,
-			const hash_key_t key, uint64_t sig, hash_data_t *data, uint16_t expirationTime, uint16_t currentTime)
+			const hash_hvariant_key_t key, uint64_t sig, hash_hvariant_data_t *data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
 	return __rte_hash_hvariant_lookup_with_hash(h, key, sig, data, currentTime, -1, expirationTime);
 }
 
 int
-H(rte_hash,lookup_update_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_data_t  *data, uint16_t expirationTime, uint16_t currentTime)
+H(rte_hash,lookup_update_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_data_t  *data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_m128i(key), data, currentTime, -1, expirationTime);
+	return __rte_hash_hvariant_lookup_with_hash(h, key, rte_hash_key(key), data, currentTime, -1, expirationTime);
+}
+
+/* Remove an entry from a bucket, updating the bloom filter (or horton remap entry)
+ * of its primary bucket if the entry was stored in secondary position */
+static inline void
+delete_bucket_entry(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *bkt, uint32_t i, hash_hvariant_time_t currentTime)
+{
+	uint32_t bkt_idx = bkt - h->buckets;
+	lf_write_begin(h, bkt_idx, bkt_idx);
+
+	/* Update bloom filter */
+	reset_bucket_entry_bloom(h,bkt,i, currentTime);
+
+	/* Mark entry as free */
+	unset_bit_in_mask(&bkt->mask_busy,i);
+	busy_slots_released(h, 1);
+
+	lf_write_end(h, bkt_idx, bkt_idx);
+}
+
+/* Deletion of a key missed in the buckets from the stash */
+static inline int32_t
+stash_del(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, uint32_t prim_hash, hash_hvariant_time_t currentTime)
+{
+	int i;
+
+	if (likely(h->stash_mask == 0) || 0 > (i = stash_find(h, key, prim_hash, currentTime)))
+		return -ENOENT;
+	h->stash_mask &= ~(1U << i);
+	return RHL_FOUND_UPDATED;
 }
 
 static inline int32_t
-__rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_key_t key,
-						uint64_t sig64, uint16_t currentTime)
+__rte_hash_hvariant_del_key_with_hash_raw(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						uint64_t sig64, hash_hvariant_time_t currentTime)
 {
 	uint32_t prim_bucket_idx, sec_bucket_idx;
 	uint32_t prim_hash, sec_hash;
@@ -1197,9 +3105,8 @@ __rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 	uint32_t prim_matches = matches_and_not_expired_maskpos(prim_bkt, prim_hash, currentTime);
 	FOREACH_IN_MASK32(i, prim_matches, tmp){
 			k = &keys[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
-			if (rte_cmp_eq_m128i(key, k->key)) {
-				/* Mark entry as free */
-				unset_bit_in_mask(&prim_bkt->mask_busy,i);
+			if (rte_cmp_eq_key(key, k->key)) {
+				delete_bucket_entry(h,prim_bkt,i,currentTime);
 
 				/*
 				 * Return status code
@@ -1213,7 +3120,7 @@ __rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 #if BLOOM
 	/* If bloom filter does not matches, we don't need to check the secondary bucket */
 	uint64_t bloom = bloom_mask_64(sec_hash);
-	int could_be_in_secondary = (prim_bkt->bloom_moved & bloom) == bloom;
+	int could_be_in_secondary = (prim_bkt->bloom_moved[bloom_word(sec_hash)] & bloom) == bloom;
 #elif HORTON
 	/* If horton does not match, we don't need to check the secondary bucket -- also compute the horton hash to know which bucket is the secondary */
 	uint32_t could_be_in_secondary = horton_get_hindex(prim_bkt,sec_hash);
@@ -1225,7 +3132,7 @@ __rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 #endif
 	/* Early stop if filter (horton or bloom) matches */
 	if(!could_be_in_secondary){
-		return -ENOENT;
+		return stash_del(h, key, prim_hash, currentTime);
 	}
 
 	sec_bucket_idx = sec_hash & h->bucket_bitmask;
@@ -1235,12 +3142,8 @@ __rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 	uint32_t sec_matches = matches_and_not_expired_maskpos(sec_bkt, sec_hash, currentTime);
 	FOREACH_IN_MASK32(i, sec_matches, tmp){
 			k = &keys[sec_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
-			if (rte_cmp_eq_m128i(key, k->key)) {
-				/* Update bloom filter */
-				reset_bucket_entry_bloom(h,prim_bkt,i, currentTime);
-
-				/* Mark entry as free */
-				unset_bit_in_mask(&sec_bkt->mask_busy,i);
+			if (rte_cmp_eq_key(key, k->key)) {
+				delete_bucket_entry(h,sec_bkt,i,currentTime);
 
 				/*
 				 * Return status code
@@ -1249,108 +3152,471 @@ __rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_ke
 			}
 	}
 
-	return -ENOENT;
+	return stash_del(h, key, prim_hash, currentTime);
+}
+
+static inline int32_t
+__rte_hash_hvariant_del_key_with_hash(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						uint64_t sig64, hash_hvariant_time_t currentTime)
+{
+	if (h->multi_writer) {
+		struct lf_lockset ls;
+		int32_t ret;
+		lf_lockset_lock_key(h, &ls, sig64);
+		ret = __rte_hash_hvariant_del_key_with_hash_raw(h, key, sig64, currentTime);
+		lf_lockset_unlock(h, &ls);
+		return ret;
+	}
+	if (unlikely(h->resize_src != NULL) &&
+	    __rte_hash_hvariant_del_key_with_hash_raw(h->resize_src, key, sig64, currentTime) == RHL_FOUND_UPDATED)
+		return RHL_FOUND_UPDATED;
+	if (__rte_hash_hvariant_del_key_with_hash_raw(h, key, sig64, currentTime) != RHL_FOUND_UPDATED)
+		return -ENOENT;
+	/* The slot freed may be used by a stash entry */
+	if (unlikely(h->stash_mask != 0))
+		stash_reinsert_key(h, sig64, currentTime);
+	return RHL_FOUND_UPDATED;
 }
 
 int32_t
 H(rte_hash,del_key_with_hash)(struct rte_hash_hvariant *h,
-			const hash_key_t key, hash_sig64_t sig, uint16_t currentTime)
+			const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
 	return __rte_hash_hvariant_del_key_with_hash(h, key, sig, currentTime);
 }
 
 int32_t
-H(rte_hash,del_key)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t currentTime)
+H(rte_hash,del_key)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_hvariant_del_key_with_hash(h, key, rte_hash_m128i(key), currentTime);
+	return __rte_hash_hvariant_del_key_with_hash(h, key, rte_hash_key(key), currentTime);
 }
 
-
-static inline void
-__rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *keys,
-			uint64_t lookup_mask_query, uint64_t *hit_mask,  uint64_t * updated_mask,
-			hash_data_t data[], uint16_t currentTime, uint16_t* newExpirationTime, uint16_t updateExpirationTime)
+#if DATA_SIZE == 0
+/* Key-only sets: shorthands for the operations of tables, data being empty */
+int32_t
+H(rte_hash,insert)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime)
 {
-	uint64_t hits = 0, tmpm;
-	int32_t i;
-	uint32_t prim_hash[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	uint32_t sec_hash[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	struct rte_hash_hvariant_bucket *primary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	struct rte_hash_hvariant_bucket *secondary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	uint32_t prim_hitmask[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	uint32_t sec_hitmask[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	uint32_t could_be_in_secondary[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	//uint32_t prefetch_secondary[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
-	//uint32_t at_least_one_in_secondary = 0;
+	return H(rte_hash,add_key)(h, key, expirationTime, currentTime);
+}
 
-	if(lookup_mask_query == 0xffffffffULL){
-		const int32_t num_keys=32;
+int
+H(rte_hash,contains)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime)
+{
+	int32_t ret = H(rte_hash,lookup)(h, key, currentTime);
 
-		/* Calculate and prefetch rest of the buckets */
-		for (i = 0; i < num_keys; i++) {
-			uint64_t hash = dcrc_hash_m128(keys[i]);
-			prim_hash[i] = hash;
-			sec_hash[i] = hash >> 32;
+	if (ret >= 0)
+		return 1;
+	return ret == -ENOENT ? 0 : ret;
+}
 
-			primary_bkt[i] = &h->buckets[prim_hash[i] & h->bucket_bitmask];
-			rte_prefetch0(primary_bkt[i]);
+int
+H(rte_hash,contains_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys, uint64_t *hit_mask, hash_hvariant_time_t currentTime)
+{
+	/* Nothing is written to the data of a set, the array only keeps the arguments valid */
+	hash_hvariant_data_t data[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
 
-#if UNCONDITIONAL_PREFETCH
-			secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
-			rte_prefetch0(secondary_bkt[i]);
-#endif
-		}
+	return H(rte_hash,lookup_bulk_data)(h, keys, num_keys, hit_mask, data, currentTime);
+}
 
-		/* Compare signatures and prefetch key slot of first hit */
-		for (i = 0; i < num_keys; i++) {
-			prim_hitmask[i] = matches_and_not_expired_maskpos(primary_bkt[i], prim_hash[i], currentTime);
-#if UNCONDITIONAL_PREFETCH
-			sec_hitmask[i] = matches_and_not_expired_maskpos(secondary_bkt[i], sec_hash[i], currentTime);
-#endif
-#if BLOOM
-			uint64_t bloom = bloom_mask_64(sec_hash[i]);
-			could_be_in_secondary[i] =  (primary_bkt[i]->bloom_moved &  bloom) == bloom ;
-#elif HORTON
-			could_be_in_secondary[i] = horton_get_hindex(primary_bkt[i],sec_hash[i]);
+int32_t
+H(rte_hash,delete)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime)
+{
+	return H(rte_hash,del_key)(h, key, currentTime);
+}
 #endif
 
-			/* Prefetch the primary key slot */
-			if (prim_hitmask[i]) {
-				uint32_t first_hit = __builtin_ctz(prim_hitmask[i]);
-				uint32_t key_idx = (prim_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + first_hit;
-				const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
-				rte_prefetch0(key_slot);
-			}
+/*
+ * Online resize
+ *
+ * Resizing allocates new arrays and keeps the old ones in resize_src, a table structure used
+ * internally. Keys are updated, looked up and deleted in both tables, and inserted in the new
+ * one only. resize_step() (called a few buckets at a time by insertions) moves the entries of
+ * the old buckets to the new arrays, and frees the old arrays once all of them have been moved.
+ */
 
-			/* Prefetch the secondary bucket */
-			if((BLOOM && could_be_in_secondary[i]) ||
-			   (CONDITIONAL_PREFETCH && 0 == prim_hitmask[i])){
-				secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
-				rte_prefetch0(secondary_bkt[i]);
-			}
+/* Signature of the entry in slot i of bucket b: each bucket entry stores the full hash of its
+ * current bucket (high bits + bucket index) and the full hash of its alternative bucket.
+ * Variants without filter do not track secondary positions: hashes may be swapped, which
+ * does not matter as both buckets are always checked */
+static inline uint64_t
+entry_signature(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *b, int i)
+{
+	uint64_t here = primary_signature(h, b, i);
+	uint64_t other = secondary_signature(h,b,i);
 
-			/* Prefetch the secondary bucket (horton case)*/
-			if(HORTON && could_be_in_secondary[i]){
-				uint32_t horton_hash = horton_sec_hash(h,prim_hash[i],sec_hash[i],could_be_in_secondary[i]);
-				secondary_bkt[i] = &h->buckets[horton_hash & h->bucket_bitmask];
-				// Secondary hash to use in the rest of the algorithm is derived from horton_hash
-				sec_hash[i] = horton_hash;
-			}
+	if (get_bit_in_mask(&b->mask_in_secondary_position, i))
+		return (here << 32) | other;
+	return (other << 32) | here;
+}
 
-			/* Prefetch the secondary key slot */
-			if(UNCONDITIONAL_PREFETCH && sec_hitmask[i] && 0 == prim_hitmask[i]) {
-				uint32_t first_hit = __builtin_ctz(sec_hitmask[i]);
-				uint32_t key_idx = (sec_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + first_hit;
-				const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
-				rte_prefetch0(key_slot);
-			}
+/* Move the entries of bucket idx of the old arrays to the new ones (expired entries are dropped).
+ * If keep is set, the entries are copied: the old arrays stay valid if the copy fails */
+static inline int
+resize_migrate_bucket(struct rte_hash_hvariant *h, uint32_t idx, hash_hvariant_time_t currentTime, int keep)
+{
+	static const hash_hvariant_data_t zero_data;
+	struct rte_hash_hvariant *src = h->resize_src;
+	struct rte_hash_hvariant_bucket *b = &src->buckets[idx];
+	unsigned i, tmp;
 
+	FOREACH_IN_MASK32(i, b->mask_busy, tmp){
+		if (!free_or_expired(b, i, currentTime)) {
+			const struct rte_hash_hvariant_key *k = &src->key_store[idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
+			hash_hvariant_data_t data = zero_data;
+#if TIMER
+			hash_hvariant_time_t expirationTime = b->expire_date_timeunit[i];
+#else
+			hash_hvariant_time_t expirationTime = 0;
+#endif
+			load_data(k, &data);
+			if (__rte_hash_hvariant_insert_key_with_hash(h, k->key, entry_signature(src, b, i),
+					data, expirationTime, currentTime, NULL) != RHL_FOUND_UPDATED)
+				return -ENOSPC;
 		}
+		if (!keep)
+			delete_bucket_entry(src, b, i, currentTime);
+	}
+	return 0;
+}
 
-		/* If needed (high load factors) - process secondary buckets according to could_be_in_secondary
-		 * and prefetch secondary keys if bloom filter matches / or primary bucket don't match) */
+/* Move the entries of the stash of the old arrays to the new ones, once all buckets are moved
+ * (copied if keep is set) */
+static inline int
+resize_migrate_stash(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime, int keep)
+{
+	static const hash_hvariant_data_t zero_data;
+	struct rte_hash_hvariant *src = h->resize_src;
+	unsigned i, tmp;
+
+	FOREACH_IN_MASK32(i, src->stash_mask, tmp){
+		if (!TIMER || !expired_timer(src->stash_expire[i], currentTime)) {
+			hash_hvariant_data_t data = zero_data;
+			load_data(&src->stash_keys[i], &data);
+			if (__rte_hash_hvariant_insert_key_with_hash(h, src->stash_keys[i].key,
+					((uint64_t)src->stash_sec_hash[i] << 32) | src->stash_prim_hash[i],
+					data, src->stash_expire[i], currentTime, NULL) != RHL_FOUND_UPDATED)
+				return -ENOSPC;
+		}
+		if (!keep)
+			src->stash_mask &= ~(1U << i);
+	}
+	return 0;
+}
+
+/* Check if the arrays of a table can have num_buckets buckets */
+static inline int
+resize_size_ok(const struct rte_hash_hvariant *h, uint32_t num_buckets)
+{
+	if (num_buckets < RTE_HASH_HVARIANT_MIN_BUCKETS ||
+	    (uint64_t)num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES > RTE_HASH_HVARIANT_ENTRIES_MAX)
+		return 0;
+#if RTE_HASH_HVARIANT_SIGNATURE_BITS < 16
+	/* Entries are moved using the hashes kept in buckets, which must include the new index bit */
+	if (num_buckets > h->num_buckets && num_buckets > (1U << (16 + RTE_HASH_HVARIANT_SIGNATURE_BITS)))
+		return 0;
+#else
+	RTE_SET_USED(h);
+#endif
+	return 1;
+}
+
+/* Start migrating the table to new arrays of num_buckets buckets */
+static int
+resize_start(struct rte_hash_hvariant *h, uint32_t num_buckets)
+{
+	struct rte_hash_hvariant *src;
+
+	if (h->resize_src != NULL)
+		return -EBUSY;
+	if (HORTON || h->lf_versions != NULL)
+		return -ENOTSUP;
+	if (!resize_size_ok(h, num_buckets))
+		return -EINVAL;
+
+	src = rte_zmalloc_socket(NULL, sizeof(struct rte_hash_hvariant), RTE_CACHE_LINE_SIZE, h->socket_id);
+	if (src == NULL)
+		return -ENOMEM;
+	bloom_scrub_abort(h);
+
+	/* The old arrays are moved to src, h gets the new ones */
+	*src = *h;
+	if (alloc_table_arrays(h, num_buckets, h->socket_id) < 0) {
+		*h = *src;
+		rte_free(src);
+		RTE_LOG(ERR, HASH, "%s: memory allocation failed for resize\n", h->name);
+		return -ENOMEM;
+	}
+	src->auto_grow = 0;
+	h->resize_src = src;
+	h->resize_next = 0;
+	h->resize_reverted = 0;
+	h->resize_retry = 0;
+	h->resize_grow_pending = 0;
+	return 0;
+}
+
+/* An entry of the old arrays could not be moved (more likely when shrinking): exchange the roles
+ * of the arrays, the entries already moved go back to the previous arrays */
+static void
+resize_revert(struct rte_hash_hvariant *h)
+{
+	struct rte_hash_hvariant *src = h->resize_src;
+	struct rte_hash_hvariant tmp = *h;
+
+	*h = *src;
+	*src = tmp;
+	h->auto_grow = src->auto_grow;
+	h->resize_src = src;
+	h->resize_next = 0;
+	h->resize_reverted = 1;
+	src->auto_grow = 0;
+	src->resize_src = NULL;
+}
+
+/* The entries left in the old arrays fit in neither array once the resize was reverted: replace
+ * the current arrays by arrays twice as large as the largest of both. The entries of the old
+ * arrays are copied at once (the new arrays are at most half full, so this does not fail in
+ * practice), then the entries of the current arrays are migrated incrementally as for grow() */
+static int
+resize_grow_reverted(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant *src = h->resize_src, *cur, *g;
+	uint32_t num_buckets = RTE_MAX(h->num_buckets, src->num_buckets) * 2, idx;
+
+	if (!resize_size_ok(h, num_buckets))
+		return -EINVAL;
+	g = rte_zmalloc_socket(NULL, sizeof(struct rte_hash_hvariant), RTE_CACHE_LINE_SIZE, h->socket_id);
+	cur = rte_zmalloc_socket(NULL, sizeof(struct rte_hash_hvariant), RTE_CACHE_LINE_SIZE, h->socket_id);
+	if (g == NULL || cur == NULL)
+		goto nomem;
+	*g = *h;
+	if (alloc_table_arrays(g, num_buckets, h->socket_id) < 0)
+		goto nomem;
+	g->auto_grow = 0;
+
+	g->resize_src = src;
+	for (idx = 0; idx < src->num_buckets; idx++)
+		if (resize_migrate_bucket(g, idx, currentTime, 1) < 0)
+			goto nospc;
+	if (src->stash_mask != 0 && resize_migrate_stash(g, currentTime, 1) < 0)
+		goto nospc;
+
+	/* The old arrays are released, the current ones become the old ones */
+	free_table_arrays(src);
+	rte_free(src);
+	*cur = *h;
+	cur->auto_grow = 0;
+	cur->resize_src = NULL;
+	g->auto_grow = h->auto_grow;
+	*h = *g;
+	rte_free(g);
+	h->resize_src = cur;
+	h->resize_next = 0;
+	h->resize_reverted = 0;
+	h->resize_retry = 0;
+	h->resize_grow_pending = 0;
+	return 0;
+nospc:
+	free_table_arrays(g);
+	rte_free(g);
+	rte_free(cur);
+	return -ENOSPC;
+nomem:
+	rte_free(g);
+	rte_free(cur);
+	return -ENOMEM;
+}
+
+/* The migration failed both ways: tables with automatic growth grow, the others keep both arrays
+ * and try again after some insertions (or when resize_step() is called), or when grow() is called */
+static int
+resize_stall(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime)
+{
+	if ((h->auto_grow || h->resize_grow_pending) && resize_grow_reverted(h, currentTime) == 0) {
+		RTE_LOG(WARNING, HASH, "%s: reverted resize failed, growing to %u buckets\n", h->name, h->num_buckets);
+		return 0;
+	}
+	if (h->resize_retry == 0)
+		RTE_LOG(WARNING, HASH, "%s: reverted resize failed, waiting for free space\n", h->name);
+	h->resize_retry = RTE_HASH_HVARIANT_RESIZE_RETRY;
+	h->resize_grow_pending = 0;
+	return -ENOSPC;
+}
+
+int
+H(rte_hash,shrink)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime)
+{
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	uint32_t num_buckets = h->num_buckets / 2;
+	uint64_t max_entries = (uint64_t)num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES * RTE_HASH_HVARIANT_SHRINK_MAX_LOAD / 100;
+
+	if (h->resize_src != NULL)
+		return -EBUSY;
+	if (num_buckets < RTE_HASH_HVARIANT_MIN_BUCKETS)
+		return -EINVAL;
+	/* Expired entries are counted as busy until their slot is reused */
+	if (busy_entries_count(h) > max_entries && H(rte_hash,size)(h, currentTime) > max_entries)
+		return -ENOSPC;
+	return resize_start(h, num_buckets);
+}
+
+int
+H(rte_hash,grow)(struct rte_hash_hvariant *h)
+{
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	/* A stalled migration needs larger arrays: they are allocated by the next resize_step() */
+	if (h->resize_src != NULL && h->resize_retry != 0) {
+		if (!resize_size_ok(h, RTE_MAX(h->num_buckets, h->resize_src->num_buckets) * 2))
+			return -EINVAL;
+		h->resize_grow_pending = 1;
+		return 0;
+	}
+	return resize_start(h, h->num_buckets * 2);
+}
+
+int
+H(rte_hash,resize_step)(struct rte_hash_hvariant *h, uint32_t max_buckets, hash_hvariant_time_t currentTime)
+{
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	struct rte_hash_hvariant *src = h->resize_src;
+	if (src == NULL)
+		return 0;
+
+	if (unlikely(h->resize_grow_pending) && resize_stall(h, currentTime) < 0)
+		return -ENOSPC;
+	src = h->resize_src;
+
+	for (; max_buckets > 0 && h->resize_next < src->num_buckets; max_buckets--) {
+		rte_prefetch0(&src->buckets[h->resize_next + 1]);
+		if (resize_migrate_bucket(h, h->resize_next, currentTime, 0) < 0) {
+			if (h->resize_reverted) {
+				if (resize_stall(h, currentTime) < 0)
+					return -ENOSPC;
+			} else {
+				RTE_LOG(WARNING, HASH, "%s: resize to %u buckets failed, reverting\n", h->name, h->num_buckets);
+				resize_revert(h);
+			}
+			src = h->resize_src;
+			continue;
+		}
+		h->resize_next++;
+	}
+	h->resize_retry = 0;
+
+	if (h->resize_next < src->num_buckets)
+		return src->num_buckets - h->resize_next;
+
+	if (unlikely(src->stash_mask != 0) && resize_migrate_stash(h, currentTime, 0) < 0) {
+		if (h->resize_reverted) {
+			if (resize_stall(h, currentTime) < 0)
+				return -ENOSPC;
+		} else {
+			RTE_LOG(WARNING, HASH, "%s: resize to %u buckets failed, reverting\n", h->name, h->num_buckets);
+			resize_revert(h);
+		}
+		return h->resize_src->num_buckets;
+	}
+
+	/* All entries moved: release the old arrays */
+	free_table_arrays(src);
+	rte_free(src);
+	h->resize_src = NULL;
+	return 0;
+}
+
+
+static inline void
+__rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+			uint64_t lookup_mask_query, uint64_t *hit_mask,  uint64_t * updated_mask,
+			hash_hvariant_data_t data[], hash_hvariant_time_t currentTime, hash_hvariant_time_t* newExpirationTime, uint16_t updateExpirationTime,
+			const uint64_t *sigs_in, uint64_t *sigs)
+{
+	struct rte_hash_hvariant_op_stats *st = op_stats_local(h);
+	uint64_t hits = 0, tmpm;
+	int32_t i;
+	uint32_t prim_hash[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t sec_hash[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	struct rte_hash_hvariant_bucket *primary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	struct rte_hash_hvariant_bucket *secondary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t prim_hitmask[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t sec_hitmask[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t could_be_in_secondary[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	//uint32_t prefetch_secondary[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	//uint32_t at_least_one_in_secondary = 0;
+
+	if(lookup_mask_query == 0xffffffffULL){
+		const int32_t num_keys=32;
+
+		/* Calculate and prefetch rest of the buckets */
+		for (i = 0; i < num_keys; i++) {
+			uint64_t hash = (sigs_in != NULL) ? sigs_in[i] : rte_hash_key(keys[i]);
+			prim_hash[i] = hash;
+			sec_hash[i] = hash >> 32;
+			if (sigs != NULL)
+				sigs[i] = hash;
+
+			primary_bkt[i] = &h->buckets[prim_hash[i] & h->bucket_bitmask];
+			rte_prefetch0(primary_bkt[i]);
+
+#if UNCONDITIONAL_PREFETCH
+			secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
+			rte_prefetch0(secondary_bkt[i]);
+#endif
+		}
+
+		/* Compare signatures and prefetch key slot of first hit */
+		for (i = 0; i < num_keys; i++) {
+			prim_hitmask[i] = matches_and_not_expired_maskpos(primary_bkt[i], prim_hash[i], currentTime);
+#if UNCONDITIONAL_PREFETCH
+			sec_hitmask[i] = matches_and_not_expired_maskpos(secondary_bkt[i], sec_hash[i], currentTime);
+#endif
+#if BLOOM
+			uint64_t bloom = bloom_mask_64(sec_hash[i]);
+			could_be_in_secondary[i] =  (primary_bkt[i]->bloom_moved[bloom_word(sec_hash[i])] &  bloom) == bloom ;
+#elif HORTON
+			could_be_in_secondary[i] = horton_get_hindex(primary_bkt[i],sec_hash[i]);
+#endif
+
+			/* Prefetch the primary key slot */
+			if (prim_hitmask[i]) {
+				uint32_t first_hit = __builtin_ctz(prim_hitmask[i]);
+				uint32_t key_idx = (prim_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + first_hit;
+				const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
+				rte_prefetch0(key_slot);
+			}
+
+			/* Prefetch the secondary bucket */
+			if((BLOOM && could_be_in_secondary[i]) ||
+			   (CONDITIONAL_PREFETCH && 0 == prim_hitmask[i])){
+				secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
+				rte_prefetch0(secondary_bkt[i]);
+			}
+
+			/* Prefetch the secondary bucket (horton case)*/
+			if(HORTON && could_be_in_secondary[i]){
+				uint32_t horton_hash = horton_sec_hash(h,prim_hash[i],sec_hash[i],could_be_in_secondary[i]);
+				secondary_bkt[i] = &h->buckets[horton_hash & h->bucket_bitmask];
+				// Secondary hash to use in the rest of the algorithm is derived from horton_hash
+				sec_hash[i] = horton_hash;
+			}
+
+			/* Prefetch the secondary key slot */
+			if(UNCONDITIONAL_PREFETCH && sec_hitmask[i] && 0 == prim_hitmask[i]) {
+				uint32_t first_hit = __builtin_ctz(sec_hitmask[i]);
+				uint32_t key_idx = (sec_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + first_hit;
+				const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
+				rte_prefetch0(key_slot);
+			}
+
+		}
+
+		/* If needed (high load factors) - process secondary buckets according to could_be_in_secondary
+		 * and prefetch secondary keys if bloom filter matches / or primary bucket don't match) */
 		for (i = 0; i < num_keys; i++) {
 			if((BLOOM && could_be_in_secondary[i]) ||
 			   (HORTON && could_be_in_secondary[i]) ||
@@ -1375,9 +3641,10 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 				const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
 
 				/* Access primary key slot */
-				if (rte_cmp_eq_m128i(keys[i],key_slot->key)) {
+				OP_STATS_ADD(st, key_compares, 1);
+				if (rte_cmp_eq_key(keys[i],key_slot->key)) {
 					if (data != NULL)
-						data[i] = key_slot->data;
+						load_data(key_slot, &data[i]);
 
 					hits |= 1ULL << i;
 
@@ -1390,6 +3657,7 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 			if((BLOOM && could_be_in_secondary[i]) ||
 			   (HORTON && could_be_in_secondary[i]) ||
 			   ((!BLOOM) && (!HORTON))){
+				OP_STATS_ADD(st, secondary_accesses, 1);
 				if(NO_PREFETCH ||
 				   (CONDITIONAL_PREFETCH && 0 != prim_hitmask[i])){
 					/* Access secondary bucket */
@@ -1401,9 +3669,10 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 					const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
 
 					/* Access secondary key slot */
-					if (rte_cmp_eq_m128i(keys[i],key_slot->key)) {
+					OP_STATS_ADD(st, key_compares, 1);
+					if (rte_cmp_eq_key(keys[i],key_slot->key)) {
 						if (data != NULL)
-							data[i] = key_slot->data;
+							load_data(key_slot, &data[i]);
 
 						hits |= 1ULL << i;
 
@@ -1412,6 +3681,7 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 						goto next_key;
 					}
 				}
+				OP_STATS_ADD(st, bloom_false_positives, 1);
 			}
 
 	next_key:
@@ -1423,9 +3693,11 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 	}else{
 		/* Calculate and prefetch rest of the buckets */
 		FOREACH_IN_MASK64(i, lookup_mask_query, tmpm){
-			uint64_t hash = dcrc_hash_m128(keys[i]);
+			uint64_t hash = (sigs_in != NULL) ? sigs_in[i] : rte_hash_key(keys[i]);
 			prim_hash[i] = hash;
 			sec_hash[i] = hash >> 32;
+			if (sigs != NULL)
+				sigs[i] = hash;
 
 			primary_bkt[i] = &h->buckets[prim_hash[i] & h->bucket_bitmask];
 			rte_prefetch0(primary_bkt[i]);
@@ -1444,7 +3716,7 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 #endif
 #if BLOOM
 			uint64_t bloom = bloom_mask_64(sec_hash[i]);
-			could_be_in_secondary[i] =  (primary_bkt[i]->bloom_moved &  bloom) == bloom ;
+			could_be_in_secondary[i] =  (primary_bkt[i]->bloom_moved[bloom_word(sec_hash[i])] &  bloom) == bloom ;
 #elif HORTON
 			could_be_in_secondary[i] = horton_get_hindex(primary_bkt[i],sec_hash[i]);
 #endif
@@ -1484,7 +3756,7 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 
 		/* If needed (high load factors) - process secondary buckets according to could_be_in_secondary
 		 * and prefetch secondary keys if bloom filter matches / or primary bucket don't match) */
-		{int tmpm2;
+		{uint64_t tmpm2;
 		FOREACH_IN_MASK64(i, lookup_mask_query, tmpm2){
 			if((BLOOM && could_be_in_secondary[i]) ||
 			   (HORTON && could_be_in_secondary[i]) ||
@@ -1510,9 +3782,10 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 				const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
 
 				/* Access primary key slot */
-				if (rte_cmp_eq_m128i(keys[i],key_slot->key)) {
+				OP_STATS_ADD(st, key_compares, 1);
+				if (rte_cmp_eq_key(keys[i],key_slot->key)) {
 					if (data != NULL)
-						data[i] = key_slot->data;
+						load_data(key_slot, &data[i]);
 
 					hits |= 1ULL << i;
 
@@ -1525,6 +3798,7 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 			if((BLOOM && could_be_in_secondary[i]) ||
 			   (HORTON && could_be_in_secondary[i]) ||
 			   ((!BLOOM) && (!HORTON))){
+				OP_STATS_ADD(st, secondary_accesses, 1);
 				if(NO_PREFETCH ||
 				   (CONDITIONAL_PREFETCH && 0 != prim_hitmask[i])){
 					/* Access secondary bucket */
@@ -1536,9 +3810,10 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 					const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
 
 					/* Access secondary key slot */
-					if (rte_cmp_eq_m128i(keys[i],key_slot->key)) {
+					OP_STATS_ADD(st, key_compares, 1);
+					if (rte_cmp_eq_key(keys[i],key_slot->key)) {
 						if (data != NULL)
-							data[i] = key_slot->data;
+							load_data(key_slot, &data[i]);
 
 						hits |= 1ULL << i;
 
@@ -1547,6 +3822,7 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 						goto next_keyb;
 					}
 				}
+				OP_STATS_ADD(st, bloom_false_positives, 1);
 			}
 
 	next_keyb:
@@ -1559,12 +3835,83 @@ __rte_hash_hvariant_lookup_bulk(struct rte_hash_hvariant *h, const hash_key_t *k
 
 
 	}
+
+	/* Keys missed in the buckets may be in the stash */
+	if (unlikely(h->stash_mask != 0) && hit_mask != NULL)
+		*hit_mask |= stash_lookup_bulk(h, keys, lookup_mask_query & ~hits, prim_hash, updated_mask, data,
+						currentTime, newExpirationTime, updateExpirationTime);
+}
+
+/* Bulk lookup with lock-free readers: versions of the buckets of all keys are read before the
+ * lookup and checked after it, keys whose buckets were modified are looked up again one by one */
+static inline void
+__rte_hash_hvariant_lookup_bulk_lf(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+			uint64_t lookup_mask, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime)
+{
+	/* Only the keys of lookup_mask are hashed: zeroed so that the array is defined for the bulk lookup */
+	uint64_t sigs[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX] = {0};
+	uint32_t sec_bucket_idx[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t prim_version[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t sec_version[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint64_t hits, invalid = 0, tmpm;
+	int32_t i;
+
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		sigs[i] = rte_hash_key(keys[i]);
+#if HORTON
+		/* Remap array of the primary bucket is needed to know the secondary bucket */
+		rte_prefetch0(&h->buckets[(uint32_t)sigs[i] & h->bucket_bitmask]);
+#endif
+	}
+
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		prim_version[i] = lf_version_load(h, (uint32_t)sigs[i] & h->bucket_bitmask);
+		rte_smp_rmb();
+		sec_bucket_idx[i] = lf_secondary_bucket_idx(h, sigs[i]);
+		sec_version[i] = lf_version_load(h, sec_bucket_idx[i]);
+		invalid |= (uint64_t)((prim_version[i] | sec_version[i]) & 1) << i;
+	}
+	rte_smp_rmb();
+
+	__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask, &hits, NULL, data, currentTime, 0, 0, sigs, NULL);
+
+	rte_smp_rmb();
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		if (lf_version_load(h, (uint32_t)sigs[i] & h->bucket_bitmask) != prim_version[i] ||
+		    lf_version_load(h, sec_bucket_idx[i]) != sec_version[i])
+			invalid |= 1ULL << i;
+	}
+
+	/* Retry keys whose buckets changed during the lookup */
+	hits &= ~invalid;
+	FOREACH_IN_MASK64(i, invalid, tmpm){
+		if (__rte_hash_hvariant_lookup_with_hash_lf(h, keys[i], sigs[i],
+				data != NULL ? &data[i] : NULL, currentTime) >= 0)
+			hits |= 1ULL << i;
+	}
+
+	*hit_mask = hits;
 }
 
+/* While the table is resized, look up the keys that were missed in the new arrays in the old ones */
+static inline void
+resize_lookup_bulk_src(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+			uint64_t lookup_mask, uint64_t *hit_mask, uint64_t *updated_mask,
+			hash_hvariant_data_t data[], hash_hvariant_time_t currentTime, hash_hvariant_time_t *newExpirationTime, uint16_t updateExpirationTime)
+{
+	uint64_t src_hits = 0;
+	uint64_t misses = lookup_mask & ~*hit_mask;
+
+	if (misses == 0)
+		return;
+	__rte_hash_hvariant_lookup_bulk(h->resize_src, keys, misses, &src_hits, updated_mask, data, currentTime,
+					newExpirationTime, updateExpirationTime, NULL, NULL);
+	*hit_mask |= src_hits;
+}
 
 int
-H(rte_hash,lookup_bulk_data)(struct rte_hash_hvariant *h, const hash_key_t *keys,
-		      uint32_t num_keys, uint64_t *hit_mask, hash_data_t data[], uint16_t currentTime)
+H(rte_hash,lookup_bulk_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		      uint32_t num_keys, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (keys == NULL) || (num_keys == 0) ||
 			(num_keys > RTE_HASH_HVARIANT_LOOKUP_BULK_MAX) ||
@@ -1572,15 +3919,21 @@ H(rte_hash,lookup_bulk_data)(struct rte_hash_hvariant *h, const hash_key_t *keys
 
 	uint64_t lookup_mask = (uint64_t) -1 >> (64 - num_keys);
 
-	__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask, hit_mask, NULL, data,currentTime,0,0);
+	if (h->lf_versions != NULL)
+		__rte_hash_hvariant_lookup_bulk_lf(h, keys, lookup_mask, hit_mask, data, currentTime);
+	else
+		__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask, hit_mask, NULL, data,currentTime,0,0,NULL,NULL);
+	if (unlikely(h->resize_src != NULL))
+		resize_lookup_bulk_src(h, keys, lookup_mask, hit_mask, NULL, data, currentTime, NULL, 0);
+	op_stats_lookups(h, num_keys, __builtin_popcountll(*hit_mask));
 
 	/* Return number of hits */
 	return __builtin_popcountl(*hit_mask);
 }
 
 int
-H(rte_hash,lookup_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_key_t *keys,
-		      uint64_t lookup_mask, uint64_t *hit_mask, hash_data_t data[], uint16_t currentTime)
+H(rte_hash,lookup_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		      uint64_t lookup_mask, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (keys == NULL)  || (hit_mask == NULL)), -EINVAL);
 
@@ -1588,14 +3941,20 @@ H(rte_hash,lookup_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_key_t
 		*hit_mask=0;
 		return 0;
 	}
-	__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask, hit_mask, NULL, data,currentTime,0,0);
+	if (h->lf_versions != NULL)
+		__rte_hash_hvariant_lookup_bulk_lf(h, keys, lookup_mask, hit_mask, data, currentTime);
+	else
+		__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask, hit_mask, NULL, data,currentTime,0,0,NULL,NULL);
+	if (unlikely(h->resize_src != NULL))
+		resize_lookup_bulk_src(h, keys, lookup_mask, hit_mask, NULL, data, currentTime, NULL, 0);
+	op_stats_lookups(h, __builtin_popcountll(lookup_mask), __builtin_popcountll(*hit_mask));
 	return 0;
 }
 
 
 int
-H(rte_hash,lookup_update_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_key_t *keys,
-		      uint64_t lookup_mask, uint64_t *hit_mask, uint64_t * updated_mask, hash_data_t data[], uint16_t * newExpirationTime, uint16_t currentTime)
+H(rte_hash,lookup_update_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		      uint64_t lookup_mask, uint64_t *hit_mask, uint64_t * updated_mask, hash_hvariant_data_t data[], hash_hvariant_time_t * newExpirationTime, hash_hvariant_time_t currentTime)
 {
 	RETURN_IF_TRUE(((h == NULL) || (keys == NULL)  || (hit_mask == NULL)), -EINVAL);
 
@@ -1604,7 +3963,34 @@ H(rte_hash,lookup_update_bulk_data_mask)(struct rte_hash_hvariant *h, const hash
 		return 0;
 	}
 
-	__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask,  hit_mask, updated_mask, data,currentTime, newExpirationTime, 1);
+	if (h->multi_writer) {
+		/* Each key is looked up and updated holding the locks of its buckets */
+		uint64_t sigs[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+		uint64_t hits = 0, updated = 0, tmpm;
+		int32_t i;
+		FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+			sigs[i] = rte_hash_key(keys[i]);
+			rte_prefetch0(&h->buckets[(uint32_t)sigs[i] & h->bucket_bitmask]);
+		}
+		FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+			int32_t ret = __rte_hash_hvariant_lookup_with_hash(h, keys[i], sigs[i], data ? &data[i] : NULL,
+									currentTime, 1, newExpirationTime[i]);
+			if (ret < 0)
+				continue;
+			hits |= 1ULL << i;
+			if (ret == RHL_FOUND_UPDATED)
+				updated |= 1ULL << i;
+		}
+		*hit_mask = hits;
+		if (updated_mask != NULL)
+			*updated_mask = updated;
+		return 0;
+	}
+
+	__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask,  hit_mask, updated_mask, data,currentTime, newExpirationTime, 1, NULL, NULL);
+	if (unlikely(h->resize_src != NULL))
+		resize_lookup_bulk_src(h, keys, lookup_mask, hit_mask, updated_mask, data, currentTime, newExpirationTime, 1);
+	op_stats_lookups(h, __builtin_popcountll(lookup_mask), __builtin_popcountll(*hit_mask));
 	return 0;
 }
 
@@ -1612,73 +3998,556 @@ H(rte_hash,lookup_update_bulk_data_mask)(struct rte_hash_hvariant *h, const hash
 
 
 
-void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, uint16_t currentTime){
-	RETURN_IF_TRUE((h == NULL) , -EINVAL);
-	struct rte_hash_hvariant_key *next_key;
-	uint32_t i,j;
+int
+H(rte_hash,lookup_or_add_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		      uint64_t lookup_mask, uint64_t *hit_mask, uint64_t *inserted_mask, uint64_t *failed_mask,
+		      hash_hvariant_data_t data[], const hash_hvariant_data_t default_data[],
+		      hash_hvariant_time_t *newExpirationTime, hash_hvariant_time_t currentTime)
+{
+	RETURN_IF_TRUE(((h == NULL) || (keys == NULL) || (hit_mask == NULL) ||
+			(default_data == NULL) || (newExpirationTime == NULL)), -EINVAL);
 
-	int incorrect_bucket = 0;
-	int incorrect_bloom = 0;
-	int incorrect_horton = 0;
-	int incorrect_hash = 0;
-	int in_primary = 0;
-	int in_secondary = 0;
-	int total = 0;
-	for(i = 0; i < h->num_buckets ; i++){
-		//printf("Bucket %d %x %x\n",i,i,h->buckets[i].self_index);
-		for(j=0;j<RTE_HASH_HVARIANT_BUCKET_ENTRIES;j++){
-			if(!free_or_expired(&h->buckets[i],j,currentTime)){
-					/* Get position of entry in key table */
-					int pos = i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j;
-					next_key = &h->key_store[pos];
+	uint64_t sigs[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint64_t hits = 0, misses, inserted = 0, failed = 0, tmpm, tmpm2;
+	int32_t i, j;
 
-					/* Return key, data and remaining time */
-					hash_key_t key = next_key->key;
+	if(lookup_mask == 0){
+		*hit_mask = 0;
+		if (inserted_mask != NULL)
+			*inserted_mask = 0;
+		if (failed_mask != NULL)
+			*failed_mask = 0;
+		return 0;
+	}
 
-					/* Check that current signature is coherent with position */
-					if((h->buckets[i].primary_signature_high[j] & (h->bucket_bitmask >> 16))  != i >> 16){
-						//printf("Incorrect bucket: %x %x\n", h->buckets[i].primary_signature_high[j],i>>16);
-						incorrect_bucket++;
-					}
+	if (h->multi_writer) {
+		/* Each key is looked up or inserted holding the locks of its buckets */
+		FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+			sigs[i] = rte_hash_key(keys[i]);
+			rte_prefetch0(&h->buckets[(uint32_t)sigs[i] & h->bucket_bitmask]);
+		}
+		FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+			int32_t ret = __rte_hash_hvariant_add_key_with_hash_mw(h, keys[i], sigs[i], default_data[i], newExpirationTime[i],
+									currentTime, 1, data ? &data[i] : NULL);
+			if (ret == RHL_FOUND_NOTUPDATED) {
+				hits |= 1ULL << i;
+			} else if (ret == RHL_FOUND_UPDATED) {
+				if (data != NULL)
+					data[i] = default_data[i];
+				inserted |= 1ULL << i;
+			} else {
+				failed |= 1ULL << i;
+			}
+		}
+		goto done;
+	}
+
+	/* Lookup (and update expiration time of) keys already present, keeping their hashes */
+	__rte_hash_hvariant_lookup_bulk(h, keys, lookup_mask, &hits, NULL, data, currentTime, newExpirationTime, 1, NULL, sigs);
+	if (unlikely(h->resize_src != NULL))
+		resize_lookup_bulk_src(h, keys, lookup_mask, &hits, NULL, data, currentTime, newExpirationTime, 1);
+	misses = lookup_mask & ~hits;
+
+	/* Prefetch the key slot where missing keys will be written if their primary bucket has room
+	 * (buckets are already in cache) */
+	FOREACH_IN_MASK64(i, misses, tmpm){
+		uint32_t prim_bucket_idx = (uint32_t)sigs[i] & h->bucket_bitmask;
+		uint32_t free_slots = free_or_expired_maskpos(&h->buckets[prim_bucket_idx], currentTime);
+		if (free_slots)
+			rte_prefetch0(&h->key_store[prim_bucket_idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(free_slots)]);
+	}
 
-					uint64_t sig = rte_hash_m128i(key);
+	/* Insert missing keys with their default data, reusing the hashes computed by the lookup */
+	FOREACH_IN_MASK64(i, misses, tmpm){
+		/* The same key may appear several times in the burst: only its first occurrence is inserted,
+		 * the next ones are hits and update its expiration time like any other hit */
+		FOREACH_IN_MASK64(j, inserted & ((1ULL << i) - 1), tmpm2){
+			if (sigs[j] == sigs[i] && rte_cmp_eq_key(keys[i], keys[j])) {
+				__rte_hash_hvariant_lookup_with_hash_raw(h, keys[i], sigs[i], data ? &data[i] : NULL,
+									currentTime, 1, newExpirationTime[i]);
+				hits |= 1ULL << i;
+				goto next_key;
+			}
+		}
 
-					uint64_t prim_sig = primary_signature(h,&h->buckets[i],j);
-					uint64_t sec_sig = h->buckets[i].secondary_signature_full[j];
+		if (__rte_hash_hvariant_insert_key_with_hash(h, keys[i], sigs[i], default_data[i], newExpirationTime[i], currentTime, NULL) == RHL_FOUND_UPDATED ||
+		    (unlikely(h->auto_grow) && h->resize_src == NULL && resize_on_insert(h, 1, currentTime) &&
+		     __rte_hash_hvariant_insert_key_with_hash(h, keys[i], sigs[i], default_data[i], newExpirationTime[i], currentTime, NULL) == RHL_FOUND_UPDATED)) {
+			if (data != NULL)
+				data[i] = default_data[i];
+			inserted |= 1ULL << i;
+		} else {
+			failed |= 1ULL << i;
+		}
+next_key:
+		continue;
+	}
 
-#if BLOOM
-					int in_primary_pos = !get_bit_in_mask(&h->buckets[i].mask_in_secondary_position,j);
-#else
-					int in_primary_pos = (sig & 0xffffffffULL) == prim_sig;
+	if (unlikely(h->resize_src != NULL || h->auto_grow))
+		resize_on_insert(h, 0, currentTime);
+
+done:
+	*hit_mask = hits;
+	if (inserted_mask != NULL)
+		*inserted_mask = inserted;
+	if (failed_mask != NULL)
+		*failed_mask = failed;
+	op_stats_lookups(h, __builtin_popcountll(lookup_mask), __builtin_popcountll(hits));
+	OP_STATS_ADD(op_stats_local(h), enospc, __builtin_popcountll(failed));
+
+	return __builtin_popcountll(hits | inserted);
+}
+
+
+/* State of a key in flight in the streaming lookup */
+struct rte_hash_hvariant_stream_slot {
+	struct rte_hash_hvariant_bucket *prim_bkt;
+	struct rte_hash_hvariant_bucket *sec_bkt;
+	uint32_t prim_hash;
+	uint32_t sec_hash;
+	uint32_t prim_hitmask;
+	uint32_t sec_hitmask;
+	uint32_t could_be_in_secondary;
+	uint32_t prim_version; // Bucket versions (lock-free readers)
+	uint32_t sec_version;
+};
+
+/* Stage 1: compute hash and prefetch buckets */
+static inline void
+stream_stage_hash(struct rte_hash_hvariant *h, const hash_hvariant_key_t *key,
+		struct rte_hash_hvariant_stream_slot *s)
+{
+	uint64_t hash = rte_hash_key(*key);
+	s->prim_hash = hash;
+	s->sec_hash = hash >> 32;
+
+	s->prim_bkt = &h->buckets[s->prim_hash & h->bucket_bitmask];
+	rte_prefetch0(s->prim_bkt);
+
+#if UNCONDITIONAL_PREFETCH
+	s->sec_bkt = &h->buckets[s->sec_hash & h->bucket_bitmask];
+	rte_prefetch0(s->sec_bkt);
 #endif
 
-					if(in_primary_pos){
-#if HORTON
-						if(((sig &0xffffffffU) !=  prim_sig)||
-							((sig >> 32) & ~h->bucket_bitmask) != (sec_sig & ~h->bucket_bitmask)){
-#else
-						if(sig != (prim_sig | (sec_sig << 32))){
+	if (h->lf_versions != NULL) {
+		s->prim_version = lf_version_load(h, s->prim_hash & h->bucket_bitmask);
+		/* Horton secondary bucket is only known once the primary bucket is read */
+		s->sec_version = HORTON ? 0 : lf_version_load(h, s->sec_hash & h->bucket_bitmask);
+		rte_smp_rmb();
+	}
+}
+
+/* Stage 2: compare signatures in primary bucket, prefetch primary key slot and secondary bucket if needed */
+static inline void
+stream_stage_primary(struct rte_hash_hvariant *h, struct rte_hash_hvariant_stream_slot *s,
+		hash_hvariant_time_t currentTime)
+{
+	s->prim_hitmask = matches_and_not_expired_maskpos(s->prim_bkt, s->prim_hash, currentTime);
+	s->sec_hitmask = 0;
+#if UNCONDITIONAL_PREFETCH
+	s->sec_hitmask = matches_and_not_expired_maskpos(s->sec_bkt, s->sec_hash, currentTime);
 #endif
-							uint32_t * key = (uint32_t*)&next_key->key;
-							printf("Expected (Prim): %x %x - Found: %x %x (key position %d)\n", (uint)(sig), (uint)(sig >> 32), (uint)prim_sig, (uint)sec_sig, pos);
-							printf("  Key is %x %x %x %x\n", key[0], key[1], key[2], key[3]);
-							incorrect_hash++;
-						}else{
-							in_primary++;
-						}
-					}else{
-						/* Check that bloom filter is correct*/
 #if BLOOM
-						uint64_t bloom = bloom_mask_64(prim_sig);
-						struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[sec_sig & h->bucket_bitmask];
-						if((prim_bucket->bloom_moved & bloom) != bloom){
-							incorrect_bloom++;
-						}
+	uint64_t bloom = bloom_mask_64(s->sec_hash);
+	s->could_be_in_secondary = (s->prim_bkt->bloom_moved[bloom_word(s->sec_hash)] & bloom) == bloom;
+#elif HORTON
+	s->could_be_in_secondary = horton_get_hindex(s->prim_bkt, s->sec_hash);
+#else
+	s->could_be_in_secondary = 1;
 #endif
-#if HORTON
-						struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[sec_sig & h->bucket_bitmask];
-						int could_be_in_secondary = horton_get_hindex(prim_bucket,prim_sig);
-						if(0 == could_be_in_secondary){
+
+	/* Prefetch the primary key slot */
+	if (s->prim_hitmask) {
+		uint32_t key_idx = (s->prim_hash & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(s->prim_hitmask);
+		rte_prefetch0(&h->key_store[key_idx]);
+	}
+
+	/* Prefetch the secondary bucket */
+	if ((BLOOM && s->could_be_in_secondary) ||
+	    (CONDITIONAL_PREFETCH && 0 == s->prim_hitmask)) {
+		s->sec_bkt = &h->buckets[s->sec_hash & h->bucket_bitmask];
+		rte_prefetch0(s->sec_bkt);
+	}
+
+	/* Prefetch the secondary bucket (horton case) */
+	if (HORTON && s->could_be_in_secondary) {
+		s->sec_hash = horton_sec_hash(h, s->prim_hash, s->sec_hash, s->could_be_in_secondary);
+		s->sec_bkt = &h->buckets[s->sec_hash & h->bucket_bitmask];
+		rte_prefetch0(s->sec_bkt);
+	}
+	if (HORTON && h->lf_versions != NULL) {
+		s->sec_version = lf_version_load(h, s->sec_hash & h->bucket_bitmask);
+		rte_smp_rmb();
+	}
+
+	/* Prefetch the secondary key slot */
+	if (UNCONDITIONAL_PREFETCH && s->sec_hitmask && 0 == s->prim_hitmask) {
+		uint32_t key_idx = (s->sec_hash & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(s->sec_hitmask);
+		rte_prefetch0(&h->key_store[key_idx]);
+	}
+}
+
+/* Stage 3: compare signatures in secondary bucket (if prefetched) and prefetch secondary key slot */
+static inline void
+stream_stage_secondary(struct rte_hash_hvariant *h, struct rte_hash_hvariant_stream_slot *s,
+		hash_hvariant_time_t currentTime)
+{
+	if (((BLOOM || HORTON) && s->could_be_in_secondary) ||
+	    (CONDITIONAL_PREFETCH && 0 == s->prim_hitmask)) {
+		s->sec_hitmask = matches_and_not_expired_maskpos(s->sec_bkt, s->sec_hash, currentTime);
+		if (s->sec_hitmask) {
+			uint32_t key_idx = (s->sec_hash & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(s->sec_hitmask);
+			rte_prefetch0(&h->key_store[key_idx]);
+		}
+	}
+}
+
+/* Stage 4: compare keys, returns 1 on hit */
+static inline int
+stream_stage_key(struct rte_hash_hvariant *h, const hash_hvariant_key_t *key,
+		struct rte_hash_hvariant_stream_slot *s, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime,
+		struct rte_hash_hvariant_op_stats *st)
+{
+	uint32_t hit_index, tmp;
+
+	FOREACH_IN_MASK32(hit_index, s->prim_hitmask, tmp){
+		uint32_t key_idx = (s->prim_hash & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + hit_index;
+		const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
+		OP_STATS_ADD(st, key_compares, 1);
+		if (rte_cmp_eq_key(*key, key_slot->key)) {
+			if (data != NULL)
+				load_data(key_slot, data);
+			return 1;
+		}
+	}
+
+	if (!s->could_be_in_secondary)
+		return 0;
+
+	OP_STATS_ADD(st, secondary_accesses, 1);
+	if (NO_PREFETCH ||
+	    (CONDITIONAL_PREFETCH && 0 != s->prim_hitmask)) {
+		/* Access secondary bucket (not prefetched) */
+		s->sec_bkt = &h->buckets[s->sec_hash & h->bucket_bitmask];
+		s->sec_hitmask = matches_and_not_expired_maskpos(s->sec_bkt, s->sec_hash, currentTime);
+	}
+
+	FOREACH_IN_MASK32(hit_index, s->sec_hitmask, tmp){
+		uint32_t key_idx = (s->sec_hash & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + hit_index;
+		const struct rte_hash_hvariant_key *key_slot = &h->key_store[key_idx];
+		OP_STATS_ADD(st, key_compares, 1);
+		if (rte_cmp_eq_key(*key, key_slot->key)) {
+			if (data != NULL)
+				load_data(key_slot, data);
+			return 1;
+		}
+	}
+
+	OP_STATS_ADD(st, bloom_false_positives, 1);
+	return 0;
+}
+
+/* Return 1 if the buckets of the key were modified while it was in the pipeline (lock-free readers) */
+static inline int
+stream_lf_retry(const struct rte_hash_hvariant *h, const struct rte_hash_hvariant_stream_slot *s)
+{
+	return lf_read_retry(h, s->prim_hash & h->bucket_bitmask, s->prim_version) ||
+	       lf_read_retry(h, s->sec_hash & h->bucket_bitmask, s->sec_version);
+}
+
+int
+H(rte_hash,lookup_stream_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		uint32_t num_keys, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime)
+{
+	RETURN_IF_TRUE(((h == NULL) || (keys == NULL) || (hit_mask == NULL) ||
+			(num_keys > INT32_MAX)), -EINVAL);
+
+	struct rte_hash_hvariant_stream_slot window[RTE_HASH_HVARIANT_STREAM_WINDOW];
+	const uint32_t d = RTE_HASH_HVARIANT_STREAM_DISTANCE;
+	const uint32_t wmask = RTE_HASH_HVARIANT_STREAM_WINDOW - 1;
+	struct rte_hash_hvariant_op_stats *st = op_stats_local(h);
+	uint32_t i, j;
+	int hits = 0;
+
+	memset(hit_mask, 0, ((num_keys + 63) / 64) * sizeof(uint64_t));
+
+	/* Software pipeline: at step i, key i enters stage 1, key i-d stage 2,
+	 * key i-2d stage 3 and key i-3d leaves the pipeline (stage 4).
+	 * Keys flow continuously, the pipeline is only filled and drained once. */
+	for (i = 0; i < num_keys + 3 * d; i++) {
+		if (i < num_keys)
+			stream_stage_hash(h, &keys[i], &window[i & wmask]);
+
+		j = i - d;
+		if (i >= d && j < num_keys)
+			stream_stage_primary(h, &window[j & wmask], currentTime);
+
+		j = i - 2 * d;
+		if (i >= 2 * d && j < num_keys)
+			stream_stage_secondary(h, &window[j & wmask], currentTime);
+
+		j = i - 3 * d;
+		if (i >= 3 * d && j < num_keys) {
+			hash_hvariant_data_t *data_j = data != NULL ? &data[j] : NULL;
+			int hit = stream_stage_key(h, &keys[j], &window[j & wmask], data_j, currentTime, st);
+
+			if (!hit && unlikely(h->stash_mask != 0))
+				hit = stash_lookup(h, keys[j], window[j & wmask].prim_hash, data_j, currentTime, 0, 0) >= 0;
+
+			/* Key looked up again if its buckets were modified by the writer */
+			if (h->lf_versions != NULL && stream_lf_retry(h, &window[j & wmask]))
+				hit = __rte_hash_hvariant_lookup_with_hash_lf(h, keys[j], rte_hash_key(keys[j]),
+						data_j, currentTime) >= 0;
+			if (hit) {
+				hit_mask[j >> 6] |= 1ULL << (j & 63);
+				hits++;
+			}
+		}
+	}
+
+	/* While the table is resized, keys missed may still be in the old arrays */
+	if (unlikely(h->resize_src != NULL)) {
+		for (i = 0; i < num_keys; i += 64) {
+			uint32_t n = RTE_MIN(num_keys - i, 64u);
+			uint64_t misses = ((uint64_t)-1 >> (64 - n)) & ~hit_mask[i >> 6];
+			uint64_t src_hits = 0;
+			if (misses == 0)
+				continue;
+			__rte_hash_hvariant_lookup_bulk(h->resize_src, &keys[i], misses, &src_hits, NULL,
+							data != NULL ? &data[i] : NULL, currentTime, 0, 0, NULL, NULL);
+			hit_mask[i >> 6] |= src_hits;
+			hits += __builtin_popcountll(src_hits);
+		}
+	}
+
+	op_stats_lookups(h, num_keys, hits);
+	return hits;
+}
+
+
+/* Delete keys from the buckets (and the stash) of a table, returns the mask of keys deleted */
+static inline uint64_t
+__rte_hash_hvariant_del_key_bulk(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		uint64_t lookup_mask, hash_hvariant_time_t currentTime)
+{
+	uint64_t deleted = 0, tmpm;
+	int32_t i;
+	uint32_t prim_hash[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t sec_hash[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	struct rte_hash_hvariant_bucket *primary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	struct rte_hash_hvariant_bucket *secondary_bkt[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t prim_hitmask[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t sec_hitmask[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+	uint32_t could_be_in_secondary[RTE_HASH_HVARIANT_LOOKUP_BULK_MAX];
+
+	/* Calculate hashes and prefetch primary buckets */
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		uint64_t hash = rte_hash_key(keys[i]);
+		prim_hash[i] = hash;
+		sec_hash[i] = hash >> 32;
+
+		primary_bkt[i] = &h->buckets[prim_hash[i] & h->bucket_bitmask];
+		rte_prefetch0(primary_bkt[i]);
+#if UNCONDITIONAL_PREFETCH
+		secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
+		rte_prefetch0(secondary_bkt[i]);
+#endif
+	}
+
+	/* Compare signatures, prefetch key slot of first hit and secondary bucket if needed */
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		prim_hitmask[i] = matches_and_not_expired_maskpos(primary_bkt[i], prim_hash[i], currentTime);
+		sec_hitmask[i] = 0;
+#if BLOOM
+		uint64_t bloom = bloom_mask_64(sec_hash[i]);
+		could_be_in_secondary[i] = (primary_bkt[i]->bloom_moved[bloom_word(sec_hash[i])] & bloom) == bloom;
+#elif HORTON
+		could_be_in_secondary[i] = horton_get_hindex(primary_bkt[i],sec_hash[i]);
+		if(could_be_in_secondary[i])
+			sec_hash[i] = horton_sec_hash(h,prim_hash[i],sec_hash[i],could_be_in_secondary[i]);
+#else
+		could_be_in_secondary[i] = 1;
+#endif
+
+		/* Prefetch the primary key slot */
+		if (prim_hitmask[i]) {
+			uint32_t key_idx = (prim_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(prim_hitmask[i]);
+			rte_prefetch0(&h->key_store[key_idx]);
+		}
+
+		/* Prefetch the secondary bucket (a key to delete is generally found in primary bucket
+		 * so variants without filter only check the secondary bucket when the primary has no candidate) */
+		if (could_be_in_secondary[i] && !UNCONDITIONAL_PREFETCH &&
+		    (BLOOM || HORTON || 0 == prim_hitmask[i])) {
+			secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
+			rte_prefetch0(secondary_bkt[i]);
+		}
+	}
+
+	/* Compare signatures in secondary buckets and prefetch key slot of first hit */
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		if (could_be_in_secondary[i] &&
+		    (UNCONDITIONAL_PREFETCH || BLOOM || HORTON || 0 == prim_hitmask[i])) {
+			sec_hitmask[i] = matches_and_not_expired_maskpos(secondary_bkt[i], sec_hash[i], currentTime);
+			if (sec_hitmask[i]) {
+				uint32_t key_idx = (sec_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(sec_hitmask[i]);
+				rte_prefetch0(&h->key_store[key_idx]);
+			}
+		}
+	}
+
+	/* Compare keys and delete. Busy bits are checked again, as an entry may have been deleted
+	 * by a previous occurrence of the same key in the batch */
+	FOREACH_IN_MASK64(i, lookup_mask, tmpm){
+		uint32_t hit_index, tmp;
+		if (h->multi_writer) {
+			/* Entries may have moved since the signatures were compared: search again
+			 * holding the locks (buckets are in cache) */
+			if (__rte_hash_hvariant_del_key_with_hash(h, keys[i], ((uint64_t)sec_hash[i] << 32) | prim_hash[i], currentTime) == RHL_FOUND_UPDATED)
+				deleted |= 1ULL << i;
+			continue;
+		}
+		uint32_t matches = prim_hitmask[i] & primary_bkt[i]->mask_busy;
+		FOREACH_IN_MASK32(hit_index, matches, tmp){
+			uint32_t key_idx = (prim_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + hit_index;
+			if (rte_cmp_eq_key(keys[i], h->key_store[key_idx].key)) {
+				delete_bucket_entry(h, primary_bkt[i], hit_index, currentTime);
+				deleted |= 1ULL << i;
+				goto next_key;
+			}
+		}
+
+		if (!could_be_in_secondary[i])
+			continue;
+
+		if (!UNCONDITIONAL_PREFETCH && !BLOOM && !HORTON && 0 != prim_hitmask[i]) {
+			/* Access secondary bucket (not prefetched) */
+			secondary_bkt[i] = &h->buckets[sec_hash[i] & h->bucket_bitmask];
+			sec_hitmask[i] = matches_and_not_expired_maskpos(secondary_bkt[i], sec_hash[i], currentTime);
+		}
+
+		matches = sec_hitmask[i] & secondary_bkt[i]->mask_busy;
+		FOREACH_IN_MASK32(hit_index, matches, tmp){
+			uint32_t key_idx = (sec_hash[i] & h->bucket_bitmask) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + hit_index;
+			if (rte_cmp_eq_key(keys[i], h->key_store[key_idx].key)) {
+				delete_bucket_entry(h, secondary_bkt[i], hit_index, currentTime);
+				deleted |= 1ULL << i;
+				goto next_key;
+			}
+		}
+next_key:
+		continue;
+	}
+
+	/* Keys not found may be in the stash */
+	if (unlikely(h->stash_mask != 0)) {
+		FOREACH_IN_MASK64(i, lookup_mask & ~deleted, tmpm){
+			if (stash_del(h, keys[i], prim_hash[i], currentTime) == RHL_FOUND_UPDATED)
+				deleted |= 1ULL << i;
+		}
+	}
+
+	return deleted;
+}
+
+int
+H(rte_hash,del_key_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys,
+		uint64_t lookup_mask, uint64_t *deleted_mask, hash_hvariant_time_t currentTime)
+{
+	RETURN_IF_TRUE(((h == NULL) || (keys == NULL)), -EINVAL);
+
+	uint64_t deleted, tmpm;
+	int32_t i;
+
+	deleted = __rte_hash_hvariant_del_key_bulk(h, keys, lookup_mask, currentTime);
+
+	/* While the table is resized, keys not found may still be in the old arrays */
+	if (unlikely(h->resize_src != NULL) && (lookup_mask & ~deleted) != 0)
+		deleted |= __rte_hash_hvariant_del_key_bulk(h->resize_src, keys, lookup_mask & ~deleted, currentTime);
+
+	/* Slots freed may be used by stash entries */
+	if (unlikely(h->stash_mask != 0)) {
+		FOREACH_IN_MASK64(i, deleted, tmpm){
+			stash_reinsert_key(h, rte_hash_key(keys[i]), currentTime);
+			if (h->stash_mask == 0)
+				break;
+		}
+	}
+
+	if (deleted_mask != NULL)
+		*deleted_mask = deleted;
+
+	return __builtin_popcountll(deleted);
+}
+
+
+void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime){
+	RETURN_IF_TRUE((h == NULL) , -EINVAL);
+	struct rte_hash_hvariant_key *next_key;
+	uint32_t i,j;
+
+	int incorrect_bucket = 0;
+	int incorrect_bloom = 0;
+	int incorrect_horton = 0;
+	int incorrect_hash = 0;
+	int in_primary = 0;
+	int in_secondary = 0;
+	int total = 0;
+	for(i = 0; i < h->num_buckets ; i++){
+		//printf("Bucket %d %x %x\n",i,i,h->buckets[i].self_index);
+		for(j=0;j<RTE_HASH_HVARIANT_BUCKET_ENTRIES;j++){
+			if(!free_or_expired(&h->buckets[i],j,currentTime)){
+					/* Get position of entry in key table */
+					int pos = i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j;
+					next_key = &h->key_store[pos];
+
+					/* Return key, data and remaining time */
+					hash_hvariant_key_t key = next_key->key;
+
+					/* Check that current signature is coherent with position */
+					if(((h->buckets[i].primary_signature_high[j] ^ signature_high(i)) & (h->bucket_bitmask >> 16)) != 0){
+						//printf("Incorrect bucket: %x %x\n", h->buckets[i].primary_signature_high[j],i>>16);
+						incorrect_bucket++;
+					}
+
+					/* Only compare the bits of hashes that are stored in buckets */
+					uint64_t sig = rte_hash_key(key) & signature_bits64(h);
+
+					uint64_t prim_sig = primary_signature(h,&h->buckets[i],j);
+					uint64_t sec_sig = secondary_signature(h,&h->buckets[i],j);
+
+#if BLOOM
+					int in_primary_pos = !get_bit_in_mask(&h->buckets[i].mask_in_secondary_position,j);
+#else
+					int in_primary_pos = (sig & 0xffffffffULL) == prim_sig;
+#endif
+
+					if(in_primary_pos){
+#if HORTON
+						if(((sig &0xffffffffU) !=  prim_sig)||
+							((sig >> 32) & ~h->bucket_bitmask) != (sec_sig & ~h->bucket_bitmask)){
+#else
+						if(sig != ((prim_sig | (sec_sig << 32)) & signature_bits64(h))){
+#endif
+							printf("Expected (Prim): %x %x - Found: %x %x (key position %d)\n", (uint)(sig), (uint)(sig >> 32), (uint)prim_sig, (uint)sec_sig, pos);
+							print_key(next_key);
+							incorrect_hash++;
+						}else{
+							in_primary++;
+						}
+					}else{
+						/* Check that bloom filter is correct*/
+#if BLOOM
+						uint64_t bloom = bloom_mask_64(prim_sig);
+						struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[sec_sig & h->bucket_bitmask];
+						if((prim_bucket->bloom_moved[bloom_word(prim_sig)] & bloom) != bloom){
+							incorrect_bloom++;
+						}
+#endif
+#if HORTON
+						struct rte_hash_hvariant_bucket * prim_bucket = &h->buckets[sec_sig & h->bucket_bitmask];
+						int could_be_in_secondary = horton_get_hindex(prim_bucket,prim_sig);
+						if(0 == could_be_in_secondary){
 							printf("horton: %d should not be zero\n", could_be_in_secondary);
 							incorrect_horton++;
 						}
@@ -1688,11 +4557,10 @@ void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, uint16_t currentTi
 						if(((sig &0xffffffffU) !=  sec_sig)||
 							((sig >> 32) & ~h->bucket_bitmask) != (prim_sig & ~h->bucket_bitmask)){
 #else
-						if(sig != (sec_sig | (prim_sig << 32))){
+						if(sig != ((sec_sig | (prim_sig << 32)) & signature_bits64(h))){
 #endif
-							uint32_t * key = (uint32_t*)&next_key->key;
 							printf("Expected (Seco): %x %x - Found: %x %x (key position %d)\n", (uint)(sig), (uint)(sig >> 32), (uint)prim_sig, (uint)sec_sig, pos);
-							printf("  Key is %x %x %x %x\n", key[0], key[1], key[2], key[3]);
+							print_key(next_key);
 							incorrect_hash++;
 						}else{
 							in_secondary++;
@@ -1709,9 +4577,59 @@ void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, uint16_t currentTi
 	if(incorrect_horton > 0 ) printf("HASH: Incorrect horton (%d occurrences)\n", incorrect_horton);
 
 	printf("%.2f primary, %.2f secondary\n",(double)in_primary/(double)total, (double)in_secondary/(double)total);
+
+	if (h->stash_mask != 0) {
+		int incorrect_stash = 0;
+		FOREACH_IN_MASK32(i, h->stash_mask, j){
+			uint64_t sig = rte_hash_key(h->stash_keys[i].key);
+			if (sig != (((uint64_t)h->stash_sec_hash[i] << 32) | h->stash_prim_hash[i]))
+				incorrect_stash++;
+		}
+		printf("%d entries in stash\n", __builtin_popcount(h->stash_mask));
+		if(incorrect_stash > 0 ) printf("HASH: Incorrect stash hash (%d occurrences)\n", incorrect_stash);
+	}
+
+	if (h->resize_src != NULL) {
+		printf("Old arrays (resize in progress, %u/%u buckets moved):\n", h->resize_next, h->resize_src->num_buckets);
+		H(rte_hash,check_integrity)(h->resize_src, currentTime);
+	}
+}
+
+int
+H(rte_hash,op_stats)(const struct rte_hash_hvariant *h, struct rte_hash_hvariant_op_stats *stats)
+{
+	unsigned l;
+
+	if (h == NULL || stats == NULL)
+		return -EINVAL;
+	if (!OP_STATS)
+		return -ENOTSUP;
+
+	memset(stats, 0, sizeof(*stats));
+	/* Slots are read while other lcores update them: each counter is read atomically,
+	 * but the counters of a slot may be from slightly different times */
+	for (l = 0; l <= RTE_MAX_LCORE; l++) {
+		const volatile struct rte_hash_hvariant_op_stats *s = &h->op_stats[l].s;
+		stats->lookups += s->lookups;
+		stats->hits += s->hits;
+		stats->secondary_accesses += s->secondary_accesses;
+		stats->bloom_false_positives += s->bloom_false_positives;
+		stats->key_compares += s->key_compares;
+		stats->cuckoo_moves += s->cuckoo_moves;
+		stats->max_path_len = RTE_MAX(stats->max_path_len, s->max_path_len);
+		stats->enospc += s->enospc;
+	}
+	return 0;
 }
 
-double H(rte_hash,stats_secondary)(struct rte_hash_hvariant *h, uint16_t currentTime){
+void
+H(rte_hash,op_stats_reset)(struct rte_hash_hvariant *h)
+{
+	if (OP_STATS && h != NULL)
+		memset(h->op_stats, 0, (RTE_MAX_LCORE + 1) * sizeof(struct op_stats_slot));
+}
+
+double H(rte_hash,stats_secondary)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime){
 	RETURN_IF_TRUE((h == NULL) , -EINVAL);
 
 	uint32_t i,j;
@@ -1729,13 +4647,13 @@ double H(rte_hash,stats_secondary)(struct rte_hash_hvariant *h, uint16_t current
 					struct rte_hash_hvariant_key *next_key = &h->key_store[pos];
 
 					/* Return key, data and remaining time */
-					hash_key_t key = next_key->key;
+					hash_hvariant_key_t key = next_key->key;
 
-					uint64_t sig = rte_hash_m128i(key);
+					uint64_t sig = rte_hash_key(key) & signature_bits64(h);
 
 
-					uint64_t sec_sig = h->buckets[i].secondary_signature_full[j];
-					int in_secondary_pos = (sig & 0xffffffffULL) == sec_sig;
+					uint64_t sec_sig = secondary_signature(h,&h->buckets[i],j);
+					int in_secondary_pos = (sig & 0xffffffffULL) == (sec_sig & signature_bits64(h));
 #endif
 
 					if(in_secondary_pos){
@@ -1770,18 +4688,71 @@ H(rte_hash,iterator_reset)(struct rte_hash_hvariant *h)
 			h->buckets[i].mask_iterated_over = 0;
 	}
 #endif
+	h->stash_iterated = 0;
+	h->iter_nb_parts = 0;
+	if (h->resize_src != NULL)
+		H(rte_hash,iterator_reset)(h->resize_src);
+}
+
+int
+H(rte_hash,iterator_reset_partitions)(struct rte_hash_hvariant *h, uint32_t nb_parts)
+{
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	if (nb_parts == 0 || nb_parts > RTE_HASH_HVARIANT_ITER_MAX_PARTS)
+		return -EINVAL;
+
+	H(rte_hash,iterator_reset)(h);
+	h->iter_nb_parts = nb_parts;
+	iter_partitions_rewind(h);
+	if (h->resize_src != NULL) {
+		h->resize_src->iter_nb_parts = nb_parts;
+		iter_partitions_rewind(h->resize_src);
+	}
+	return 0;
 }
 
 
+/* Return the next stash entry not iterated over yet */
+static inline int32_t
+stash_iterate(struct rte_hash_hvariant *h, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, __rte_unused hash_hvariant_time_t currentTime)
+{
+	unsigned i, tmp;
+
+	FOREACH_IN_MASK32(i, h->stash_mask & ~h->stash_iterated, tmp){
+		h->stash_iterated |= 1U << i;
+#if TIMER
+		if (expired_timer(h->stash_expire[i], currentTime)) {
+			h->stash_mask &= ~(1U << i);
+			continue;
+		}
+		*remaining_time = time_diff(h->stash_expire[i], currentTime);
+#else
+		*remaining_time = 0;
+#endif
+		*key = h->stash_keys[i].key;
+		load_data(&h->stash_keys[i], data);
+		return 0;
+	}
+	return -ENOENT;
+}
+
 #ifdef FAST_ITERATOR
 int32_t
-H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *data, uint16_t * remaining_time, uint16_t currentTime)
+H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime)
 {
 	struct rte_hash_hvariant_key *next_key;
 	uint32_t max_iteration = 2048; // Limit the maximum pause for iterating ( 2048 buckets iterated ~= time to receive 32 packets)
 
 	RETURN_IF_TRUE((h == NULL) , -EINVAL);
 
+	/* While the table is resized, entries not moved yet are iterated over first */
+	if (unlikely(h->resize_src != NULL)) {
+		int32_t ret = H(rte_hash,iterate)(h->resize_src, key, data, remaining_time, currentTime);
+		if (ret != -ENOENT)
+			return ret;
+	}
+
 	for(uint32_t current_groupgroup = h->iter_bucket_idx/ITERATOR_GROUP/64;current_groupgroup < h->num_buckets / ITERATOR_GROUP/64; current_groupgroup++){
 		if(h->iter_group_bucket_mask[current_groupgroup] == 0xffffffffffffffffULL){
 			// Group Group has been fully iterated, continue to next Group group
@@ -1807,10 +4778,12 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
 						uint32_t i = h->iter_bucket_idx;
 
 						// If all entries in bucket have been iterated, skip to next bucket;
-						if(h->buckets[i].mask_iterated_over == 0xff) continue;
+						if(h->buckets[i].mask_iterated_over == ENTRIES_MASK) continue;
 
 						// Otherwise, update the free bit mask (to ensure that expired entries are definitively expired)
-						h->buckets[i].mask_busy = ~free_or_expired_maskpos(&h->buckets[i], currentTime);
+						bucket_mask_t busy = ~free_or_expired_maskpos(&h->buckets[i], currentTime) & ENTRIES_MASK;
+						busy_slots_released(h, __builtin_popcount(h->buckets[i].mask_busy & ~busy));
+						h->buckets[i].mask_busy = busy;
 
 						// Iterate over entries
 						for(uint32_t j=0;j<RTE_HASH_HVARIANT_BUCKET_ENTRIES;j++){
@@ -1823,7 +4796,7 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
 
 									/* Return key, data and remaining time */
 									*key = next_key->key;
-									*data = next_key->data;
+									load_data(next_key, data);
 			#if TIMER
 									*remaining_time = time_diff(h->buckets[i].expire_date_timeunit[j],currentTime);
 			#else
@@ -1840,17 +4813,26 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
 			}
 		}
 	}
+	if (unlikely(h->stash_mask != 0))
+		return stash_iterate(h, key, data, remaining_time, currentTime);
 	return -ENOENT;
 }
 #else
 int32_t
-H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *data, uint16_t * remaining_time, uint16_t currentTime)
+H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime)
 {
 	struct rte_hash_hvariant_key *next_key;
 	uint32_t max_iteration = 2048; // Limit the maximum pause for iterating ( 2048 buckets iterated ~= time to receive 32 packets)
 
 	RETURN_IF_TRUE((h == NULL) , -EINVAL);
 
+	/* While the table is resized, entries not moved yet are iterated over first */
+	if (unlikely(h->resize_src != NULL)) {
+		int32_t ret = H(rte_hash,iterate)(h->resize_src, key, data, remaining_time, currentTime);
+		if (ret != -ENOENT)
+			return ret;
+	}
+
 	for(;h->iter_bucket_idx < h->num_buckets ;h->iter_bucket_idx++){
 			if(0 == max_iteration--){
 				return -EBUSY;
@@ -1858,10 +4840,12 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
 			uint32_t i = h->iter_bucket_idx;
 
 			// If all entries in bucket have been iterated, skip to next bucket;
-			if(h->buckets[i].mask_iterated_over == 0xff) continue;
+			if(h->buckets[i].mask_iterated_over == ENTRIES_MASK) continue;
 
 		    // Otherwise, update the free bit mask (to ensure that expired entries are definitively expired)
-			h->buckets[i].mask_busy = ~free_or_expired_maskpos(&h->buckets[i], currentTime);
+			bucket_mask_t busy = ~free_or_expired_maskpos(&h->buckets[i], currentTime) & ENTRIES_MASK;
+			busy_slots_released(h, __builtin_popcount(h->buckets[i].mask_busy & ~busy));
+			h->buckets[i].mask_busy = busy;
 
 			// Iterate over entries
 			for(uint32_t j=0;j<RTE_HASH_HVARIANT_BUCKET_ENTRIES;j++){
@@ -1874,7 +4858,7 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
 
 						/* Return key, data and remaining time */
 						*key = next_key->key;
-						*data = next_key->data;
+						load_data(next_key, data);
 #if TIMER
 						*remaining_time = time_diff(h->buckets[i].expire_date_timeunit[j],currentTime);
 #else
@@ -1886,61 +4870,1049 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
 				}
 			}
 	}
+	if (unlikely(h->stash_mask != 0))
+		return stash_iterate(h, key, data, remaining_time, currentTime);
 	return -ENOENT;
 
 }
 #endif
 
 
-int32_t
-H(rte_hash,unsafe_iterate)(struct rte_hash_hvariant *h, uint64_t * pos, hash_key_t *key, hash_data_t *data, uint16_t * remaining_time, uint16_t currentTime)
+/*
+ * Batched iterators
+ *
+ * iterate_bulk() and unsafe_iterate_bulk() select the live entries of a whole bucket at once from
+ * its masks and timers, and copy them to the caller arrays. The key_store slots of the busy entries
+ * of bucket i + ITER_BULK_PREFETCH are prefetched while bucket i is copied.
+ */
+#define ITER_BULK_PREFETCH 4
+
+static inline void
+iterate_bulk_prefetch(const struct rte_hash_hvariant *t, uint32_t i)
 {
-	struct rte_hash_hvariant_key *next_key;
+	uint32_t j, tmp;
 
-	RETURN_IF_TRUE((h == NULL) , -EINVAL);
+	if (i >= t->num_buckets)
+		return;
+	FOREACH_IN_MASK32(j, t->buckets[i].mask_busy, tmp){
+		rte_prefetch0(&t->key_store[i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j]);
+	}
+}
 
-	for(; (*pos) < h->num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES ; (*pos)++){
-			uint32_t i = (*pos)/RTE_HASH_HVARIANT_BUCKET_ENTRIES;
-			uint32_t j = (*pos) - i*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+/* Copy at most n entries of bucket i among live (lowest slots first), and clear them from live */
+static inline uint32_t
+iterate_bulk_copy(const struct rte_hash_hvariant *t, uint32_t i, uint32_t *live, uint32_t n, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, __rte_unused hash_hvariant_time_t currentTime)
+{
+	uint32_t c;
 
-			if(!free_or_expired(&h->buckets[i],j,currentTime)){
-				/* Get position of entry in key table */
-				int p = i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j;
-				next_key = &h->key_store[p];
+	for (c = 0; *live != 0 && c < n; c++) {
+		uint32_t j = __builtin_ctz(*live);
+		const struct rte_hash_hvariant_key *k = &t->key_store[i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j];
 
-				/* Return key, data and remaining time */
-				*key = next_key->key;
-				*data = next_key->data;
+		keys[c] = k->key;
+		load_data(k, &data[c]);
 #if TIMER
-				*remaining_time = time_diff(h->buckets[i].expire_date_timeunit[j],currentTime);
+		remaining_times[c] = time_diff(t->buckets[i].expire_date_timeunit[j],currentTime);
 #else
-				*remaining_time = 0;
+		remaining_times[c] = 0;
 #endif
-				(*pos)++;
-				return 0;
-			}
+		*live &= *live - 1;
 	}
-	return -ENOENT;
-
+	return c;
 }
 
+/* Copy at most n entries of bucket i not iterated over yet, releasing the slots of expired entries as iterate() */
+static inline uint32_t
+iterate_bulk_bucket(struct rte_hash_hvariant *t, uint32_t i, uint32_t n, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_bucket *b = &t->buckets[i];
+	uint32_t todo = ~b->mask_iterated_over & ENTRIES_MASK;
+	uint32_t busy, live, c;
 
+	if (todo == 0)
+		return 0;
 
-#define MAX_DIST_MOVED 16u
+	busy = ~free_or_expired_maskpos(b, currentTime) & ENTRIES_MASK;
+	busy_slots_released(t, __builtin_popcount(b->mask_busy & ~busy));
+	b->mask_busy = busy;
 
-void H(rte_hash,print_stats)(struct rte_hash_hvariant *h, uint16_t currentTime){
-	unsigned i,j;
-	int count_bucket_per_occupation[RTE_HASH_HVARIANT_BUCKET_ENTRIES+1];
-	memset(count_bucket_per_occupation,0,(RTE_HASH_HVARIANT_BUCKET_ENTRIES+1)*sizeof(int));
-	unsigned entriesOccupied = 0;
-	__rte_unused int count_bucket_per_movedsecondarycount[MAX_DIST_MOVED]= {0};
+	live = busy & todo;
+	c = iterate_bulk_copy(t, i, &live, n, keys, data, remaining_times, currentTime);
 
-	for( i = 0 ; i < h->num_buckets; i++){
-		//if(h->buckets[i].bloom_moved != 0 && h->buckets[i].bloom_moved != 0xffff ) printf("B: %lx\n",h->buckets[i].bloom_moved);
-		//if(h->buckets[i].mask_in_secondary_position) printf("MSP: %x\n",(uint32_t)h->buckets[i].mask_in_secondary_position);
-		int occupied=0;
-		for(j = 0 ; j < RTE_HASH_HVARIANT_BUCKET_ENTRIES; j++){
-			if(!free_or_expired(&h->buckets[i],j,currentTime)){
+	/* Entries before the first one not copied are iterated over */
+	b->mask_iterated_over |= live ? todo & ((1U << __builtin_ctz(live)) - 1) : todo;
+	return c;
+}
+
+/* Iterate over the buckets of table t (h or the old arrays of h being resized) until n entries are
+ * copied or budget buckets are scanned. Fewer than n entries with budget left means the end of t. */
+#ifdef FAST_ITERATOR
+static inline uint32_t
+iterate_bulk_table(struct rte_hash_hvariant *t, uint32_t *budget, uint32_t n, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, hash_hvariant_time_t currentTime)
+{
+	uint32_t c = 0;
+
+	for(uint32_t current_groupgroup = t->iter_bucket_idx/ITERATOR_GROUP/64;current_groupgroup < t->num_buckets / ITERATOR_GROUP/64; current_groupgroup++){
+		if(t->iter_group_bucket_mask[current_groupgroup] == 0xffffffffffffffffULL){
+			t->iter_bucket_idx = (current_groupgroup+1)*ITERATOR_GROUP*64;
+			continue;
+		}
+		for(uint32_t current_group = current_groupgroup*64;current_group < (current_groupgroup+1)*64;current_group++){
+			if(get_bit_in_largemask(t->iter_group_bucket_mask, current_group)){
+				t->iter_bucket_idx = (current_group+1)*ITERATOR_GROUP;
+				continue;
+			}
+			if(get_bit_in_largemask(t->reset_group_bucket_mask, current_group)){
+				reset_iterator_group(t, current_group);
+			}
+			for(;t->iter_bucket_idx < (current_group+1)*ITERATOR_GROUP ;t->iter_bucket_idx++){
+				if(*budget == 0)
+					return c;
+				(*budget)--;
+				iterate_bulk_prefetch(t, t->iter_bucket_idx + ITER_BULK_PREFETCH);
+				c += iterate_bulk_bucket(t, t->iter_bucket_idx, n - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+				/* The bucket may hold entries that did not fit: stay on it */
+				if(c == n)
+					return c;
+			}
+			set_bit_in_largemask(t->iter_group_bucket_mask, current_group);
+		}
+	}
+	return c;
+}
+#else
+static inline uint32_t
+iterate_bulk_table(struct rte_hash_hvariant *t, uint32_t *budget, uint32_t n, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, hash_hvariant_time_t currentTime)
+{
+	uint32_t c = 0;
+
+	for(;t->iter_bucket_idx < t->num_buckets ;t->iter_bucket_idx++){
+		if(*budget == 0)
+			return c;
+		(*budget)--;
+		iterate_bulk_prefetch(t, t->iter_bucket_idx + ITER_BULK_PREFETCH);
+		c += iterate_bulk_bucket(t, t->iter_bucket_idx, n - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+		/* The bucket may hold entries that did not fit: stay on it */
+		if(c == n)
+			return c;
+	}
+	return c;
+}
+#endif
+
+static inline uint32_t
+iterate_bulk_stash(struct rte_hash_hvariant *t, uint32_t n, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, hash_hvariant_time_t currentTime)
+{
+	uint32_t c = 0;
+
+	while (c < n && stash_iterate(t, &keys[c], &data[c], &remaining_times[c], currentTime) == 0)
+		c++;
+	return c;
+}
+
+int32_t
+H(rte_hash,iterate_bulk)(struct rte_hash_hvariant *h, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, uint32_t num_entries, hash_hvariant_time_t currentTime)
+{
+	uint32_t budget = 2048; // Same pause limit as iterate()
+	uint32_t c = 0;
+
+	RETURN_IF_TRUE((h == NULL || keys == NULL || remaining_times == NULL), -EINVAL);
+
+	if (num_entries == 0 || num_entries > RTE_HASH_HVARIANT_ITER_BULK_MAX)
+		return -EINVAL;
+
+	/* While the table is resized, entries not moved yet are iterated over first */
+	if (unlikely(h->resize_src != NULL)) {
+		c = iterate_bulk_table(h->resize_src, &budget, num_entries, keys, data, remaining_times, currentTime);
+		if (c < num_entries && budget != 0 && unlikely(h->resize_src->stash_mask != 0))
+			c += iterate_bulk_stash(h->resize_src, num_entries - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+	}
+
+	if (c < num_entries && budget != 0)
+		c += iterate_bulk_table(h, &budget, num_entries - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+	if (c < num_entries && budget != 0 && unlikely(h->stash_mask != 0))
+		c += iterate_bulk_stash(h, num_entries - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+
+	if (c > 0)
+		return c;
+	return budget == 0 ? -EBUSY : -ENOENT;
+}
+
+/* Same as iterate_bulk_table(), for unsafe_iterate_bulk(): positions are those of unsafe_iterate() */
+static inline uint32_t
+unsafe_iterate_bulk_table(const struct rte_hash_hvariant *t, uint64_t * pos, uint32_t n, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, hash_hvariant_time_t currentTime)
+{
+	const uint64_t end = (uint64_t)t->num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+	uint32_t c = 0;
+
+	while ((*pos) < end && c < n) {
+		uint32_t i = (*pos)/RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+		uint32_t j = (*pos) - i*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+		uint32_t live;
+
+		iterate_bulk_prefetch(t, i + ITER_BULK_PREFETCH);
+		live = ~free_or_expired_maskpos(&t->buckets[i], currentTime) & ENTRIES_MASK & ~((1U << j) - 1);
+		c += iterate_bulk_copy(t, i, &live, n - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+		if (live != 0) {
+			*pos = (uint64_t)i*RTE_HASH_HVARIANT_BUCKET_ENTRIES + __builtin_ctz(live);
+			return c;
+		}
+		*pos = (uint64_t)(i + 1)*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+	}
+
+	/* Then positions of the stash entries */
+	for(; (*pos) < end + RTE_HASH_HVARIANT_STASH_SIZE && c < n ; (*pos)++){
+		uint32_t i = (*pos) - end;
+
+		if((t->stash_mask & (1U << i)) && !(TIMER && expired_timer(t->stash_expire[i], currentTime))){
+			keys[c] = t->stash_keys[i].key;
+			load_data(&t->stash_keys[i], &data[c]);
+			remaining_times[c] = TIMER ? time_diff(t->stash_expire[i], currentTime) : 0;
+			c++;
+		}
+	}
+	return c;
+}
+
+int32_t
+H(rte_hash,unsafe_iterate_bulk)(struct rte_hash_hvariant *h, uint64_t * pos, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, uint32_t num_entries, hash_hvariant_time_t currentTime)
+{
+	uint32_t c;
+
+	RETURN_IF_TRUE((h == NULL || pos == NULL || keys == NULL || remaining_times == NULL), -EINVAL);
+
+	if (num_entries == 0 || num_entries > RTE_HASH_HVARIANT_ITER_BULK_MAX)
+		return -EINVAL;
+
+	c = unsafe_iterate_bulk_table(h, pos, num_entries, keys, data, remaining_times, currentTime);
+
+	/* While the table is resized, positions past the new arrays are in the old ones */
+	if (c < num_entries && unlikely(h->resize_src != NULL)) {
+		uint64_t base = (uint64_t)h->num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES + RTE_HASH_HVARIANT_STASH_SIZE;
+		uint64_t src_pos = *pos - base;
+
+		c += unsafe_iterate_bulk_table(h->resize_src, &src_pos, num_entries - c, &keys[c], &data[c], &remaining_times[c], currentTime);
+		*pos = base + src_pos;
+	}
+	return c > 0 ? (int32_t)c : -ENOENT;
+}
+
+
+/* Return the next entry of bucket i not iterated over yet. Expired entries are skipped but left
+ * in place: the bucket is only written to mark entries as iterated over */
+static inline int32_t
+iterate_bucket(struct rte_hash_hvariant *t, uint32_t i, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, __rte_unused hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_bucket *b = &t->buckets[i];
+	uint32_t todo = ~b->mask_iterated_over & ENTRIES_MASK;
+	uint32_t live, j;
+
+	if (todo == 0)
+		return -ENOENT;
+
+	live = ~free_or_expired_maskpos(b, currentTime) & todo;
+	if (live == 0) {
+		b->mask_iterated_over = ENTRIES_MASK;
+		return -ENOENT;
+	}
+
+	/* Entries up to the returned one are iterated over */
+	j = __builtin_ctz(live);
+	b->mask_iterated_over |= todo & ((2U << j) - 1);
+
+	*key = t->key_store[i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j].key;
+	load_data(&t->key_store[i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j], data);
+#if TIMER
+	*remaining_time = time_diff(b->expire_date_timeunit[j],currentTime);
+#else
+	*remaining_time = 0;
+#endif
+	return 0;
+}
+
+/* Iterate over the buckets of partition part of table t (h or the old arrays of h being resized) */
+static inline int32_t
+iterate_partition_table(struct rte_hash_hvariant *t, uint32_t part, uint32_t *budget, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime)
+{
+	uint32_t *next = &t->iter_parts[part].next;
+	const uint32_t end = iter_partition_first_word(t, part + 1)*ITERATOR_GROUP*64;
+
+	while (*next < end) {
+		uint32_t group = *next/ITERATOR_GROUP;
+
+		if (t->iter_group_bucket_mask[group >> 6] == 0xffffffffffffffffULL) {
+			// Group Group has been fully iterated, continue to next Group group
+			*next = ((group >> 6) + 1)*ITERATOR_GROUP*64;
+			continue;
+		}
+		if (get_bit_in_largemask(t->iter_group_bucket_mask, group)) {
+			*next = (group + 1)*ITERATOR_GROUP;
+			continue;
+		}
+		if (get_bit_in_largemask(t->reset_group_bucket_mask, group))
+			reset_iterator_group(t, group);
+
+		for (; *next < (group + 1)*ITERATOR_GROUP; (*next)++) {
+			if (*budget == 0)
+				return -EBUSY;
+			(*budget)--;
+			if (iterate_bucket(t, *next, key, data, remaining_time, currentTime) == 0)
+				return 0;
+		}
+		set_bit_in_largemask(t->iter_group_bucket_mask, group);
+	}
+	return -ENOENT;
+}
+
+int32_t
+H(rte_hash,iterate_partition)(struct rte_hash_hvariant *h, uint32_t part, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime)
+{
+	uint32_t budget = 2048; // Same pause limit as iterate()
+	int32_t ret;
+
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	if (part >= h->iter_nb_parts)
+		return -EINVAL;
+
+	/* While the table is resized, entries not moved yet are iterated over first */
+	if (unlikely(h->resize_src != NULL)) {
+		ret = iterate_partition_table(h->resize_src, part, &budget, key, data, remaining_time, currentTime);
+		if (ret != -ENOENT)
+			return ret;
+		if (part == 0 && unlikely(h->resize_src->stash_mask != 0) &&
+		    stash_iterate(h->resize_src, key, data, remaining_time, currentTime) == 0)
+			return 0;
+	}
+
+	ret = iterate_partition_table(h, part, &budget, key, data, remaining_time, currentTime);
+	if (ret != -ENOENT)
+		return ret;
+
+	/* The stash is iterated over by the first partition */
+	if (part == 0 && unlikely(h->stash_mask != 0))
+		return stash_iterate(h, key, data, remaining_time, currentTime);
+	return -ENOENT;
+}
+
+int32_t
+H(rte_hash,unsafe_iterate)(struct rte_hash_hvariant *h, uint64_t * pos, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_key *next_key;
+
+	RETURN_IF_TRUE((h == NULL) , -EINVAL);
+
+	for(; (*pos) < h->num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES ; (*pos)++){
+			uint32_t i = (*pos)/RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+			uint32_t j = (*pos) - i*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+
+			if(!free_or_expired(&h->buckets[i],j,currentTime)){
+				/* Get position of entry in key table */
+				int p = i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j;
+				next_key = &h->key_store[p];
+
+				/* Return key, data and remaining time */
+				*key = next_key->key;
+				load_data(next_key, data);
+#if TIMER
+				*remaining_time = time_diff(h->buckets[i].expire_date_timeunit[j],currentTime);
+#else
+				*remaining_time = 0;
+#endif
+				(*pos)++;
+				return 0;
+			}
+	}
+
+	/* Then positions of the stash entries */
+	for(; (*pos) < h->num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES + RTE_HASH_HVARIANT_STASH_SIZE ; (*pos)++){
+			uint32_t i = (*pos) - h->num_buckets*RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+
+			if((h->stash_mask & (1U << i)) && !(TIMER && expired_timer(h->stash_expire[i], currentTime))){
+				*key = h->stash_keys[i].key;
+				load_data(&h->stash_keys[i], data);
+				*remaining_time = TIMER ? time_diff(h->stash_expire[i], currentTime) : 0;
+				(*pos)++;
+				return 0;
+			}
+	}
+
+	/* While the table is resized, positions past the new arrays are in the old ones */
+	if (unlikely(h->resize_src != NULL)) {
+		uint64_t base = (uint64_t)h->num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES + RTE_HASH_HVARIANT_STASH_SIZE;
+		uint64_t src_pos = *pos - base;
+		int32_t ret = H(rte_hash,unsafe_iterate)(h->resize_src, &src_pos, key, data, remaining_time, currentTime);
+		*pos = base + src_pos;
+		return ret;
+	}
+	return -ENOENT;
+
+}
+
+
+/*
+ * Expiry sweep
+ *
+ * expire_step() scans a few buckets per call from a cursor kept in the table (expire_next) and
+ * removes the expired entries it finds, as deletions do. Their keys and data are first copied
+ * to a batch, which is given to the callback when it may not hold the entries of another bucket,
+ * and at the end of the call: the callback never runs while buckets are being modified (or
+ * locked, in multi-writer mode).
+ */
+#if RTE_HASH_HVARIANT_EXPIRE_BATCH < BUCKET_ENTRIES
+#error "RTE_HASH_HVARIANT_EXPIRE_BATCH must hold the entries of a bucket"
+#endif
+
+struct expire_batch {
+	H(rte_hash,expire_cb_t) cb;
+	void *arg;
+	uint32_t n;
+	hash_hvariant_key_t keys[RTE_HASH_HVARIANT_EXPIRE_BATCH];
+	hash_hvariant_data_t data[RTE_HASH_HVARIANT_EXPIRE_BATCH];
+};
+
+static inline void
+expire_batch_flush(struct expire_batch *eb)
+{
+	if (eb->n > 0 && eb->cb != NULL)
+		eb->cb(eb->keys, eb->data, eb->n, eb->arg);
+	eb->n = 0;
+}
+
+/* Remove the expired entries of bucket idx */
+static inline uint32_t
+expire_bucket(struct rte_hash_hvariant *h, uint32_t idx, hash_hvariant_time_t currentTime, struct expire_batch *eb)
+{
+	struct rte_hash_hvariant_bucket *b = &h->buckets[idx];
+	struct lf_lockset ls;
+	uint32_t expired, i, tmp;
+
+	expired = free_or_expired_maskpos(b, currentTime) & b->mask_busy;
+	if (likely(expired == 0))
+		return 0;
+
+	lf_lockset_init(&ls);
+	if (unlikely(h->multi_writer)) {
+		/* Lock the bucket, and the primary buckets of entries in secondary position (bloom filter) */
+		lf_lockset_add(&ls, idx);
+		FOREACH_IN_MASK32(i, expired & b->mask_in_secondary_position, tmp){
+			lf_lockset_add(&ls, secondary_signature(h,b,i) & h->bucket_bitmask);
+		}
+		for (;;) {
+			int missing = 0;
+			lf_lockset_lock(h, &ls);
+			expired = free_or_expired_maskpos(b, currentTime) & b->mask_busy;
+			FOREACH_IN_MASK32(i, expired & b->mask_in_secondary_position, tmp){
+				missing |= !lf_lockset_need(&ls, secondary_signature(h,b,i) & h->bucket_bitmask);
+			}
+			if (!missing)
+				break;
+			lf_lockset_unlock(h, &ls);
+		}
+	}
+
+	FOREACH_IN_MASK32(i, expired, tmp){
+		const struct rte_hash_hvariant_key *k = &h->key_store[idx * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
+		eb->keys[eb->n] = k->key;
+		load_data(k, &eb->data[eb->n]);
+		eb->n++;
+		delete_bucket_entry(h, b, i, currentTime);
+	}
+
+	lf_lockset_unlock(h, &ls);
+	return __builtin_popcount(expired);
+}
+
+/* Remove the expired entries of the stash */
+static inline uint32_t
+expire_stash(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime, struct expire_batch *eb)
+{
+	uint32_t i, tmp, n = 0;
+
+	FOREACH_IN_MASK32(i, h->stash_mask, tmp){
+		if (expired_timer(h->stash_expire[i], currentTime)) {
+			if (eb->n == RTE_HASH_HVARIANT_EXPIRE_BATCH)
+				expire_batch_flush(eb);
+			eb->keys[eb->n] = h->stash_keys[i].key;
+			load_data(&h->stash_keys[i], &eb->data[eb->n]);
+			eb->n++;
+			h->stash_mask &= ~(1U << i);
+			n++;
+		}
+	}
+	return n;
+}
+
+/* Scan budget buckets of table t (h or the old arrays of h being resized) */
+static inline uint32_t
+expire_sweep(struct rte_hash_hvariant *h, struct rte_hash_hvariant *t, uint32_t budget, hash_hvariant_time_t currentTime, struct expire_batch *eb)
+{
+	uint32_t n = 0;
+
+	for (; budget > 0; budget--) {
+		uint32_t idx, removed;
+
+		/* The stash is swept once per pass over the buckets */
+		if (t->expire_next >= t->num_buckets) {
+			n += expire_stash(t, currentTime, eb);
+			t->expire_next = 0;
+		}
+		if (eb->n > RTE_HASH_HVARIANT_EXPIRE_BATCH - RTE_HASH_HVARIANT_BUCKET_ENTRIES)
+			expire_batch_flush(eb);
+
+		idx = t->expire_next++;
+		removed = expire_bucket(t, idx, currentTime, eb);
+		n += removed;
+
+		/* The slots freed may be used by a stash entry (old arrays only lose entries) */
+		if (removed > 0 && t == h && unlikely(h->stash_mask != 0))
+			stash_reinsert(h, idx, currentTime);
+	}
+	return n;
+}
+
+int32_t
+H(rte_hash,expire_step)(struct rte_hash_hvariant *h, uint32_t budget, hash_hvariant_time_t currentTime, H(rte_hash,expire_cb_t) cb, void *arg)
+{
+	struct expire_batch eb;
+	uint32_t n = 0;
+
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	if (!TIMER)
+		return 0;
+
+	eb.cb = cb;
+	eb.arg = arg;
+	eb.n = 0;
+	if (unlikely(h->resize_src != NULL))
+		n += expire_sweep(h, h->resize_src, budget, currentTime, &eb);
+	n += expire_sweep(h, h, budget, currentTime, &eb);
+	expire_batch_flush(&eb);
+	return n;
+}
+
+
+/*
+ * Bloom filter scrub
+ *
+ * The filter of a bucket is only cleared when no entry moved from it is left: bits of deleted
+ * entries stay while others remain, and expired entries keep theirs until their slot is reused.
+ * bloom_scrub() rebuilds the filters in two passes over the buckets. The first one sets, in
+ * scrub_filters, the bits of each live entry in secondary position in the filter of its primary
+ * bucket; entries moved meanwhile set their bits there as well (mark_as_secondary()). The second
+ * one replaces the filters of buckets by the rebuilt ones, which hold the bits of every entry in
+ * secondary position: filters always have the bits of these entries, lookups never miss them.
+ */
+#define RTE_HASH_HVARIANT_BLOOM_SAMPLE 4096u /* Buckets whose filter is read by bloom_saturation() */
+
+#if BLOOM
+/* Add the bits of the live entries in secondary position of bucket idx to the rebuilt filters */
+static inline void
+bloom_scrub_scan(struct rte_hash_hvariant *h, uint32_t idx, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_bucket *b = &h->buckets[idx];
+	uint32_t live = ~free_or_expired_maskpos(b, currentTime) & b->mask_in_secondary_position;
+	uint32_t i, tmp;
+
+	FOREACH_IN_MASK32(i, live, tmp){
+		uint32_t sec_sig = primary_signature(h,b,i);
+		uint32_t prim_idx = secondary_signature(h,b,i) & h->bucket_bitmask;
+
+		h->scrub_filters[prim_idx * RTE_HASH_HVARIANT_BLOOM_WORDS + bloom_word(sec_sig)] |= bloom_mask_64(sec_sig);
+	}
+}
+
+/* Replace the filter of bucket idx (readers see either filter, both have the bits they need) */
+static inline void
+bloom_scrub_install(struct rte_hash_hvariant *h, uint32_t idx)
+{
+	uint32_t w;
+
+	for (w = 0; w < RTE_HASH_HVARIANT_BLOOM_WORDS; w++)
+		h->buckets[idx].bloom_moved[w] = h->scrub_filters[idx * RTE_HASH_HVARIANT_BLOOM_WORDS + w];
+}
+#endif
+
+int
+H(rte_hash,bloom_scrub)(struct rte_hash_hvariant *h, uint32_t budget, hash_hvariant_time_t currentTime)
+{
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+#if BLOOM
+	if (h->multi_writer)
+		return -ENOTSUP;
+	if (h->resize_src != NULL)
+		return -EBUSY;
+
+	if (h->scrub_filters == NULL) {
+		h->scrub_filters = rte_zmalloc_socket(NULL,
+				(uint64_t)h->num_buckets * RTE_HASH_HVARIANT_BLOOM_WORDS * sizeof(uint64_t),
+				RTE_CACHE_LINE_SIZE, h->socket_id);
+		if (h->scrub_filters == NULL)
+			return -ENOMEM;
+		h->scrub_next = 0;
+		h->scrub_installing = 0;
+	}
+
+	for (; budget > 0; budget--) {
+		if (!h->scrub_installing) {
+			bloom_scrub_scan(h, h->scrub_next++, currentTime);
+			if (h->scrub_next == h->num_buckets) {
+				h->scrub_installing = 1;
+				h->scrub_next = 0;
+			}
+		} else {
+			bloom_scrub_install(h, h->scrub_next++);
+			if (h->scrub_next == h->num_buckets) {
+				bloom_scrub_abort(h);
+				return 1;
+			}
+		}
+	}
+	return 0;
+#else
+	RTE_SET_USED(h);
+	RTE_SET_USED(budget);
+	RTE_SET_USED(currentTime);
+	return -ENOTSUP;
+#endif
+}
+
+double
+H(rte_hash,bloom_saturation)(const struct rte_hash_hvariant *h, double *fp_rate)
+{
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+#if BLOOM
+	/* Evenly spaced buckets (all of them in small tables) */
+	uint32_t step = RTE_MAX(1u, h->num_buckets / RTE_HASH_HVARIANT_BLOOM_SAMPLE);
+	uint64_t bits = 0, words = 0;
+	double fp = 0.0;
+	uint32_t idx, w;
+
+	for (idx = 0; idx < h->num_buckets; idx += step) {
+		for (w = 0; w < RTE_HASH_HVARIANT_BLOOM_WORDS; w++) {
+			uint32_t set = __builtin_popcountll(h->buckets[idx].bloom_moved[w]);
+			double ratio = (double)set / 64;
+
+			bits += set;
+			words++;
+			/* A key absent from its primary bucket matches if both its bits are set */
+			fp += ratio * ratio;
+		}
+	}
+	if (fp_rate != NULL)
+		*fp_rate = fp / words;
+	return (double)bits / (words * 64);
+#else
+	RTE_SET_USED(h);
+	RTE_SET_USED(fp_rate);
+	return -ENOTSUP;
+#endif
+}
+
+
+/*
+ * Rebalancing
+ *
+ * An entry moved to its secondary bucket to make room stays there when its primary bucket gets
+ * free slots again: its lookups read both buckets, and its bits stay in the bloom filter (or its
+ * remap entry in the horton table) of its primary bucket. rebalance_step() scans a few buckets
+ * per call from a cursor kept in the table (rebalance_next), and moves the live entries in
+ * secondary position back to their primary bucket when it has a free or expired slot.
+ */
+
+/* Return 1 if entry i of bucket b is in its secondary bucket (other variants than bloom and
+ * horton do not keep this bit: the hash of the key is compared to the alternative one) */
+static inline int
+in_secondary_position(struct rte_hash_hvariant *h, struct rte_hash_hvariant_bucket *b, uint32_t i)
+{
+#if BLOOM||HORTON
+	RTE_SET_USED(h);
+	return get_bit_in_mask(&b->mask_in_secondary_position, i);
+#else
+	const struct rte_hash_hvariant_key *k = &h->key_store[(b - h->buckets) * RTE_HASH_HVARIANT_BUCKET_ENTRIES + i];
+	uint64_t sig = rte_hash_key(k->key) & signature_bits64(h);
+
+	return (sig & 0xffffffffULL) == (secondary_signature(h,b,i) & signature_bits64(h));
+#endif
+}
+
+/* Move entry i of bucket idx (in secondary position) back to its primary bucket if possible */
+static inline int
+rebalance_entry(struct rte_hash_hvariant *h, uint32_t idx, uint32_t i, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_bucket *b = &h->buckets[idx];
+	uint32_t prim_idx = secondary_signature(h,b,i) & h->bucket_bitmask;
+	struct rte_hash_hvariant_bucket *prim_bkt = &h->buckets[prim_idx];
+	struct lf_lockset ls;
+	int j = -1;
+
+	/* Both hashes of the key may give the same bucket */
+	if (prim_idx == idx)
+		return 0;
+
+	lf_lockset_init(&ls);
+	if (unlikely(h->multi_writer)) {
+		lf_lockset_add(&ls, idx);
+		lf_lockset_add(&ls, prim_idx);
+	}
+	for (;;) {
+		uint32_t free_slots;
+
+		if (unlikely(h->multi_writer))
+			lf_lockset_lock(h, &ls);
+		/* The entry may have been moved or removed meanwhile (multi-writer mode) */
+		if (free_or_expired(b, i, currentTime) || !in_secondary_position(h, b, i) ||
+		    (secondary_signature(h,b,i) & h->bucket_bitmask) != prim_idx)
+			break;
+		free_slots = free_or_expired_maskpos(prim_bkt, currentTime);
+		if (free_slots == 0)
+			break;
+		/* Reusing an expired slot updates the bloom filter of the primary bucket of its entry */
+		j = __builtin_ctz(free_slots);
+		if (lf_slot_reusable(h, h->multi_writer ? &ls : NULL, prim_bkt, j))
+			break;
+		j = -1;
+		lf_lockset_unlock(h, &ls);
+	}
+
+	if (j >= 0) {
+		move_bucket_entry(h, b, i, prim_bkt, j, 0, currentTime);
+		/* Releasing the old slot updates the filter or remap entry of the primary bucket */
+		delete_bucket_entry(h, b, i, currentTime);
+	}
+	lf_lockset_unlock(h, &ls);
+	return j >= 0;
+}
+
+int32_t
+H(rte_hash,rebalance_step)(struct rte_hash_hvariant *h, uint32_t budget, hash_hvariant_time_t currentTime)
+{
+	uint32_t n = 0;
+
+	RETURN_IF_TRUE((h == NULL), -EINVAL);
+
+	if (h->resize_src != NULL)
+		return -EBUSY;
+
+	for (; budget > 0; budget--) {
+		struct rte_hash_hvariant_bucket *b;
+		uint32_t idx, moved = 0, secondary, i, tmp;
+
+		if (h->rebalance_next >= h->num_buckets)
+			h->rebalance_next = 0;
+		idx = h->rebalance_next++;
+		b = &h->buckets[idx];
+
+		secondary = ~free_or_expired_maskpos(b, currentTime) & ENTRIES_MASK;
+		if (BLOOM || HORTON)
+			secondary &= b->mask_in_secondary_position;
+		FOREACH_IN_MASK32(i, secondary, tmp){
+			if (in_secondary_position(h, b, i))
+				moved += rebalance_entry(h, idx, i, currentTime);
+		}
+		n += moved;
+
+		/* The slots freed may be used by a stash entry */
+		if (moved > 0 && unlikely(h->stash_mask != 0))
+			stash_reinsert(h, idx, currentTime);
+	}
+	return n;
+}
+
+
+/*
+ * Snapshots
+ *
+ * save() writes a header describing the layout of the table, followed by the raw bucket array,
+ * the hashes of alternative buckets (compact buckets) and the key store, each with a single
+ * write. load() creates a table and, if it has the same number of buckets, reads the arrays in
+ * place; otherwise the entries are streamed from the file and inserted. Stash entries, kept in
+ * the header, are always inserted again.
+ */
+#define SNAPSHOT_MAGIC 0x31504e5348435454ULL /* "TTCHSNP1" */
+#define SNAPSHOT_CHUNK 4096u /* Buckets read at once when entries are inserted again */
+
+struct snapshot_header {
+	uint64_t magic;
+	/* Layout of the table, that must match for the snapshot to be loaded */
+	uint32_t key_size;
+	uint32_t data_size;
+	uint32_t bucket_entries;
+	uint32_t timer_bits;
+	uint32_t bucket_size;           /**< sizeof(struct rte_hash_hvariant_bucket) */
+	uint32_t key_entry_size;        /**< sizeof(struct rte_hash_hvariant_key) */
+	uint32_t features;              /**< BLOOM, HORTON, TIMER and COMPACT_BUCKET */
+	/* State of the table */
+	uint32_t num_buckets;
+	uint32_t busy_entries;
+	uint32_t stash_mask;
+	uint32_t stash_expire[RTE_HASH_HVARIANT_STASH_SIZE];
+};
+
+static void
+snapshot_header_init(struct snapshot_header *hdr)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = SNAPSHOT_MAGIC;
+	hdr->key_size = KEY_SIZE;
+	hdr->data_size = DATA_SIZE;
+	hdr->bucket_entries = RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+	hdr->timer_bits = TIMER_BITS;
+	hdr->bucket_size = sizeof(struct rte_hash_hvariant_bucket);
+	hdr->key_entry_size = sizeof(struct rte_hash_hvariant_key);
+	hdr->features = (BLOOM ? 1 : 0) | (HORTON ? 2 : 0) | (TIMER ? 4 : 0) | (COMPACT_BUCKET ? 8 : 0);
+}
+
+static int
+snapshot_header_compatible(const struct snapshot_header *hdr)
+{
+	struct snapshot_header ref;
+
+	snapshot_header_init(&ref);
+	return hdr->magic == ref.magic && hdr->key_size == ref.key_size &&
+		hdr->data_size == ref.data_size && hdr->bucket_entries == ref.bucket_entries &&
+		hdr->timer_bits == ref.timer_bits && hdr->bucket_size == ref.bucket_size &&
+		hdr->key_entry_size == ref.key_entry_size && hdr->features == ref.features &&
+		rte_is_power_of_2(hdr->num_buckets) &&
+		hdr->num_buckets >= RTE_HASH_HVARIANT_MIN_BUCKETS &&
+		(uint64_t)hdr->num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES <= RTE_HASH_HVARIANT_ENTRIES_MAX;
+}
+
+/* Size of the key store of a table with num_buckets buckets (padding slot and stash included) */
+static inline uint64_t
+snapshot_key_store_size(uint32_t num_buckets)
+{
+	return sizeof(struct rte_hash_hvariant_key) * ((uint64_t)num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES + 1 + RTE_HASH_HVARIANT_STASH_SIZE);
+}
+
+static inline uint64_t
+snapshot_keys_offset(uint32_t num_buckets)
+{
+	return sizeof(struct snapshot_header) + (uint64_t)num_buckets * sizeof(struct rte_hash_hvariant_bucket) +
+		(COMPACT_BUCKET ? (uint64_t)num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES * sizeof(uint32_t) : 0);
+}
+
+int
+H(rte_hash,save)(const struct rte_hash_hvariant *h, const char *path)
+{
+	struct snapshot_header hdr;
+	FILE *f;
+	uint32_t i;
+	int ret = 0;
+
+	if (h == NULL || path == NULL)
+		return -EINVAL;
+
+	if (h->resize_src != NULL) {
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_save cannot save a table being resized\n");
+		return -EBUSY;
+	}
+
+	snapshot_header_init(&hdr);
+	hdr.num_buckets = h->num_buckets;
+	hdr.busy_entries = busy_entries_count(h);
+	hdr.stash_mask = h->stash_mask;
+	for (i = 0; i < RTE_HASH_HVARIANT_STASH_SIZE; i++)
+		hdr.stash_expire[i] = h->stash_expire[i];
+
+	f = fopen(path, "wb");
+	if (f == NULL) {
+		ret = -errno;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_save cannot open %s\n", path);
+		return ret;
+	}
+
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    fwrite(h->buckets, sizeof(struct rte_hash_hvariant_bucket), h->num_buckets, f) != h->num_buckets ||
+	    (COMPACT_BUCKET && fwrite(h->secondary_signatures, sizeof(uint32_t), h->entries, f) != h->entries) ||
+	    fwrite(h->key_store, snapshot_key_store_size(h->num_buckets), 1, f) != 1)
+		ret = -EIO;
+	if (fclose(f) != 0)
+		ret = -EIO;
+
+	if (ret < 0)
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_save failed to write %s\n", path);
+	return ret;
+}
+
+/* Insert again the stash entries of a snapshot (keys of the stash of the saved key store) */
+static int
+snapshot_insert_stash(struct rte_hash_hvariant *h, const struct snapshot_header *hdr, const struct rte_hash_hvariant_key *stash_keys, hash_hvariant_time_t currentTime)
+{
+	hash_hvariant_data_t data;
+	unsigned i, tmp;
+
+	memset(&data, 0, sizeof(data));
+	FOREACH_IN_MASK32(i, hdr->stash_mask, tmp){
+		if (TIMER && expired_timer(hdr->stash_expire[i], currentTime))
+			continue;
+		load_data(&stash_keys[i], &data);
+		if (H(rte_hash,add_key_data)(h, stash_keys[i].key, data, hdr->stash_expire[i], currentTime) < 0)
+			return -ENOSPC;
+	}
+	return 0;
+}
+
+/* Same number of buckets: read the arrays in place */
+static int
+snapshot_load_arrays(struct rte_hash_hvariant *h, FILE *f, const struct snapshot_header *hdr, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_key stash_keys[RTE_HASH_HVARIANT_STASH_SIZE];
+
+	if (fread(h->buckets, sizeof(struct rte_hash_hvariant_bucket), h->num_buckets, f) != h->num_buckets ||
+	    (COMPACT_BUCKET && fread(h->secondary_signatures, sizeof(uint32_t), h->entries, f) != h->entries) ||
+	    fread(h->key_store, snapshot_key_store_size(h->num_buckets), 1, f) != 1)
+		return -EIO;
+
+	h->busy_entries = hdr->busy_entries;
+
+	/* The stash of h is empty: insertions could overwrite the saved stash entries */
+	memcpy(stash_keys, h->stash_keys, sizeof(stash_keys));
+	return snapshot_insert_stash(h, hdr, stash_keys, currentTime);
+}
+
+/* Different number of buckets: insert the entries, read SNAPSHOT_CHUNK buckets at a time (the
+ * buckets and the key store are read through two streams, as they are stored one after the other) */
+static int
+snapshot_load_entries(struct rte_hash_hvariant *h, FILE *f, const char *path, const struct snapshot_header *hdr, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_bucket *bkts;
+	struct rte_hash_hvariant_key *keys;
+	hash_hvariant_data_t data;
+	FILE *fk;
+	uint32_t b, n, i, j, tmp;
+	int ret = 0;
+
+	fk = fopen(path, "rb");
+	bkts = rte_malloc(NULL, SNAPSHOT_CHUNK * sizeof(*bkts), RTE_CACHE_LINE_SIZE);
+	keys = rte_malloc(NULL, SNAPSHOT_CHUNK * RTE_HASH_HVARIANT_BUCKET_ENTRIES * sizeof(*keys), RTE_CACHE_LINE_SIZE);
+	if (fk == NULL || bkts == NULL || keys == NULL) {
+		ret = fk == NULL ? -EIO : -ENOMEM;
+		goto out;
+	}
+	if (fseeko(fk, snapshot_keys_offset(hdr->num_buckets), SEEK_SET) != 0) {
+		ret = -EIO;
+		goto out;
+	}
+
+	memset(&data, 0, sizeof(data));
+	for (b = 0; b < hdr->num_buckets && ret == 0; b += n) {
+		n = RTE_MIN(hdr->num_buckets - b, SNAPSHOT_CHUNK);
+		if (fread(bkts, sizeof(*bkts), n, f) != n ||
+		    fread(keys, sizeof(*keys) * RTE_HASH_HVARIANT_BUCKET_ENTRIES, n, fk) != n) {
+			ret = -EIO;
+			break;
+		}
+		for (i = 0; i < n && ret == 0; i++) {
+			FOREACH_IN_MASK32(j, ~free_or_expired_maskpos(&bkts[i], currentTime) & bkts[i].mask_busy, tmp){
+				const struct rte_hash_hvariant_key *k = &keys[i * RTE_HASH_HVARIANT_BUCKET_ENTRIES + j];
+#if TIMER
+				hash_hvariant_time_t expire = bkts[i].expire_date_timeunit[j];
+#else
+				hash_hvariant_time_t expire = 0;
+#endif
+				load_data(k, &data);
+				if (H(rte_hash,add_key_data)(h, k->key, data, expire, currentTime) < 0) {
+					ret = -ENOSPC;
+					break;
+				}
+			}
+		}
+	}
+
+	/* Stash entries follow the padding slot */
+	if (ret == 0) {
+		if (fseeko(fk, sizeof(*keys), SEEK_CUR) != 0 ||
+		    fread(keys, sizeof(*keys), RTE_HASH_HVARIANT_STASH_SIZE, fk) != RTE_HASH_HVARIANT_STASH_SIZE)
+			ret = -EIO;
+		else
+			ret = snapshot_insert_stash(h, hdr, keys, currentTime);
+	}
+
+out:
+	if (fk != NULL)
+		fclose(fk);
+	rte_free(bkts);
+	rte_free(keys);
+	return ret;
+}
+
+struct rte_hash_hvariant *
+H(rte_hash,load)(const char *path, const struct rte_hash_hvariant_parameters *params, hash_hvariant_time_t currentTime)
+{
+	struct rte_hash_hvariant_parameters p;
+	struct snapshot_header hdr;
+	struct rte_hash_hvariant *h;
+	FILE *f;
+	int ret;
+
+	if (path == NULL || params == NULL) {
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_load has invalid parameters\n");
+		return NULL;
+	}
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		rte_errno = errno;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_load cannot open %s\n", path);
+		return NULL;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || !snapshot_header_compatible(&hdr)) {
+		fclose(f);
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_load %s is not a snapshot of a table of this variant\n", path);
+		return NULL;
+	}
+
+	/* Without a size, the table has the number of buckets of the saved one */
+	p = *params;
+	if (p.entries == 0)
+		p.entries = hdr.num_buckets * RTE_HASH_HVARIANT_BUCKET_ENTRIES;
+
+	h = H(rte_hash,create)(&p);
+	if (h == NULL) {
+		fclose(f);
+		return NULL;
+	}
+
+	if (h->num_buckets == hdr.num_buckets)
+		ret = snapshot_load_arrays(h, f, &hdr, currentTime);
+	else
+		ret = snapshot_load_entries(h, f, path, &hdr, currentTime);
+	fclose(f);
+
+	if (ret < 0) {
+		rte_errno = -ret;
+		RTE_LOG(ERR, HASH, "rte_hash_hvariant_load failed to load %s\n", path);
+		H(rte_hash,free)(h);
+		return NULL;
+	}
+
+	H(rte_hash,iterator_reset)(h);
+	return h;
+}
+
+
+#define MAX_DIST_MOVED 16u
+
+void H(rte_hash,print_stats)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime){
+	unsigned i,j;
+	int count_bucket_per_occupation[RTE_HASH_HVARIANT_BUCKET_ENTRIES+1];
+	memset(count_bucket_per_occupation,0,(RTE_HASH_HVARIANT_BUCKET_ENTRIES+1)*sizeof(int));
+	unsigned entriesOccupied = 0;
+	__rte_unused int count_bucket_per_movedsecondarycount[MAX_DIST_MOVED]= {0};
+
+	for( i = 0 ; i < h->num_buckets; i++){
+		//if(h->buckets[i].bloom_moved != 0 && h->buckets[i].bloom_moved != 0xffff ) printf("B: %lx\n",h->buckets[i].bloom_moved);
+		//if(h->buckets[i].mask_in_secondary_position) printf("MSP: %x\n",(uint32_t)h->buckets[i].mask_in_secondary_position);
+		int occupied=0;
+		for(j = 0 ; j < RTE_HASH_HVARIANT_BUCKET_ENTRIES; j++){
+			if(!free_or_expired(&h->buckets[i],j,currentTime)){
 				occupied++;
 				entriesOccupied++;
 			}
@@ -1986,7 +5958,7 @@ void H(rte_hash,print_stats)(struct rte_hash_hvariant *h, uint16_t currentTime){
 
 }
 
-uint32_t H(rte_hash,size)(struct rte_hash_hvariant *h, uint16_t currentTime){
+uint32_t H(rte_hash,size)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime){
 	unsigned i,j;
 	uint32_t size=0;
 
@@ -1997,6 +5969,12 @@ uint32_t H(rte_hash,size)(struct rte_hash_hvariant *h, uint16_t currentTime){
 			}
 		}
 	}
+	for( i = 0 ; i < RTE_HASH_HVARIANT_STASH_SIZE; i++){
+		if((h->stash_mask & (1U << i)) && !(TIMER && expired_timer(h->stash_expire[i], currentTime)))
+			size++;
+	}
+	if (unlikely(h->resize_src != NULL))
+		size += H(rte_hash,size)(h->resize_src, currentTime);
 
 	return size;
 }
@@ -2008,3 +5986,7 @@ uint32_t H(rte_hash,capacity)(struct rte_hash_hvariant *h){
 int H(rte_hash,slots_per_bucket)(void){
 	return RTE_HASH_HVARIANT_BUCKET_ENTRIES;
 }
+
+uint32_t H(rte_hash,max_expiration_period)(void){
+	return MAX_EXPIRATION_PERIOD;
+}
@@ -29,6 +29,51 @@ static inline uint64_t dcrc_hash_m128(const hash_key_t k) {
     return crc64;
 }
 
+/**
+ * Same as dcrc_hash_m128 for 64-bit keys. The second CRC runs on the word with its halves swapped,
+ * otherwise both hashes would only differ by a constant (CRC is linear).
+ */
+static inline uint64_t dcrc_hash_key8(const hash_key8_t k) {
+	uint64_t a = k.a;
+	uint64_t crc0 = _mm_crc32_u64(0,a);
+	uint64_t crc1 = _mm_crc32_u64(0x5bd1e995,(a >> 32) | (a << 32));
+	return (crc1 << 32) | crc0;
+}
+
+/**
+ * Same as dcrc_hash_m128 for 256-bit keys (words are processed in reverse order for the second CRC)
+ */
+static inline uint64_t dcrc_hash_key32(const hash_key32_t k) {
+	uint64_t crc0 = _mm_crc32_u64(0,k.a);
+	crc0 = _mm_crc32_u64(crc0,k.b);
+	crc0 = _mm_crc32_u64(crc0,k.c);
+	crc0 = _mm_crc32_u64(crc0,k.d);
+	uint64_t crc1 = _mm_crc32_u64(0x5bd1e995,k.d);
+	crc1 = _mm_crc32_u64(crc1,k.c);
+	crc1 = _mm_crc32_u64(crc1,k.b);
+	crc1 = _mm_crc32_u64(crc1,k.a);
+	return (crc1 << 32) | crc0;
+}
+
+/**
+ * Same as dcrc_hash_m128 for 384-bit keys (words are processed in reverse order for the second CRC)
+ */
+static inline uint64_t dcrc_hash_key48(const hash_key48_t k) {
+	uint64_t crc0 = _mm_crc32_u64(0,k.a);
+	crc0 = _mm_crc32_u64(crc0,k.b);
+	crc0 = _mm_crc32_u64(crc0,k.c);
+	crc0 = _mm_crc32_u64(crc0,k.d);
+	crc0 = _mm_crc32_u64(crc0,k.e);
+	crc0 = _mm_crc32_u64(crc0,k.f);
+	uint64_t crc1 = _mm_crc32_u64(0x5bd1e995,k.f);
+	crc1 = _mm_crc32_u64(crc1,k.e);
+	crc1 = _mm_crc32_u64(crc1,k.d);
+	crc1 = _mm_crc32_u64(crc1,k.c);
+	crc1 = _mm_crc32_u64(crc1,k.b);
+	crc1 = _mm_crc32_u64(crc1,k.a);
+	return (crc1 << 32) | crc0;
+}
+
 
 
 
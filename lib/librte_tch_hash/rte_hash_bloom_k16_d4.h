@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2018 - Present – Thomson Licensing, SAS
+ * All rights reserved.
+ *
+ * This source code is licensed under the Clear BSD license found in the
+ * LICENSE.md file in the root directory of this source tree.
+ */
+
+#ifndef LIBRTE_TCH_HASH_RTE_HASH_BLOOM_K16_D4_H_
+#define LIBRTE_TCH_HASH_RTE_HASH_BLOOM_K16_D4_H_
+
+#ifdef H
+#undef H
+#undef BLOOM
+#undef HORTON
+#undef UNCONDITIONAL_PREFETCH
+#undef CONDITIONAL_PREFETCH
+#undef NO_PREFETCH
+#undef TIMER
+#undef KEY_SIZE
+#undef DATA_SIZE
+#undef COMPACT_BUCKET
+#undef BUCKET_ENTRIES
+#undef TIMER_BITS
+#undef MAX_EXPIRATION_PERIOD
+#endif
+
+
+#define H(x,y) x##_bloom_k16_d4_##y
+
+/* Configuration Flags */
+/* A. When to prefetch bucket -- Should be set to BLOOM*/
+#define BLOOM 1
+#define HORTON 0
+#define UNCONDITIONAL_PREFETCH 0
+#define CONDITIONAL_PREFETCH 0
+#define NO_PREFETCH 0
+/* B. Enable time management or not -- Should be enabled*/
+#define TIMER 0
+/* C. Key and data sizes (in bytes) */
+#define KEY_SIZE 16
+#define DATA_SIZE 4
+/* D. Bucket layout: alternative bucket hashes out of the buckets (one cache line per bucket with timers) */
+#define COMPACT_BUCKET 0
+/* E. Number of slots per bucket (4, 8 or 16; 16-slot buckets use 8-bit signatures) */
+#define BUCKET_ENTRIES 8
+/* F. Timer width (16 or 32 bits) and maximum expiration period (in time units, at most 2^(TIMER_BITS-1)) */
+#define TIMER_BITS 16
+#define MAX_EXPIRATION_PERIOD 1024
+
+
+
+#include "rte_hash_template.h"
+
+#endif
@@ -25,7 +25,8 @@ extern "C" {
 
 
 /**
- *  Max exiration period
+ *  Max expiration period of the provided variants with 16-bit timers (each variant sets its own
+ *  with MAX_EXPIRATION_PERIOD, see rte_hash_hvariant_max_expiration_period())
  */
 #define RTE_HASH_HVARIANT_MAX_EXPIRATION_PERIOD   ((uint32_t)1024U)
 
@@ -39,6 +40,15 @@ extern "C" {
 #define RTE_HASH_HVARIANT_LOOKUP_BULK_MAX		64
 #define RTE_HASH_HVARIANT_LOOKUP_MULTI_MAX		RTE_HASH_HVARIANT_LOOKUP_BULK_MAX
 
+/** Maximum number of entries returned at once by rte_hash_hvariant_iterate_bulk. */
+#define RTE_HASH_HVARIANT_ITER_BULK_MAX			64
+
+/** Maximum number of partitions of the partitioned iterator (rte_hash_hvariant_iterate_partition). */
+#define RTE_HASH_HVARIANT_ITER_MAX_PARTS			64
+
+/** Maximum number of expired entries given at once to the callback of rte_hash_hvariant_expire_step. */
+#define RTE_HASH_HVARIANT_EXPIRE_BATCH			32
+
 /** Constants for returning results of operation */
 #define RHL_NOT_FOUND -ENOENT
 #define RHL_NOT_ADDED -ENOSPC
@@ -48,6 +58,12 @@ extern "C" {
 /** Signature of key that is stored internally. */
 typedef uint32_t hash_sig32_t;
 
+/** Allow lookups from several lcores concurrently with a single writer lcore (lock-free readers). */
+#define RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF	0x01
+
+/** Allow keys to be added and removed from several lcores concurrently (implies lock-free readers). */
+#define RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD	0x02
+
 /**
  * Parameters used when creating the hash table.
  */
@@ -55,11 +71,33 @@ struct rte_hash_hvariant_parameters {
 	const char *name;		/**< Name of the hash. */
 	uint32_t entries;		/**< Total hash table entries. */
 	int socket_id;			/**< NUMA Socket ID for memory. */
+	uint8_t extra_flag;		/**< Indicate if additional parameters are present. */
+	uint8_t grow_load_pct;		/**< Start growing when this percentage of entries is used (0: disabled). */
+	uint16_t grow_path_len;		/**< Start growing when an insertion needs a longer cuckoo path (0: disabled). */
+};
+
+/**
+ * Operation counters of a hash table (see rte_hash_hvariant_op_stats). Counters are only
+ * maintained if the library is built with RTE_LIBRTE_TCH_HASH_STATS defined
+ * (e.g., TCH_FLAGS=-DRTE_LIBRTE_TCH_HASH_STATS).
+ */
+struct rte_hash_hvariant_op_stats {
+	uint64_t lookups;               /**< Keys looked up. */
+	uint64_t hits;                  /**< Keys found by lookups. */
+	uint64_t secondary_accesses;    /**< Secondary buckets searched by lookups. */
+	uint64_t bloom_false_positives; /**< Secondary buckets searched in vain (always searched without bloom filter). */
+	uint64_t key_compares;          /**< Keys compared by lookups (signature matches). */
+	uint64_t cuckoo_moves;          /**< Entries moved along cuckoo paths by insertions. */
+	uint64_t max_path_len;          /**< Longest cuckoo path applied by an insertion. */
+	uint64_t enospc;                /**< Insertions that failed for lack of space (-ENOSPC). */
 };
 
 /** @internal A hash table structure. */
 struct rte_hash_hvariant;
 
+/** @internal A hash table replicated on each NUMA socket. */
+struct rte_hash_hvariant_replicated;
+
 
 #ifdef __cplusplus
 }
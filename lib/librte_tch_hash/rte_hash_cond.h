@@ -16,6 +16,12 @@
 #undef CONDITIONAL_PREFETCH
 #undef NO_PREFETCH
 #undef TIMER
+#undef KEY_SIZE
+#undef DATA_SIZE
+#undef COMPACT_BUCKET
+#undef BUCKET_ENTRIES
+#undef TIMER_BITS
+#undef MAX_EXPIRATION_PERIOD
 #endif
 
 
@@ -30,6 +36,16 @@
 #define NO_PREFETCH 0
 /* B. Enable time management or not*/
 #define TIMER 0
+/* C. Key and data sizes (in bytes) */
+#define KEY_SIZE 16
+#define DATA_SIZE 16
+/* D. Bucket layout: alternative bucket hashes out of the buckets (one cache line per bucket with timers) */
+#define COMPACT_BUCKET 0
+/* E. Number of slots per bucket (4, 8 or 16; 16-slot buckets use 8-bit signatures) */
+#define BUCKET_ENTRIES 8
+/* F. Timer width (16 or 32 bits) and maximum expiration period (in time units, at most 2^(TIMER_BITS-1)) */
+#define TIMER_BITS 16
+#define MAX_EXPIRATION_PERIOD 1024
 
 
 
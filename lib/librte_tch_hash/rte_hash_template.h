@@ -9,11 +9,77 @@
 
 #include <rte_hash_commons.h>
 
+/* Key and data types of the variant (KEY_SIZE and DATA_SIZE are set in the variant header).
+ * When DATA_SIZE is 0, data arguments are ignored and data outputs are left untouched. */
+#undef hash_hvariant_key_t
+#undef hash_hvariant_data_t
+
+#if KEY_SIZE == 8
+#define hash_hvariant_key_t hash_key8_t
+#elif KEY_SIZE == 16
+#define hash_hvariant_key_t hash_key16_t
+#elif KEY_SIZE == 32
+#define hash_hvariant_key_t hash_key32_t
+#elif KEY_SIZE == 48
+#define hash_hvariant_key_t hash_key48_t
+#else
+#error "Unsupported KEY_SIZE (must be 8, 16, 32 or 48)"
+#endif
+
+#if DATA_SIZE == 0
+#define hash_hvariant_data_t hash_data0_t
+#elif DATA_SIZE == 4
+#define hash_hvariant_data_t hash_data4_t
+#elif DATA_SIZE == 8
+#define hash_hvariant_data_t hash_data8_t
+#elif DATA_SIZE == 16
+#define hash_hvariant_data_t hash_data16_t
+#else
+#error "Unsupported DATA_SIZE (must be 0, 4, 8 or 16)"
+#endif
+
+/* Time type of the variant (TIMER_BITS and MAX_EXPIRATION_PERIOD are set in the variant header).
+ * Times are compared modulo 2^TIMER_BITS: an entry is live while its expiration time is at most
+ * MAX_EXPIRATION_PERIOD - 1 time units ahead of the current time. An expired entry that is neither
+ * replaced nor removed (see expire_step()) appears again 2^TIMER_BITS - MAX_EXPIRATION_PERIOD
+ * time units after its expiration. */
+#undef hash_hvariant_time_t
+
+#if TIMER_BITS == 16
+#define hash_hvariant_time_t uint16_t
+#elif TIMER_BITS == 32
+#define hash_hvariant_time_t uint32_t
+#else
+#error "Unsupported TIMER_BITS (must be 16 or 32)"
+#endif
+
+#if MAX_EXPIRATION_PERIOD < 1 || MAX_EXPIRATION_PERIOD > (1LL << (TIMER_BITS - 1))
+#error "MAX_EXPIRATION_PERIOD must be between 1 and 2^(TIMER_BITS-1)"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 /**
  * Create a new hash table.
+ * If params->extra_flag contains RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF, lookups
+ * (lookup, lookup_data, lookup_bulk_data, lookup_stream_data, ...) can be called from several
+ * threads while a single writer thread adds and removes keys. Other operations (including
+ * lookups updating expiration times, iteration and reset) are writer operations.
+ * If params->extra_flag contains RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, keys can also
+ * be added, removed and updated from several threads: writers lock the buckets they modify
+ * (version counters are used as locks) and lookups remain lock-free. Iteration and reset
+ * must not run concurrently with writers. Horton tables do not support this mode.
+ * If params->grow_load_pct or params->grow_path_len is set, the table grows automatically
+ * (see grow()) when the given percentage of entries is used, when an insertion needs a longer
+ * cuckoo path, or when an insertion fails. Automatic growth is not supported by horton tables
+ * nor by tables with concurrent readers or writers.
+ * Keys that cannot be placed in the buckets (no cuckoo path found) are kept in a small overflow
+ * stash (RTE_HASH_HVARIANT_STASH_SIZE entries) that lookups only search when it is not empty;
+ * stash entries move back to the buckets when deletions free a slot, or when the table is
+ * resized. Tables with concurrent readers or writers do not use the stash.
+ * The table structure is kept in a memzone named after params->name, so that secondary
+ * processes can attach to the table with find_existing().
  *
  * @param params
  *   Parameters used to create and initialise the hash table.
@@ -26,19 +92,234 @@ extern "C" {
  *    - ENOSPC - the maximum number of memzones has already been allocated
  *    - EEXIST - a memzone with the same name already exists
  *    - ENOMEM - no appropriate memory area found in which to create memzone
+ *    - ENAMETOOLONG - the name of the memzone does not fit
  */
 struct rte_hash_hvariant *
 H(rte_hash,create)(const struct rte_hash_hvariant_parameters *params);
 
 
+/**
+ * Find an existing hash table by name, e.g., from a DPDK secondary process attaching to
+ * a table created by the primary process. The table must have been created by the same
+ * variant.
+ * A secondary process may only use the table for lookups that do not update expiration
+ * times (lookup, lookup_data, lookup_bulk_data, ...) and for unsafe_iterate() and
+ * unsafe_iterate_bulk(). If the owner keeps modifying the table meanwhile, the table must
+ * have been created with RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF, as for readers on
+ * other threads.
+ *
+ * @param name
+ *   Name of the hash table, as given to create()
+ * @return
+ *   Pointer to the hash table, or NULL on error, with error code set in rte_errno.
+ *   Possible rte_errno errors include:
+ *    - ENOENT - no table with this name
+ *    - EINVAL - the table was created by another variant
+ */
+struct rte_hash_hvariant *
+H(rte_hash,find_existing)(const char *name);
+
 /**
  * De-allocate all memory used by hash table.
+ * Only the process that created the table may free it; processes that attached to it
+ * with find_existing() must stop using it before.
  * @param h
  *   Hash table to free
  */
 void
 H(rte_hash,free)(struct rte_hash_hvariant *h);
 
+/**
+ * Create a hash table replicated on each NUMA socket that has enabled lcores, for read-mostly
+ * tables looked up from several sockets. Each replica is a full table allocated on its socket
+ * (named params->name followed by "." and the socket id, params->socket_id is ignored).
+ * Writes (replicated_add_key_data, replicated_del_key, ...) are applied to every replica in
+ * turn, and lookups use the replica of the socket of the calling lcore, so that they only
+ * access local memory. Lookups may run concurrently with a single writer if params->extra_flag
+ * contains RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF; a key being written may then be
+ * found on some sockets and not yet on others. RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD
+ * is not supported. Memory usage is multiplied by the number of replicas.
+ *
+ * @param params
+ *   Parameters used to create each replica.
+ * @return
+ *   Pointer to the replicated table, or NULL on error, with error code set in rte_errno
+ *   (as for create(); ENAMETOOLONG if the name of a replica does not fit).
+ */
+struct rte_hash_hvariant_replicated *
+H(rte_hash,replicated_create)(const struct rte_hash_hvariant_parameters *params);
+
+/**
+ * De-allocate all replicas of a replicated hash table.
+ * @param r
+ *   Replicated hash table to free
+ */
+void
+H(rte_hash,replicated_free)(struct rte_hash_hvariant_replicated *r);
+
+/**
+ * Reset all replicas of a replicated hash table.
+ * @param r
+ *   Replicated hash table to reset
+ */
+void
+H(rte_hash,replicated_reset)(struct rte_hash_hvariant_replicated *r);
+
+/**
+ * Get a replica of a replicated hash table, e.g., to run other read-only operations
+ * (lookup_bulk_data_mask, unsafe_iterate, ...) on the local replica, or to apply other
+ * write operations (expire_step, grow, ...) to each replica.
+ *
+ * @param r
+ *   Replicated hash table
+ * @param socket_id
+ *   Socket of the replica, or SOCKET_ID_ANY for the replica local to the calling lcore.
+ *   Sockets without replica share the first replica.
+ * @return
+ *   The replica, or NULL if socket_id is invalid
+ */
+struct rte_hash_hvariant *
+H(rte_hash,replicated_get)(const struct rte_hash_hvariant_replicated *r, int socket_id);
+
+/**
+ * Number of replicas of a replicated hash table.
+ * @param r
+ *   Replicated hash table
+ * @return
+ *   The number of sockets holding a replica
+ */
+uint32_t
+H(rte_hash,replicated_count)(const struct rte_hash_hvariant_replicated *r);
+
+/**
+ * Add a key-value pair to every replica (see add_key_data()).
+ *
+ * @param r
+ *   Replicated hash table to add the key to.
+ * @param key
+ *   Key to add to the hash table.
+ * @param data
+ *   Data to add to the hash table.
+ * @param expirationTime
+ *   Timeunit at which the inserted entry should be expired
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   The value returned by the first replica, or the error of a replica that could not
+ *   add the key. The key is then removed from the other replicas, so that all sockets
+ *   see the same entries.
+ */
+int32_t
+H(rte_hash,replicated_add_key_data)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t key,
+		hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
+
+/**
+ * Add up to RTE_HASH_HVARIANT_LOOKUP_BULK_MAX key-value pairs to every replica (see
+ * add_key_data_bulk()). Each replica takes the whole batch in turn; keys that some replica
+ * could not add are then removed from the others, so that all sockets see the same entries.
+ *
+ * @param r
+ *   Replicated hash table to add the keys to.
+ * @param keys
+ *   A pointer to a list of keys to add.
+ * @param num_keys
+ *   How many keys are in the keys list.
+ * @param data
+ *   Data to add to the hash table for each key (can be NULL).
+ * @param expirationTime
+ *   Expiration time for each key (can be NULL for variants without timers).
+ * @param currentTime
+ *   Current time unit
+ * @param failed_mask
+ *   Output containing a bitmask of keys that could not be added to some replica, and are in
+ *   none of them (can be NULL).
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - otherwise, number of keys inserted or updated in all replicas.
+ */
+int
+H(rte_hash,replicated_add_key_data_bulk)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		const hash_hvariant_data_t data[], const hash_hvariant_time_t expirationTime[], hash_hvariant_time_t currentTime,
+		uint64_t *failed_mask);
+
+/**
+ * Remove a key from every replica (see del_key()).
+ *
+ * @param r
+ *   Replicated hash table to remove the key from.
+ * @param key
+ *   Key to remove from the hash table.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - The value returned by the replicas (see del_key()), if they all agree.
+ *   - -EIO if replicas returned different values (they had diverged; the key is now in none).
+ */
+int32_t
+H(rte_hash,replicated_del_key)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime);
+
+/**
+ * Remove multiple keys from every replica (see del_key_bulk()).
+ *
+ * @param r
+ *   Replicated hash table to remove the keys from.
+ * @param keys
+ *   A pointer to a list of keys to remove (up to 64 keys, according to lookup_mask).
+ * @param lookup_mask
+ *   Bitmask of keys to remove
+ * @param deleted_mask
+ *   Output containing a bitmask of the keys removed from at least one replica (can be NULL).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - -EINVAL if there's an error.
+ *   - -EIO if replicas removed different keys (they had diverged; the keys are now in none).
+ *   - otherwise, number of keys removed.
+ */
+int
+H(rte_hash,replicated_del_key_bulk)(struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t *keys, uint64_t lookup_mask,
+		uint64_t *deleted_mask, hash_hvariant_time_t currentTime);
+
+/**
+ * Find a key-value pair in the replica local to the calling lcore (see lookup_data()).
+ *
+ * @param r
+ *   Replicated hash table to look in.
+ * @param key
+ *   Key to find.
+ * @param data
+ *   Output with data returned from the hash table.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   As lookup_data().
+ */
+int
+H(rte_hash,replicated_lookup_data)(const struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t key,
+		hash_hvariant_data_t *data, hash_hvariant_time_t currentTime);
+
+/**
+ * Find multiple keys in the replica local to the calling lcore (see lookup_bulk_data()).
+ *
+ * @param r
+ *   Replicated hash table to look in.
+ * @param keys
+ *   A pointer to a list of keys to look for.
+ * @param num_keys
+ *   How many keys are in the keys list (less than RTE_HASH_LOOKUP_BULK_MAX).
+ * @param hit_mask
+ *   Output containing a bitmask with all successful lookups.
+ * @param data
+ *   Output containing array of data returned from all the successful lookups.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if there's an error, otherwise number of successful lookups.
+ */
+int
+H(rte_hash,replicated_lookup_bulk_data)(const struct rte_hash_hvariant_replicated *r, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime);
+
 /**
  * Reset all hash structure, by zeroing all entries
  * @param h
@@ -47,6 +328,118 @@ H(rte_hash,free)(struct rte_hash_hvariant *h);
 void
 H(rte_hash,reset)(struct rte_hash_hvariant *h);
 
+/**
+ * Start growing the hash table to twice its number of buckets.
+ * New arrays are allocated and entries are moved to them incrementally: a few buckets
+ * are moved by each insertion, or by resize_step(). While the table is resized, all
+ * operations check both arrays, and iterate() may return twice an entry moved in between
+ * calls. The old arrays are freed once all their entries have been moved.
+ * This operation is not supported by horton tables nor by concurrent tables.
+ *
+ * If the migration of a resize is stalled (see resize_step()), the arrays receiving the
+ * entries are replaced by arrays twice as large as the largest arrays of the table at the next
+ * resize_step() or insertion.
+ *
+ * @param h
+ *   Hash table to grow
+ * @return
+ *   - 0 if the table started growing
+ *   - -EBUSY if the table is already being resized (and its migration is not stalled)
+ *   - -ENOTSUP if the table cannot be resized
+ *   - -EINVAL if the table would be too large (2^24 buckets for 16-slot buckets, whose
+ *     8-bit signatures do not give the hash bits needed beyond)
+ *   - -ENOMEM if the new arrays could not be allocated
+ */
+int
+H(rte_hash,grow)(struct rte_hash_hvariant *h);
+
+/**
+ * Start shrinking the hash table to half its number of buckets.
+ * Entries are moved incrementally as for grow(), and the memory of the old arrays is
+ * returned to the heap once all entries have been moved. If an entry cannot be moved
+ * to the smaller arrays, the resize is reverted: entries go back to the larger ones.
+ * This operation is not supported by horton tables nor by concurrent tables.
+ *
+ * @param h
+ *   Hash table to shrink
+ * @param currentTime
+ *   Current time unit (expired entries are not counted)
+ * @return
+ *   - 0 if the table started shrinking
+ *   - -EBUSY if the table is already being resized
+ *   - -ENOSPC if the table holds too many entries for half its buckets
+ *   - -ENOTSUP if the table cannot be resized
+ *   - -EINVAL if the table is already at its minimum size
+ *   - -ENOMEM if the new arrays could not be allocated
+ */
+int
+H(rte_hash,shrink)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime);
+
+/**
+ * Move the entries of some buckets of the old arrays of a table being resized.
+ * If an entry fits in neither array once a failed resize was reverted (keys were added in
+ * the meantime), the migration is stalled: tables with automatic growth replace the current
+ * arrays by arrays twice as large, the others keep both arrays in use and insertions try
+ * the migration again every 1024 insertions, until keys are removed or grow() is called.
+ *
+ * @param h
+ *   Hash table being resized
+ * @param max_buckets
+ *   Maximum number of old buckets to move
+ * @param currentTime
+ *   Current time unit (expired entries are not moved)
+ * @return
+ *   - Number of old buckets left to move, 0 if the table is not being resized anymore
+ *   - -ENOSPC if the migration is stalled (the call can be repeated after keys are removed
+ *     or after grow() is called)
+ *   - -EINVAL if the parameters are invalid
+ */
+int
+H(rte_hash,resize_step)(struct rte_hash_hvariant *h, uint32_t max_buckets, hash_hvariant_time_t currentTime);
+
+/**
+ * Save the hash table to a file, for instance to restore it with load() when the application
+ * restarts. The bucket array and the key store are written as they are in memory, with large
+ * sequential writes. Writers must not modify the table during the call.
+ *
+ * @param h
+ *   Hash table to save
+ * @param path
+ *   File to write (overwritten if it exists)
+ * @return
+ *   - 0 on success
+ *   - -EINVAL if the parameters are invalid.
+ *   - -EBUSY if the table is being resized (resize_step() must be called until the end).
+ *   - -EIO or the error of fopen() (negated) if the file could not be written.
+ */
+int
+H(rte_hash,save)(const struct rte_hash_hvariant *h, const char *path);
+
+/**
+ * Create a hash table holding the entries of a file written by save() from a table of the same
+ * variant (same compile-time parameters). If the new table has the same number of buckets as
+ * the saved one (for instance if params->entries is 0), the arrays are read in place, without
+ * computing hashes; otherwise all entries are inserted again.
+ * Expiration times are restored as they were saved, so the application must keep the same time
+ * base across restarts; entries expired at currentTime are dropped when entries are inserted again.
+ *
+ * @param path
+ *   File written by save()
+ * @param params
+ *   Parameters of the new table, as for create(); if params->entries is 0, the size of the saved table
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   Pointer to the new hash table, or NULL on error, with error code set in rte_errno.
+ *   Possible rte_errno errors include:
+ *    - EINVAL - invalid parameter, or the file is not a snapshot of a table of this variant
+ *    - EIO - the file could not be read
+ *    - ENOSPC - the new table is too small for the entries
+ *    - ENOMEM - no appropriate memory area found
+ */
+struct rte_hash_hvariant *
+H(rte_hash,load)(const char *path, const struct rte_hash_hvariant_parameters *params, hash_hvariant_time_t currentTime);
+
 /**
  * Print stats to stdout
  * @param h
@@ -54,7 +447,7 @@ H(rte_hash,reset)(struct rte_hash_hvariant *h);
  * @param currentTime
  *   current time to consider
  */
-void H(rte_hash,print_stats)(struct rte_hash_hvariant *h, uint16_t currentTime);
+void H(rte_hash,print_stats)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime);
 
 /**
  * Get the size of the hash table
@@ -63,7 +456,7 @@ void H(rte_hash,print_stats)(struct rte_hash_hvariant *h, uint16_t currentTime);
  * @param currentTime
  *   current time to consider
  */
-uint32_t H(rte_hash,size)(struct rte_hash_hvariant *h, uint16_t currentTime);
+uint32_t H(rte_hash,size)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime);
 
 /**
  * Get the capacity of the hash table
@@ -74,8 +467,9 @@ uint32_t H(rte_hash,capacity)(struct rte_hash_hvariant *h);
 
 /**
  * Add a key-value pair to an existing hash table.
- * This operation is not multi-thread safe
- * and should only be called from one thread.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, otherwise it should only be
+ * called from one thread.
  *
  * @param h
  *   Hash table to add the key to.
@@ -93,13 +487,14 @@ uint32_t H(rte_hash,capacity)(struct rte_hash_hvariant *h);
  *   - -ENOSPC if there is no space in the hash for this key.
  */
 int
- H(rte_hash,add_key_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_data_t data, uint16_t expirationTime, uint16_t currentTime);
+ H(rte_hash,add_key_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 /**
  * Add a key-value pair with a pre-computed hash value
  * to an existing hash table.
- * This operation is not multi-thread safe
- * and should only be called from one thread.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, otherwise it should only be
+ * called from one thread.
  *
  * @param h
  *   Hash table to add the key to.
@@ -119,12 +514,14 @@ int
  *   - -ENOSPC if there is no space in the hash for this key.
  */
 int32_t
-H(rte_hash,add_key_with_hash_data)(struct rte_hash_hvariant *h, const hash_key_t key,
-						hash_sig64_t sig, hash_data_t data, uint16_t expirationTime, uint16_t currentTime);
+H(rte_hash,add_key_with_hash_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+						hash_sig64_t sig, hash_hvariant_data_t data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 /**
- * Add a key to an existing hash table. This operation is not multi-thread safe
- * and should only be called from one thread.
+ * Add a key to an existing hash table.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, otherwise it should only be
+ * called from one thread.
  *
  * @param h
  *   Hash table to add the key to.
@@ -140,12 +537,13 @@ H(rte_hash,add_key_with_hash_data)(struct rte_hash_hvariant *h, const hash_key_t
  *   - RHL_FOUND_UPDATED if the key was added
  */
 int32_t
-H(rte_hash,add_key)(struct rte_hash_hvariant *h, const hash_key_t key , uint16_t expirationTime, uint16_t currentTime);
+H(rte_hash,add_key)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key , hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 /**
  * Add a key to an existing hash table.
- * This operation is not multi-thread safe
- * and should only be called from one thread.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, otherwise it should only be
+ * called from one thread.
  *
  * @param h
  *   Hash table to add the key to.
@@ -163,12 +561,82 @@ H(rte_hash,add_key)(struct rte_hash_hvariant *h, const hash_key_t key , uint16_t
  *   - RHL_FOUND_UPDATED if the key was added
  */
 int32_t
-H(rte_hash,add_key_with_hash)(struct rte_hash_hvariant *h, const hash_key_t key, hash_sig64_t sig, uint16_t expirationTime,  uint16_t currentTime);
+H(rte_hash,add_key_with_hash)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_time_t expirationTime,  hash_hvariant_time_t currentTime);
+
+/**
+ * Add multiple key-value pairs to an existing hash table.
+ * Buckets and key slots of all keys are prefetched before the keys are inserted.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD.
+ *
+ * @param h
+ *   Hash table to add the keys to.
+ * @param keys
+ *   A pointer to a list of keys to add (up to RTE_HASH_HVARIANT_LOOKUP_BULK_MAX keys).
+ * @param num_keys
+ *   How many keys are in the keys list.
+ * @param data
+ *   Data to add to the hash table for each key (can be NULL).
+ * @param expirationTime
+ *   Expiration time for each key (can be NULL for variants without timers).
+ * @param currentTime
+ *   Current time unit
+ * @param inserted_mask
+ *   Output containing a bitmask of keys added to the table (can be NULL).
+ * @param updated_mask
+ *   Output containing a bitmask of keys that were already in the table and whose data
+ *   and expiration time have been updated (can be NULL). If a key is present several times
+ *   in the list, its first occurrence is inserted and the next ones update it.
+ * @param failed_mask
+ *   Output containing a bitmask of keys that could not be added (-ENOSPC) (can be NULL).
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - otherwise, number of keys inserted or updated.
+ */
+int
+H(rte_hash,add_key_data_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		const hash_hvariant_data_t data[], const hash_hvariant_time_t expirationTime[], hash_hvariant_time_t currentTime,
+		uint64_t *inserted_mask, uint64_t *updated_mask, uint64_t *failed_mask);
+
+/**
+ * Fill an empty table (just created or reset) with a set of keys, much faster than adding them
+ * one by one: keys are partitioned by range of primary buckets and each range is filled
+ * sequentially while it is in cache; keys whose primary bucket is full are inserted at the end,
+ * using their secondary bucket, cuckoo moves or the stash. Meant to build static tables offline:
+ * no other operation may run on the table during the call, and concurrent tables (created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF or MULTI_WRITER_ADD) are not supported, as
+ * buckets are written without changing their versions.
+ * Temporary arrays of 12 bytes per key are allocated on the socket of the table.
+ *
+ * @param h
+ *   Empty hash table to fill (no slot in use: expired entries also make it non-empty).
+ * @param keys
+ *   Keys to add (if a key is given several times, its last data and expiration time are kept).
+ * @param num_keys
+ *   Number of keys.
+ * @param data
+ *   Data of each key (can be NULL).
+ * @param expirationTime
+ *   Expiration time of each key (can be NULL for variants without timers).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - 0 if all keys were added
+ *   - -EINVAL if the parameters are invalid.
+ *   - -EBUSY if the table is not empty.
+ *   - -ENOTSUP if the table is concurrent.
+ *   - -ENOMEM if the temporary arrays could not be allocated.
+ *   - -ENOSPC if some keys could not be added (the others are in the table).
+ */
+int
+H(rte_hash,build)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys,
+		const hash_hvariant_data_t data[], const hash_hvariant_time_t expirationTime[], hash_hvariant_time_t currentTime);
 
 /**
  * Remove a key from an existing hash table.
- * This operation is not multi-thread safe
- * and should only be called from one thread.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, otherwise it should only be
+ * called from one thread.
  *
  * @param h
  *   Hash table to remove the key from.
@@ -182,12 +650,117 @@ H(rte_hash,add_key_with_hash)(struct rte_hash_hvariant *h, const hash_key_t key,
  *   - RHL_FOUND_UPDATED if the key was deleted
  */
 int32_t
-H(rte_hash,del_key)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t currentTime);
+H(rte_hash,del_key)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime);
+
+/**
+ * Remove multiple keys from an existing hash table.
+ * Buckets and key slots of all keys are prefetched before keys are removed.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD.
+ *
+ * @param h
+ *   Hash table to remove the keys from.
+ * @param keys
+ *   A pointer to a list of keys to remove (up to 64 keys, according to lookup_mask).
+ * @param lookup_mask
+ *   Bitmask of keys to remove
+ * @param deleted_mask
+ *   Output containing a bitmask of the keys that were found and removed (can be NULL).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if there's an error, otherwise number of removed keys.
+ */
+int
+H(rte_hash,del_key_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint64_t lookup_mask, uint64_t *deleted_mask, hash_hvariant_time_t currentTime);
+
+#if DATA_SIZE == 0
+/*
+ * Key-only sets
+ *
+ * Variants without data (DATA_SIZE 0, e.g. rte_hash_bloom_set.h and rte_hash_lazy_bloom_set.h)
+ * only store keys in the key store, and are used as sets: the functions below are shorthands
+ * for add_key(), lookup(), lookup_bulk_data() and del_key(), with the same thread safety.
+ */
+
+/**
+ * Add a key to a set, or update its expiration time if it is already present.
+ *
+ * @param h
+ *   Set to add the key to.
+ * @param key
+ *   Key to add.
+ * @param expirationTime
+ *   Expiration time of the key (ignored by variants without timers)
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - RHL_FOUND_UPDATED if the key was added or updated
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOSPC if there is no space in the set for this key.
+ */
+int32_t
+H(rte_hash,insert)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
+
+/**
+ * Check whether a set holds a key.
+ *
+ * @param h
+ *   Set to look in.
+ * @param key
+ *   Key to look for.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - 1 if the key is present (and not expired)
+ *   - 0 if it is not
+ *   - -EINVAL if the parameters are invalid.
+ */
+int
+H(rte_hash,contains)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime);
+
+/**
+ * Check whether a set holds multiple keys.
+ *
+ * @param h
+ *   Set to look in.
+ * @param keys
+ *   A pointer to a list of keys to look for.
+ * @param num_keys
+ *   How many keys are in the keys list (less than RTE_HASH_LOOKUP_BULK_MAX).
+ * @param hit_mask
+ *   Output containing a bitmask of the keys present.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if there's an error, otherwise number of keys present.
+ */
+int
+H(rte_hash,contains_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys, uint64_t *hit_mask, hash_hvariant_time_t currentTime);
+
+/**
+ * Remove a key from a set.
+ *
+ * @param h
+ *   Set to remove the key from.
+ * @param key
+ *   Key to remove.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - RHL_FOUND_UPDATED if the key was removed
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if the key is not found.
+ */
+int32_t
+H(rte_hash,delete)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime);
+#endif
 
 /**
  * Remove a key from an existing hash table.
- * This operation is not multi-thread safe
- * and should only be called from one thread.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD, otherwise it should only be
+ * called from one thread.
  *
  * @param h
  *   Hash table to remove the key from.
@@ -203,12 +776,13 @@ H(rte_hash,del_key)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t
  *   - RHL_FOUND_UPDATED if the key was deleted
  */
 int32_t
-H(rte_hash,del_key_with_hash)(struct rte_hash_hvariant *h, const hash_key_t key, hash_sig64_t sig, uint16_t currentTime);
+H(rte_hash,del_key_with_hash)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_time_t currentTime);
 
 
 /**
  * Find a key-value pair in the hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -224,12 +798,13 @@ H(rte_hash,del_key_with_hash)(struct rte_hash_hvariant *h, const hash_key_t key,
  *   - ENOENT if the key is not found.
  */
 int
-H(rte_hash,lookup_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_data_t *data, uint16_t currentTime);
+H(rte_hash,lookup_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime);
 
 /**
  * Find a key-value pair with a pre-computed hash value
  * to an existing hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -247,12 +822,13 @@ H(rte_hash,lookup_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_
  *   - ENOENT if the key is not found.
  */
 int
-H(rte_hash,lookup_with_hash_data)(struct rte_hash_hvariant *h, const hash_key_t key,
-					hash_sig64_t sig, hash_data_t *data, uint16_t currentTime);
+H(rte_hash,lookup_with_hash_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key,
+					hash_sig64_t sig, hash_hvariant_data_t *data, hash_hvariant_time_t currentTime);
 
 /**
  * Find a key in the hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -266,11 +842,12 @@ H(rte_hash,lookup_with_hash_data)(struct rte_hash_hvariant *h, const hash_key_t
  *   - RHL_FOUND_NOT_UPDATED if the key was found
  */
 int32_t
-H(rte_hash,lookup)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t currentTime);
+H(rte_hash,lookup)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t currentTime);
 
 /**
  * Find a key in the hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -287,12 +864,14 @@ H(rte_hash,lookup)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t c
  */
 int32_t
 H(rte_hash,lookup_with_hash)(struct rte_hash_hvariant *h,
-				const hash_key_t key, hash_sig64_t sig, uint16_t currentTime);
+				const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_time_t currentTime);
 
 
 /**
  * Find a key-value pair in the hash table and update expiration time.
- * This operation is multi-thread safe.
+ * This operation modifies the table (expiration time) and should only be
+ * called from the writer thread (or from any thread if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD).
  *
  * @param h
  *   Hash table to look in.
@@ -308,13 +887,15 @@ H(rte_hash,lookup_with_hash)(struct rte_hash_hvariant *h,
  *   - EINVAL if the parameters are invalid.
  *   - ENOENT if the key is not found.
  */
-int32_t H(rte_hash,lookup_update)(struct rte_hash_hvariant *h, const hash_key_t key, uint16_t expirationTime, uint16_t currentTime);
+int32_t H(rte_hash,lookup_update)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 
 
 /**
  * Find a key-value pair in the hash table and update expiration time.
- * This operation is multi-thread safe.
+ * This operation modifies the table (expiration time) and should only be
+ * called from the writer thread (or from any thread if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD).
  *
  * @param h
  *   Hash table to look in.
@@ -332,11 +913,13 @@ int32_t H(rte_hash,lookup_update)(struct rte_hash_hvariant *h, const hash_key_t
  *   - EINVAL if the parameters are invalid.
  *   - ENOENT if the key is not found.
  */
-int32_t H(rte_hash,lookup_update_with_hash)(struct rte_hash_hvariant *h, const hash_key_t key, hash_sig64_t sig, uint16_t expirationTime, uint16_t currentTime);
+int32_t H(rte_hash,lookup_update_with_hash)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 /**
  * Find a key-value pair in the hash table and update expiration time.
- * This operation is multi-thread safe.
+ * This operation modifies the table (expiration time) and should only be
+ * called from the writer thread (or from any thread if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD).
  *
  * @param h
  *   Hash table to look in.
@@ -356,11 +939,13 @@ int32_t H(rte_hash,lookup_update_with_hash)(struct rte_hash_hvariant *h, const h
  *   - EINVAL if the parameters are invalid.
  *   - ENOENT if the key is not found.
  */
-int H(rte_hash,lookup_update_with_hash_data)(struct rte_hash_hvariant *h,const hash_key_t key, hash_sig64_t sig, hash_data_t *data, uint16_t expirationTime, uint16_t currentTime);
+int H(rte_hash,lookup_update_with_hash_data)(struct rte_hash_hvariant *h,const hash_hvariant_key_t key, hash_sig64_t sig, hash_hvariant_data_t *data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 /**
  * Find a key-value pair in the hash table and update expiration time.
- * This operation is multi-thread safe.
+ * This operation modifies the table (expiration time) and should only be
+ * called from the writer thread (or from any thread if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD).
  *
  * @param h
  *   Hash table to look in.
@@ -378,12 +963,13 @@ int H(rte_hash,lookup_update_with_hash_data)(struct rte_hash_hvariant *h,const h
  *   - EINVAL if the parameters are invalid.
  *   - ENOENT if the key is not found.
  */
-int H(rte_hash,lookup_update_data)(struct rte_hash_hvariant *h, const hash_key_t key, hash_data_t *data, uint16_t expirationTime, uint16_t currentTime);
+int H(rte_hash,lookup_update_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t key, hash_hvariant_data_t *data, hash_hvariant_time_t expirationTime, hash_hvariant_time_t currentTime);
 
 
 /**
  * Find multiple keys in the hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -400,11 +986,12 @@ int H(rte_hash,lookup_update_data)(struct rte_hash_hvariant *h, const hash_key_t
  * @return
  *   -EINVAL if there's an error, otherwise number of successful lookups.
  */
-int H(rte_hash,lookup_bulk_data)(struct rte_hash_hvariant *h, const hash_key_t *keys, uint32_t num_keys, uint64_t *hit_mask, hash_data_t data[], uint16_t currentTime);
+int H(rte_hash,lookup_bulk_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime);
 
 /**
  * Find multiple keys in the hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -423,11 +1010,12 @@ int H(rte_hash,lookup_bulk_data)(struct rte_hash_hvariant *h, const hash_key_t *
  * @return
  *   -EINVAL if there's an error, otherwise 0.
  */
-int H(rte_hash,lookup_bulk)(struct rte_hash_hvariant *h, const hash_key_t *keys, uint32_t num_keys, int32_t *positions, uint16_t currentTime);
+int H(rte_hash,lookup_bulk)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys, int32_t *positions, hash_hvariant_time_t currentTime);
 
 /**
  * Find multiple keys in the hash table.
- * This operation is multi-thread safe.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
  *
  * @param h
  *   Hash table to look in.
@@ -444,11 +1032,13 @@ int H(rte_hash,lookup_bulk)(struct rte_hash_hvariant *h, const hash_key_t *keys,
  * @return
  *   -EINVAL if there's an error, otherwise number of successful lookups.
  */
-int H(rte_hash,lookup_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_key_t *keys, uint64_t lookup_mask, uint64_t *hit_mask, hash_data_t data[], uint16_t currentTime);
+int H(rte_hash,lookup_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint64_t lookup_mask, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime);
 
 /**
  * Find multiple keys in the hash table.
- * This operation is multi-thread safe.
+ * This operation modifies the table (expiration time) and should only be
+ * called from the writer thread (or from any thread if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD).
  *
  * @param h
  *   Hash table to look in.
@@ -469,7 +1059,65 @@ int H(rte_hash,lookup_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_ke
  * @return
  *   -EINVAL if there's an error, otherwise number of successful lookups.
  */
-int H(rte_hash,lookup_update_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_key_t *keys, uint64_t lookup_mask, uint64_t *hit_mask, uint64_t *updated_mask, hash_data_t data[], uint16_t * newExpirationTime, uint16_t currentTime);
+int H(rte_hash,lookup_update_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint64_t lookup_mask, uint64_t *hit_mask, uint64_t *updated_mask, hash_hvariant_data_t data[], hash_hvariant_time_t * newExpirationTime, hash_hvariant_time_t currentTime);
+
+/**
+ * Find multiple keys in the hash table, and add the ones that are missing (lookup-or-insert).
+ * Keys found have their expiration time updated and their data returned, missing keys are
+ * added with their default data. Hashes and buckets computed by the lookup are reused for insertion.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD.
+ *
+ * @param h
+ *   Hash table to look in.
+ * @param keys
+ *   A pointer to a list of keys to look for (up to 64 keys, according to lookup_mask).
+ * @param lookup_mask
+ *  bitmask of keys to lookup
+ * @param hit_mask
+ *   Output containing a bitmask of keys that were already in the table (a key present several
+ *   times in the list is inserted by its first occurrence and reported as hit for the next ones,
+ *   which update its expiration time).
+ * @param inserted_mask
+ *   Output containing a bitmask of keys added to the table (can be NULL).
+ * @param failed_mask
+ *   Output containing a bitmask of keys not found that could not be added (-ENOSPC) (can be NULL).
+ * @param data
+ *   Output containing data of all keys found or inserted (can be NULL).
+ * @param default_data
+ *   Data to store for each key that is inserted.
+ * @param newExpirationTime
+ *   A pointer to a list of expiration times for each key (used both for keys found and keys inserted).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if there's an error, otherwise number of keys found or inserted.
+ */
+int H(rte_hash,lookup_or_add_bulk_data_mask)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint64_t lookup_mask, uint64_t *hit_mask, uint64_t *inserted_mask, uint64_t *failed_mask, hash_hvariant_data_t data[], const hash_hvariant_data_t default_data[], hash_hvariant_time_t *newExpirationTime, hash_hvariant_time_t currentTime);
+
+/**
+ * Find an arbitrary number of keys in the hash table (e.g., millions of keys).
+ * Keys flow through a software pipeline (hash, buckets, signatures, keys) with a fixed
+ * window of in-flight keys, so that prefetches are never drained between groups of keys.
+ * This operation is multi-thread safe if the table was created with
+ * RTE_HASH_HVARIANT_EXTRA_FLAGS_RW_CONCURRENCY_LF (concurrently with a single writer).
+ *
+ * @param h
+ *   Hash table to look in.
+ * @param keys
+ *   A pointer to a list of keys to look for.
+ * @param num_keys
+ *   How many keys are in the keys list (at most INT32_MAX).
+ * @param hit_mask
+ *   Output bitmap of (num_keys + 63) / 64 words: bit (i % 64) of hit_mask[i / 64] is set if keys[i] was found.
+ * @param data
+ *   Output containing array of data returned from all the successful lookups (can be NULL).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if there's an error, otherwise number of successful lookups.
+ */
+int H(rte_hash,lookup_stream_data)(struct rte_hash_hvariant *h, const hash_hvariant_key_t *keys, uint32_t num_keys, uint64_t *hit_mask, hash_hvariant_data_t data[], hash_hvariant_time_t currentTime);
 
 
 /**
@@ -503,7 +1151,79 @@ void H(rte_hash,iterator_reset)(struct rte_hash_hvariant *h);
  *   - -EBUSY if the iteration was suspended (and should be continued by a new call). This allows to limit the duration of unpreemptable calls to this function.
  */
 int32_t
-H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *data, uint16_t * remaining_time, uint16_t currentTime);
+H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime);
+
+/**
+ * Iterate through the hash table, returning up to num_entries key-value pairs at once.
+ * Same as iterate() (the two can be mixed), but live entries are selected a whole bucket at a
+ * time and copied to the output arrays, which saves a call per entry when most of the table is
+ * exported.
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param keys
+ *   Output array of at least num_entries keys
+ * @param data
+ *   Output array of at least num_entries data
+ * @param remaining_times
+ *   Output array of at least num_entries remaining times before expiration (relative to currentTime)
+ * @param num_entries
+ *   Max number of entries returned (at most RTE_HASH_HVARIANT_ITER_BULK_MAX)
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - the number of entries returned (fewer than num_entries does not mean that the end is reached)
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if end of the hash table.
+ *   - -EBUSY if the iteration was suspended before any entry was found (and should be continued by a new call).
+ */
+int32_t
+H(rte_hash,iterate_bulk)(struct rte_hash_hvariant *h, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, uint32_t num_entries, hash_hvariant_time_t currentTime);
+
+/**
+ * Reset the iterator and split the table in nb_parts partitions (disjoint ranges of buckets,
+ * the stash belonging to partition 0) that are iterated over with iterate_partition(), each
+ * with its own cursor. Partitions can be iterated over in parallel by different cores, but not
+ * concurrently with writers. As with iterate(), entries added or updated in between calls are
+ * returned (again). iterator_reset() ends the partitioned iteration.
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param nb_parts
+ *   Number of partitions (at most RTE_HASH_HVARIANT_ITER_MAX_PARTS; partitions own multiples of
+ *   2048 buckets, so that some of them may be empty with small tables)
+ * @return
+ *   - 0 on success
+ *   - -EINVAL if the parameters are invalid.
+ */
+int
+H(rte_hash,iterator_reset_partitions)(struct rte_hash_hvariant *h, uint32_t nb_parts);
+
+/**
+ * Iterate through a partition of the hash table, returning key-value pairs.
+ * iterator_reset_partitions() must be called before starting iteration on the hash table.
+ * Expired entries are skipped but, unlike with iterate(), their slots are not released.
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param part
+ *   Partition to iterate (less than the number of partitions given to iterator_reset_partitions())
+ * @param key
+ *   Output containing the key where current iterator was pointing at
+ * @param data
+ *   Output containing the data associated with key.
+ * @param currentTime
+ *   Current time unit
+ * @param remainingTime
+ *   Output containing remaining time before expiration (relative to currentTime)
+ * @return
+ *   - 0 if a key/data is returned
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if end of the partition.
+ *   - -EBUSY if the iteration was suspended (and should be continued by a new call).
+ */
+int32_t
+H(rte_hash,iterate_partition)(struct rte_hash_hvariant *h, uint32_t part, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime);
 
 /**
  * Iterate through the hash table, returning key-value pairs. Unsafe version, multiple iterators allowed, but entries may be missed if modification are concurrent.
@@ -528,7 +1248,140 @@ H(rte_hash,iterate)(struct rte_hash_hvariant *h, hash_key_t *key, hash_data_t *d
  *   - -ENOENT if end of the hash table.
  */
 int32_t
-H(rte_hash,unsafe_iterate)(struct rte_hash_hvariant *h, uint64_t * pos, hash_key_t *key, hash_data_t *data, uint16_t * remaining_time, uint16_t currentTime);
+H(rte_hash,unsafe_iterate)(struct rte_hash_hvariant *h, uint64_t * pos, hash_hvariant_key_t *key, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_time, hash_hvariant_time_t currentTime);
+
+/**
+ * Iterate through the hash table, returning up to num_entries key-value pairs at once. Unsafe
+ * version, positions are those of unsafe_iterate() (the two can be mixed).
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param pos
+ * 	 Placeholder for iterator data (must be set to 0 for starting an iteration)
+ * @param keys
+ *   Output array of at least num_entries keys
+ * @param data
+ *   Output array of at least num_entries data
+ * @param remaining_times
+ *   Output array of at least num_entries remaining times before expiration (relative to currentTime)
+ * @param num_entries
+ *   Max number of entries returned (at most RTE_HASH_HVARIANT_ITER_BULK_MAX)
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - the number of entries returned
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if end of the hash table.
+ */
+int32_t
+H(rte_hash,unsafe_iterate_bulk)(struct rte_hash_hvariant *h, uint64_t * pos, hash_hvariant_key_t *keys, hash_hvariant_data_t *data, hash_hvariant_time_t * remaining_times, uint32_t num_entries, hash_hvariant_time_t currentTime);
+
+/**
+ * Callback receiving the entries removed by expire_step(): keys[i] and data[i] for i < n.
+ * Arrays are only valid during the call.
+ */
+typedef void (*H(rte_hash,expire_cb_t))(const hash_hvariant_key_t *keys, const hash_hvariant_data_t *data, uint32_t n, void *arg);
+
+/**
+ * Remove expired entries, scanning at most budget buckets from where the previous call stopped.
+ * Entries are removed as by del_key() (bloom filter and horton remap entries are updated), and
+ * given to the callback in batches of up to RTE_HASH_HVARIANT_EXPIRE_BATCH entries, after they
+ * have been removed. The callback must not modify the table. The stash is swept each time the
+ * scan wraps around the buckets. While the table is resized, the old arrays are swept as well
+ * (budget buckets of each); expired entries met by the migration are dropped without callback.
+ * This is a writer operation. Tables without timers have no expired entries.
+ *
+ * @param h
+ *   Hash table to sweep
+ * @param budget
+ *   Max number of buckets scanned
+ * @param currentTime
+ *   Current time unit
+ * @param cb
+ *   Callback receiving removed entries (can be NULL)
+ * @param arg
+ *   Argument given to the callback
+ * @return
+ *   - -EINVAL if the parameters are invalid
+ *   - otherwise, the number of entries removed
+ */
+int32_t
+H(rte_hash,expire_step)(struct rte_hash_hvariant *h, uint32_t budget, hash_hvariant_time_t currentTime, H(rte_hash,expire_cb_t) cb, void *arg);
+
+/**
+ * Rebuild the bloom filters of buckets, processing at most budget buckets from where the
+ * previous call stopped. The filter of a bucket is only cleared when no entry moved from it
+ * is left, so bits of deleted entries, and of expired entries whose slot was not reused,
+ * accumulate and lookups of missing keys access secondary buckets more often. A scrub makes
+ * two passes: the first scans the buckets and rebuilds the filters from the live entries in
+ * secondary position, the second replaces the filters of buckets by the rebuilt ones. From
+ * the first call of a scrub until it completes (or is dropped), the rebuilt filters are kept
+ * in a scratch array of num_buckets * BLOOM_WORDS * sizeof(uint64_t) bytes (BLOOM_WORDS
+ * being 2 with 16-slot buckets, 1 otherwise), allocated on the socket of the table: 8 or 16
+ * bytes per bucket, to account for on large tables. Lookups and
+ * writes may run between calls (the filters used by lookups always have the bits of the
+ * entries in secondary position); a reset or resize of the table drops the scrub in progress.
+ * This is a writer operation.
+ *
+ * @param h
+ *   Hash table to scrub
+ * @param budget
+ *   Max number of buckets processed
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - 1 if the filters of all buckets were replaced (the next call starts a new scrub)
+ *   - 0 if the scrub is still in progress
+ *   - -EINVAL if the parameters are invalid
+ *   - -ENOTSUP for variants without bloom filters and multi-writer tables
+ *   - -EBUSY while the table is resized
+ *   - -ENOMEM if the rebuilt filters could not be allocated
+ */
+int
+H(rte_hash,bloom_scrub)(struct rte_hash_hvariant *h, uint32_t budget, hash_hvariant_time_t currentTime);
+
+/**
+ * Estimate the saturation of the bloom filters of buckets from the filters of up to 4096
+ * evenly spaced buckets. When it grows while the load of the table does not, bloom_scrub()
+ * can clear stale bits. Can be called from any thread while the table is used.
+ *
+ * @param h
+ *   Hash table
+ * @param fp_rate
+ *   Output (can be NULL): estimated probability that a lookup of a key absent from its
+ *   primary bucket accesses its secondary bucket
+ * @return
+ *   - the fraction of bits set in the filters
+ *   - -EINVAL if the parameters are invalid
+ *   - -ENOTSUP for variants without bloom filters
+ */
+double
+H(rte_hash,bloom_saturation)(const struct rte_hash_hvariant *h, double *fp_rate);
+
+/**
+ * Move entries back to their primary bucket, scanning at most budget buckets from where the
+ * previous call stopped. Entries moved to their secondary bucket by insertions stay there when
+ * slots of their primary bucket are freed later: their lookups then access two buckets, and
+ * their bits stay in the bloom filter (or their remap entry in the horton table) of the primary
+ * bucket. Live entries in secondary position are moved to a free or expired slot of their
+ * primary bucket, if any, updating filters, remap entries and iterator state as cuckoo moves do.
+ * Calling it regularly after bursts of deletions or expirations brings back the average lookup
+ * cost. Variants other than bloom and horton do not mark entries in secondary position: the
+ * keys of the buckets scanned are hashed again to find them. This is a writer operation.
+ *
+ * @param h
+ *   Hash table to rebalance
+ * @param budget
+ *   Max number of buckets scanned
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - -EINVAL if the parameters are invalid
+ *   - -EBUSY while the table is resized
+ *   - otherwise, the number of entries moved
+ */
+int32_t
+H(rte_hash,rebalance_step)(struct rte_hash_hvariant *h, uint32_t budget, hash_hvariant_time_t currentTime);
 
 /**
  * Check the integrity of the structure. This function is meant to be used during development or testing.
@@ -540,7 +1393,7 @@ H(rte_hash,unsafe_iterate)(struct rte_hash_hvariant *h, uint64_t * pos, hash_key
  * @return 
  *   Nothing. Errors are printed to standard output. 
  */
-void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, uint16_t currentTime);
+void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime);
 
 /**
  * Check the integrity of the structure
@@ -552,7 +1405,36 @@ void H(rte_hash,check_integrity)(struct rte_hash_hvariant *h, uint16_t currentTi
  * @return 
  * 	 Stasticis on fraction of entries stored in secondary bucket.
  */
-double H(rte_hash,stats_secondary)(struct rte_hash_hvariant *h, uint16_t currentTime);
+double H(rte_hash,stats_secondary)(struct rte_hash_hvariant *h, hash_hvariant_time_t currentTime);
+
+/**
+ * Read the operation counters of a table: counters of all lcores are summed up (the longest
+ * cuckoo path is the maximum over lcores). Counters are only maintained if the library is
+ * built with RTE_LIBRTE_TCH_HASH_STATS defined; each lcore then updates its own cache line,
+ * and non-EAL threads share one, updated with atomic operations. Counters can be read from any
+ * thread while the table is used.
+ * The ratio of secondary accesses and key compares to lookups, and a growing number of
+ * cuckoo moves, show a table drifting to high load factors.
+ *
+ * @param h
+ *   Hash table
+ * @param stats
+ *   Output with the sums of the counters
+ * @return
+ *   - 0 on success
+ *   - -EINVAL if the parameters are invalid
+ *   - -ENOTSUP if counters were not enabled at build time
+ */
+int H(rte_hash,op_stats)(const struct rte_hash_hvariant *h, struct rte_hash_hvariant_op_stats *stats);
+
+/**
+ * Reset the operation counters of a table. Operations running meanwhile on other lcores
+ * may be partially counted.
+ *
+ * @param h
+ *   Hash table
+ */
+void H(rte_hash,op_stats_reset)(struct rte_hash_hvariant *h);
 
 /**
  * Returns the number of slots per bucket
@@ -562,6 +1444,15 @@ double H(rte_hash,stats_secondary)(struct rte_hash_hvariant *h, uint16_t current
  */
 int H(rte_hash,slots_per_bucket)(void);
 
+/**
+ * Returns the maximum expiration period: expiration times given to the table must be
+ * less than this number of time units ahead of the current time
+ *
+ * @return
+ * 	 the maximum expiration period (in time units)
+ */
+uint32_t H(rte_hash,max_expiration_period)(void);
+
 
 #ifdef __cplusplus
 }
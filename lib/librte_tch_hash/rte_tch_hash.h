@@ -15,6 +15,7 @@
 #include <assert.h>
 
 #include <rte_common.h>
+#include <rte_errno.h>
 #include <rte_tchh_structs.h>
 
 #include <rte_hash_horton.h>
@@ -73,6 +74,10 @@ struct rte_tch_hash {
 struct rte_tch_hash_parameters {
 	uint32_t entries;		/**< Total hash table entries. */
 	int socket_id;			/**< NUMA Socket ID for memory. */
+	uint8_t extra_flag;		/**< RTE_HASH_HVARIANT_EXTRA_FLAGS_* (only MULTI_WRITER_ADD is used by DPDK 17.02). */
+	uint8_t grow_load_pct;		/**< Automatic growth load threshold in percent (not used by DPDK tables). */
+	uint16_t grow_path_len;		/**< Automatic growth cuckoo path threshold (not used by DPDK tables). */
+	const char *name;		/**< Name of the table, to find it with rte_tch_hash_find_existing (NULL: generated name). */
 };
 
 
@@ -132,11 +137,14 @@ static inline void rte_tch_hash_print_stats(enum rte_tch_hash_variants v,struct
 static inline struct rte_tch_hash *
 rte_tch_hash_create(enum rte_tch_hash_variants v, const struct rte_tch_hash_parameters *params){
 	char buf[L_tmpnam];
-	char * name = tmpnam(buf);
+	const char * name = params->name != NULL ? params->name : tmpnam(buf);
 	struct rte_tch_hash  * h = (struct rte_tch_hash *) rte_zmalloc(NULL,sizeof(struct rte_tch_hash),64);
 	struct rte_hash_hvariant_parameters p;
 	p.entries=params->entries;
 	p.socket_id=params->socket_id;
+	p.extra_flag=params->extra_flag;
+	p.grow_load_pct=params->grow_load_pct;
+	p.grow_path_len=params->grow_path_len;
 	p.name=name;
 
 	if(name == NULL) rte_exit(EXIT_FAILURE, "Failed to generate temporary name for hash table\n");
@@ -158,7 +166,8 @@ rte_tch_hash_create(enum rte_tch_hash_variants v, const struct rte_tch_hash_para
 		p.key_len=16;
 		p.socket_id=params->socket_id;
 		p.name=name;
-		p.extra_flag = 0;
+		p.extra_flag = (params->extra_flag & RTE_HASH_HVARIANT_EXTRA_FLAGS_MULTI_WRITER_ADD) ?
+				RTE_HASH_V1702_EXTRA_FLAGS_MULTI_WRITER_ADD : 0;
 		p.reserved = 0;
 		p.hash_func_init_val = 0xffeeffee;
 		p.hash_func = rte_tch_hash_function;
@@ -169,6 +178,71 @@ rte_tch_hash_create(enum rte_tch_hash_variants v, const struct rte_tch_hash_para
 }
 
 
+/**
+ * Save the hash table to a file.
+ *
+ * @param h
+ *   Hash table to save
+ * @param path
+ *   File to write
+ * @return
+ *   0 on success, a negative error code otherwise (-ENOTSUP for DPDK tables).
+ */
+#define SAVE(x) return rte_hash_##x##_save(h->h_tch,path);
+static inline int rte_tch_hash_save(enum rte_tch_hash_variants v, struct rte_tch_hash *h, const char *path){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(SAVE)
+	return -1;
+}
+
+/**
+ * Create a hash table holding the entries saved in a file by rte_tch_hash_save (from a table of
+ * the same variant).
+ *
+ * @param path
+ *   File written by rte_tch_hash_save
+ * @param params
+ *   Parameters used to create the hash table (entries can be 0 to use the size of the saved table).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   Pointer to hash table structure, or NULL on error, with error code set in rte_errno
+ *   (ENOTSUP for DPDK tables).
+ */
+#define LOAD(x) 	h->h_tch = rte_hash_##x##_load(path,&p,currentTime);
+static inline struct rte_tch_hash *
+rte_tch_hash_load(enum rte_tch_hash_variants v, const char *path, const struct rte_tch_hash_parameters *params, uint16_t currentTime){
+	char buf[L_tmpnam];
+	const char * name = params->name != NULL ? params->name : tmpnam(buf);
+	struct rte_tch_hash  * h;
+	struct rte_hash_hvariant_parameters p;
+
+	if(v == H_V1604 || v == H_V1702){
+		rte_errno = ENOTSUP;
+		return NULL;
+	}
+	if(name == NULL) rte_exit(EXIT_FAILURE, "Failed to generate temporary name for hash table\n");
+	p.entries=params->entries;
+	p.socket_id=params->socket_id;
+	p.extra_flag=params->extra_flag;
+	p.grow_load_pct=params->grow_load_pct;
+	p.grow_path_len=params->grow_path_len;
+	p.name=name;
+
+	h = (struct rte_tch_hash *) rte_zmalloc(NULL,sizeof(struct rte_tch_hash),64);
+	if(h == NULL){
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+	EXPAND(LOAD)
+	if(h->h_tch == NULL){
+		rte_free(h);
+		return NULL;
+	}
+	return h;
+}
+
 
 /**
  * Add a key-value pair to an existing hash table.
@@ -206,6 +280,40 @@ static inline int rte_tch_hash_del_key(enum rte_tch_hash_variants v, struct rte_
 	return -1;
 }
 
+/**
+ * Remove multiple keys from an existing hash table (up to 64 keys, according to lookup_mask).
+ *
+ * @param h
+ *   Hash table to remove the keys from.
+ * @param keys
+ *   Keys to remove.
+ * @param lookup_mask
+ *   Bitmask of keys to remove
+ * @param deleted_mask
+ *   Output bitmask of the keys that were found and removed
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if the parameters are invalid, otherwise number of removed keys.
+ */
+#define DELKB(x) return rte_hash_##x##_del_key_bulk(h->h_tch,keys,lookup_mask,deleted_mask,currentTime);
+static inline int rte_tch_hash_del_key_bulk(enum rte_tch_hash_variants v, struct rte_tch_hash *h, const hash_key_t *keys, uint64_t lookup_mask, uint64_t *deleted_mask, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702){
+		/* No bulk deletion in DPDK variants: remove keys one by one */
+		uint64_t deleted = 0, tmp_mask;
+		int i;
+		for(tmp_mask = lookup_mask; tmp_mask != 0; tmp_mask &= tmp_mask - 1){
+			i = __builtin_ctzll(tmp_mask);
+			if(rte_tch_hash_del_key(v,h,keys[i],currentTime) >= 0)
+				deleted |= 1ULL << i;
+		}
+		if(deleted_mask != NULL) *deleted_mask = deleted;
+		return __builtin_popcountll(deleted);
+	}
+	EXPAND(DELKB)
+	return -1;
+}
+
 
 /**
  * Find a key-value pair in the hash table.
@@ -232,6 +340,94 @@ static inline int rte_tch_hash_lookup_data(enum rte_tch_hash_variants v, struct
 	return -1;
 }
 
+/**
+ * Add multiple key-value pairs to an existing hash table (up to 64 keys).
+ *
+ * @param h
+ *   Hash table to add the keys to.
+ * @param keys
+ *   Keys to add.
+ * @param num_keys
+ *   Number of keys.
+ * @param data
+ *   Data to add for each key (can be NULL).
+ * @param expirationTime
+ *   Expiration time for each key.
+ * @param currentTime
+ *   Current time unit
+ * @param inserted_mask, updated_mask, failed_mask
+ *   Output bitmasks of inserted, updated and failed keys
+ * @return
+ *   -EINVAL if the parameters are invalid, otherwise number of keys inserted or updated.
+ */
+#define ADDKDB(x) return rte_hash_##x##_add_key_data_bulk(h->h_tch,keys,num_keys,data,expirationTime,currentTime,inserted_mask,updated_mask,failed_mask);
+static inline int rte_tch_hash_add_key_data_bulk(enum rte_tch_hash_variants v, struct rte_tch_hash *h, const hash_key_t *keys, uint32_t num_keys,
+		const hash_data_t data[], const uint16_t expirationTime[], uint16_t currentTime,
+		uint64_t *inserted_mask, uint64_t *updated_mask, uint64_t *failed_mask){
+	if(v == H_V1604 || v == H_V1702){
+		/* No bulk insertion in DPDK variants: insert keys one by one (with a lookup before
+		 * each key only if inserted and updated keys must be told apart) */
+		static const hash_data_t zero_data;
+		uint64_t inserted = 0, updated = 0, failed = 0;
+		uint32_t i;
+		int split = inserted_mask != NULL || updated_mask != NULL;
+		assert(num_keys <= 64);
+		for(i=0;i<num_keys;i++){
+			hash_data_t old;
+			int exists = split && rte_tch_hash_lookup_data(v,h,keys[i],&old,currentTime) >= 0;
+			if(rte_tch_hash_add_key_data(v,h,keys[i],data != NULL ? data[i] : zero_data,expirationTime != NULL ? expirationTime[i] : 0,currentTime) < 0)
+				failed |= 1ULL << i;
+			else if(exists)
+				updated |= 1ULL << i;
+			else
+				inserted |= 1ULL << i;
+		}
+		if(inserted_mask != NULL) *inserted_mask = inserted;
+		if(updated_mask != NULL) *updated_mask = updated;
+		if(failed_mask != NULL) *failed_mask = failed;
+		return __builtin_popcountll(inserted | updated);
+	}
+	EXPAND(ADDKDB)
+	return -1;
+}
+
+/**
+ * Fill an empty hash table with a set of keys (offline build, faster than adding keys one by one).
+ *
+ * @param h
+ *   Empty hash table.
+ * @param keys
+ *   Keys to add.
+ * @param num_keys
+ *   Number of keys.
+ * @param data
+ *   Data of each key (can be NULL).
+ * @param expirationTime
+ *   Expiration time of each key (can be NULL).
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   0 if all keys were added, -ENOSPC if some could not be added, -EINVAL, -EBUSY (table not
+ *   empty), -ENOTSUP (concurrent table) or -ENOMEM otherwise.
+ */
+#define BUILD(x) return rte_hash_##x##_build(h->h_tch,keys,num_keys,data,expirationTime,currentTime);
+static inline int rte_tch_hash_build(enum rte_tch_hash_variants v, struct rte_tch_hash *h, const hash_key_t *keys, uint32_t num_keys,
+		const hash_data_t data[], const uint16_t expirationTime[], uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702){
+		/* No bulk build in DPDK variants: insert keys one by one */
+		static const hash_data_t zero_data;
+		int ret = 0;
+		uint32_t i;
+		for(i=0;i<num_keys;i++){
+			if(rte_tch_hash_add_key_data(v,h,keys[i],data != NULL ? data[i] : zero_data,expirationTime != NULL ? expirationTime[i] : 0,currentTime) < 0)
+				ret = -ENOSPC;
+		}
+		return ret;
+	}
+	EXPAND(BUILD)
+	return -1;
+}
+
 /**
  * Find a key-value pair with a pre-computed hash value
  * to an existing hash table.
@@ -366,6 +562,44 @@ static inline int rte_tch_hash_lookup_bulk_data(enum rte_tch_hash_variants v, st
 	return -1;
 }
 
+/**
+ * Find an arbitrary number of keys in the hash table, using a continuous prefetch pipeline.
+ *
+ * @param h
+ *   Hash table to look in.
+ * @param keys
+ *   A pointer to a list of keys to look for.
+ * @param num_keys
+ *   How many keys are in the keys list.
+ * @param hit_mask
+ *   Output bitmap of (num_keys + 63) / 64 words with all successful lookups.
+ * @param data
+ *   Output containing array of data returned from all the successful lookups.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if there's an error, otherwise number of successful lookups.
+ */
+#define STREAMD(x) 		return rte_hash_##x##_lookup_stream_data(h->h_tch,keys, num_keys,hit_mask,data,currentTime);
+static inline int rte_tch_hash_lookup_stream_data(enum rte_tch_hash_variants v, struct rte_tch_hash *h, const hash_key_t *keys, uint32_t num_keys, uint64_t *hit_mask, hash_data_t data[], uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702){
+		/* No streaming support in DPDK variants: split in bulks of 64 keys */
+		uint32_t i;
+		int hits = 0;
+		for(i=0;i<num_keys;i+=64){
+			uint32_t n = num_keys - i < 64 ? num_keys - i : 64;
+			hit_mask[i / 64] = 0;
+			int r = rte_tch_hash_lookup_bulk_data(v,h,&keys[i],n,&hit_mask[i / 64],data != NULL ? &data[i] : NULL,currentTime);
+			if(r < 0)
+				return r;
+			hits += __builtin_popcountll(hit_mask[i / 64]);
+		}
+		return hits;
+	}
+	EXPAND(STREAMD)
+	return -1;
+}
+
 /**
  * Find multiple keys in the hash table.
  * This operation is multi-thread safe.
@@ -438,6 +672,54 @@ static inline int rte_tch_hash_lookup_update_bulk_data_mask(enum rte_tch_hash_va
 	return -1;
 }
 
+/**
+ * Find multiple keys in the hash table, and add the missing ones with their default data (lookup-or-insert).
+ *
+ * @param h
+ *   Hash table to look in.
+ * @param keys
+ *   Keys to look for (up to 64 keys, according to lookup_mask).
+ * @param lookup_mask
+ *   Bitmask of keys to lookup
+ * @param hit_mask, inserted_mask, failed_mask
+ *   Output bitmasks of keys found, inserted and not inserted (no space)
+ * @param data
+ *   Output data of keys found or inserted
+ * @param default_data
+ *   Data of keys to insert
+ * @param newExpirationTime
+ *   Expiration time of each key
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   -EINVAL if the parameters are invalid, otherwise number of keys found or inserted.
+ */
+#define BULKLA(x) return rte_hash_##x##_lookup_or_add_bulk_data_mask(h->h_tch,keys,lookup_mask,hit_mask,inserted_mask,failed_mask,data,default_data,newExpirationTime,currentTime);
+static inline int rte_tch_hash_lookup_or_add_bulk_data_mask(enum rte_tch_hash_variants v, struct rte_tch_hash *h, const hash_key_t *keys, uint64_t lookup_mask, uint64_t *hit_mask, uint64_t *inserted_mask, uint64_t *failed_mask, hash_data_t data[], const hash_data_t default_data[], uint16_t * newExpirationTime, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702){
+		/* No lookup-or-insert in DPDK variants: lookup and insert keys one by one */
+		uint64_t hits = 0, inserted = 0, failed = 0, tmp_mask;
+		int i;
+		for(tmp_mask = lookup_mask; tmp_mask != 0; tmp_mask &= tmp_mask - 1){
+			i = __builtin_ctzll(tmp_mask);
+			if(rte_tch_hash_lookup_data(v,h,keys[i],&data[i],currentTime) >= 0){
+				hits |= 1ULL << i;
+			}else if(rte_tch_hash_add_key_data(v,h,keys[i],default_data[i],newExpirationTime[i],currentTime) >= 0){
+				data[i] = default_data[i];
+				inserted |= 1ULL << i;
+			}else{
+				failed |= 1ULL << i;
+			}
+		}
+		*hit_mask = hits;
+		if(inserted_mask != NULL) *inserted_mask = inserted;
+		if(failed_mask != NULL) *failed_mask = failed;
+		return __builtin_popcountll(hits | inserted);
+	}
+	EXPAND(BULKLA)
+	return -1;
+}
+
 
 /**
  * Reset iterator (only a single iterator can be active at a time on the hashtable)
@@ -496,6 +778,85 @@ rte_tch_hash_iterate(enum rte_tch_hash_variants v, struct rte_tch_hash *h, hash_
 	return -1;
 }
 
+/**
+ * Iterate through the hash table, returning up to num_entries key-value pairs at once.
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param keys
+ *   Output array of keys
+ * @param data
+ *   Output array of data
+ * @param remaining_times
+ *   Output array of remaining times
+ * @param num_entries
+ *   Max number of entries returned (at most 64)
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - the number of entries returned
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if end of the hash table.
+ *   - -EBUSY if the iteration was suspended (and should be continued by a new call).
+ *   - -ENOTSUP for DPDK tables.
+ */
+#define ITERATEBULK(x) return rte_hash_##x##_iterate_bulk(h->h_tch,keys,data,remaining_times,num_entries,currentTime);
+static inline int32_t
+rte_tch_hash_iterate_bulk(enum rte_tch_hash_variants v, struct rte_tch_hash *h, hash_key_t *keys, hash_data_t *data, uint16_t * remaining_times, uint32_t num_entries, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(ITERATEBULK)
+	return -1;
+}
+
+/**
+ * Reset iterator and split the hash table in nb_parts partitions, iterated over in parallel with
+ * rte_tch_hash_iterate_partition
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param nb_parts
+ *   Number of partitions
+ * @return
+ *   0 on success, -EINVAL if the parameters are invalid, -ENOTSUP for DPDK tables.
+ */
+#define RESET_PARTITIONS(x) return rte_hash_##x##_iterator_reset_partitions(h->h_tch,nb_parts);
+static inline int rte_tch_hash_iterator_reset_partitions(enum rte_tch_hash_variants v, struct rte_tch_hash *h, uint32_t nb_parts){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(RESET_PARTITIONS)
+	return -1;
+}
+
+/**
+ * Iterate through a partition of the hash table, returning key-value pairs.
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param part
+ *   Partition to iterate
+ * @param key
+ *   Output containing the key where current iterator
+ *   was pointing at
+ * @param data
+ *   Output containing the data associated with key.
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - 0 if a key/data is returned
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if end of the partition.
+ *   - -EBUSY if the iteration was suspended (and should be continued by a new call).
+ */
+#define ITERATEPART(x) return rte_hash_##x##_iterate_partition(h->h_tch,part,key,data,remaining_time,currentTime);
+static inline int32_t
+rte_tch_hash_iterate_partition(enum rte_tch_hash_variants v, struct rte_tch_hash *h, uint32_t part, hash_key_t *key, hash_data_t *data, uint16_t * remaining_time, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(ITERATEPART)
+	return -1;
+}
+
 /**
  * Iterate through the hash table, returning key-value pairs -- unsafe version (for debugging/statistics only!!!).
  * Multiple unsafe iterator can be run on the hashtable.
@@ -536,6 +897,114 @@ rte_tch_hash_unsafe_iterate(enum rte_tch_hash_variants v, struct rte_tch_hash *h
 	return -1;
 }
 
+/**
+ * Iterate through the hash table, returning up to num_entries key-value pairs at once -- unsafe
+ * version, positions are those of rte_tch_hash_unsafe_iterate.
+ *
+ * @param h
+ *   Hash table to iterate
+ * @param pos
+ *   Position in the hash table
+ * @param keys
+ *   Output array of keys
+ * @param data
+ *   Output array of data
+ * @param remaining_times
+ *   Output array of remaining times
+ * @param num_entries
+ *   Max number of entries returned (at most 64)
+ * @param currentTime
+ *   Current time unit
+ * @return
+ *   - the number of entries returned
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOENT if end of the hash table.
+ *   - -ENOTSUP for DPDK tables.
+ */
+#define ITERATEUNBULK(x) return rte_hash_##x##_unsafe_iterate_bulk(h->h_tch,pos,keys,data,remaining_times,num_entries,currentTime);
+static inline int32_t
+rte_tch_hash_unsafe_iterate_bulk(enum rte_tch_hash_variants v, struct rte_tch_hash *h, uint64_t * pos, hash_key_t *keys, hash_data_t *data, uint16_t * remaining_times, uint32_t num_entries, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(ITERATEUNBULK)
+	return -1;
+}
+
+/** Callback receiving the entries removed by rte_tch_hash_expire_step */
+typedef void (*rte_tch_hash_expire_cb_t)(const hash_key_t *keys, const hash_data_t *data, uint32_t n, void *arg);
+
+/**
+ * Remove expired entries, scanning at most budget buckets from where the previous call stopped,
+ * and give them to the callback in batches.
+ *
+ * @param h
+ *   Hash table to sweep
+ * @param budget
+ *   Max number of buckets scanned
+ * @param currentTime
+ *   Current time unit
+ * @param cb
+ *   Callback receiving removed entries (can be NULL)
+ * @param arg
+ *   Argument given to the callback
+ * @return
+ *   Number of entries removed (DPDK tables have no expiration and always return 0).
+ */
+#define EXPIRESTEP(x) return rte_hash_##x##_expire_step(h->h_tch,budget,currentTime,cb,arg);
+static inline int32_t
+rte_tch_hash_expire_step(enum rte_tch_hash_variants v, struct rte_tch_hash *h, uint32_t budget, uint16_t currentTime, rte_tch_hash_expire_cb_t cb, void *arg){
+	if(v == H_V1604 || v == H_V1702)
+		return 0;
+	EXPAND(EXPIRESTEP)
+	return -1;
+}
+
+/**
+ * Rebuild the bloom filters of buckets, processing at most budget buckets from where the
+ * previous call stopped (see bloom_scrub in rte_hash_template.h).
+ *
+ * @return
+ *   1 when a scrub completes, 0 while in progress, -ENOTSUP for tables without bloom filters.
+ */
+#define BLOOMSCRUB(x) return rte_hash_##x##_bloom_scrub(h->h_tch,budget,currentTime);
+static inline int
+rte_tch_hash_bloom_scrub(enum rte_tch_hash_variants v, struct rte_tch_hash *h, uint32_t budget, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(BLOOMSCRUB)
+	return -1;
+}
+
+/**
+ * Estimate the fraction of bits set in the bloom filters of buckets, and optionally the
+ * resulting rate of secondary accesses (see bloom_saturation in rte_hash_template.h).
+ */
+#define BLOOMSAT(x) return rte_hash_##x##_bloom_saturation(h->h_tch,fp_rate);
+static inline double
+rte_tch_hash_bloom_saturation(enum rte_tch_hash_variants v, struct rte_tch_hash *h, double *fp_rate){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(BLOOMSAT)
+	return -1;
+}
+
+/**
+ * Move entries in secondary position back to their primary bucket when it has free slots,
+ * scanning at most budget buckets from where the previous call stopped (see rebalance_step
+ * in rte_hash_template.h).
+ *
+ * @return
+ *   Number of entries moved (DPDK tables always return 0).
+ */
+#define REBALANCE(x) return rte_hash_##x##_rebalance_step(h->h_tch,budget,currentTime);
+static inline int32_t
+rte_tch_hash_rebalance_step(enum rte_tch_hash_variants v, struct rte_tch_hash *h, uint32_t budget, uint16_t currentTime){
+	if(v == H_V1604 || v == H_V1702)
+		return 0;
+	EXPAND(REBALANCE)
+	return -1;
+}
+
 /**
  * Check the integrity of the structure
  *
@@ -554,6 +1023,36 @@ static inline void rte_tch_hash_check_integrity(enum rte_tch_hash_variants v, st
 	EXPAND(INTEGRITY)
 }
 
+/**
+ * Find a hash table created (with params->name set) by another process, e.g., from a DPDK
+ * secondary process. Secondary processes should only look keys up (see find_existing in
+ * rte_hash_template.h). The returned handle belongs to the calling process: it must be
+ * released with rte_free, as rte_tch_hash_free would free the table itself.
+ *
+ * @param name
+ *   Name of the hash table
+ * @return
+ *   Pointer to hash table structure, or NULL on error, with error code set in rte_errno.
+ */
+#define FIND_EXISTING(x) 	h->h_tch = rte_hash_##x##_find_existing(name);
+static inline struct rte_tch_hash *
+rte_tch_hash_find_existing(enum rte_tch_hash_variants v, const char *name){
+	struct rte_tch_hash  * h = (struct rte_tch_hash *) rte_zmalloc(NULL,sizeof(struct rte_tch_hash),64);
+
+	if(h == NULL){
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+	if(v == H_V1604) h->h_dpdk1604 = rte_hash_v1604_find_existing(name);
+	if(v == H_V1702) h->h_dpdk1702 = rte_hash_v1702_find_existing(name);
+	EXPAND(FIND_EXISTING)
+	if(h->h_tch == NULL){
+		rte_free(h);
+		return NULL;
+	}
+	return h;
+}
+
 #define FREE(x) rte_hash_##x##_free(h->h_tch);
 static inline void rte_tch_hash_free(enum rte_tch_hash_variants v, struct rte_tch_hash *h){
 	if(v == H_V1604){
@@ -599,6 +1098,20 @@ static inline double rte_tch_hash_stats_secondary(enum rte_tch_hash_variants v,
 	return nan("");
 }
 
+/**
+ * Read the operation counters of the hash table (see op_stats in rte_hash_template.h).
+ *
+ * @return
+ *   0 on success, -ENOTSUP for DPDK tables or if counters were not enabled at build time.
+ */
+#define OP_STATS(x) return rte_hash_##x##_op_stats(h->h_tch, stats);
+static inline int rte_tch_hash_op_stats(enum rte_tch_hash_variants v, struct rte_tch_hash *h, struct rte_hash_hvariant_op_stats *stats){
+	if(v == H_V1604 || v == H_V1702)
+		return -ENOTSUP;
+	EXPAND(OP_STATS)
+	return -1;
+}
+
 #define BUCKETS(x) return rte_hash_##x##_slots_per_bucket();
 static inline int rte_tch_hash_slots_per_bucket(enum rte_tch_hash_variants v){
 	if(v == H_V1604){
@@ -23,6 +23,47 @@ struct rte_tch_key {
 };
 
 typedef struct rte_tch_key hash_key_t;
+typedef struct rte_tch_key hash_key16_t;
+
+/* Narrower and wider keys, selected at compile-time through KEY_SIZE in the variant header */
+struct rte_tch_key8 {
+	union{
+		uint64_t a;
+		uint8_t bytes[8];
+	};
+};
+
+typedef struct rte_tch_key8 hash_key8_t;
+
+struct rte_tch_key32 {
+	union{
+		struct {
+			uint64_t a;
+			uint64_t b;
+			uint64_t c;
+			uint64_t d;
+		};
+		__m128i mm[2];
+	};
+};
+
+typedef struct rte_tch_key32 hash_key32_t;
+
+struct rte_tch_key48 {
+	union{
+		struct {
+			uint64_t a;
+			uint64_t b;
+			uint64_t c;
+			uint64_t d;
+			uint64_t e;
+			uint64_t f;
+		};
+		__m128i mm[3];
+	};
+};
+
+typedef struct rte_tch_key48 hash_key48_t;
 
 struct rte_tch_data {
 	union{
@@ -35,6 +76,28 @@ struct rte_tch_data {
 };
 
 typedef struct rte_tch_data hash_data_t;
+typedef struct rte_tch_data hash_data16_t;
+
+/* Narrower values, selected at compile-time through DATA_SIZE in the variant header */
+struct rte_tch_data8 {
+	uint64_t a;
+};
+
+typedef struct rte_tch_data8 hash_data8_t;
+
+struct rte_tch_data4 {
+	uint32_t a;
+};
+
+typedef struct rte_tch_data4 hash_data4_t;
+
+/* Placeholder for variants without data (DATA_SIZE 0), nothing is stored in the key store */
+struct rte_tch_data0 {
+	uint8_t unused;
+};
+
+typedef struct rte_tch_data0 hash_data0_t;
+
 typedef uint64_t hash_sig64_t;
 
 #endif